@@ -0,0 +1,448 @@
+//------------------------------------------------------------------------------
+//
+//  Device characterization
+//
+//  Measures what the static device info does not tell: transfer bandwidth
+//  between host and device (pageable and pinned host memory), copy
+//  bandwidth on the device, FMA throughput in single and double precision,
+//  kernel launch latency and local memory bandwidth. Every measurement is
+//  the best of a few runs. The profiles are written as JSON, one flat object
+//  per device, for schedulers and autotuners.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CL/cl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace profile {
+
+    const int RUNS = 5;                         // best of
+    const int LAUNCHES = 1000;                  // kernels per latency measurement
+    const ::size_t TRANSFER_BYTES = 64 << 20;   // upper bound for the transfer size
+    const int FMA_ITERS = 1024;                 // loop iterations of the FMA kernel
+    const int FMA_CHAINS = 8;                   // independent FMA chains per work-item (fixed in the kernel)
+    const int LOCAL_ITERS = 1024;               // local memory reads per work-item
+
+    // the measurement kernels, REAL and the loop counts are set when building
+    const char* const KERNEL_SOURCE =
+        "#ifdef USE_DOUBLE\n"
+        "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+        "#endif\n"
+        "\n"
+        "__kernel void empty(void)\n"
+        "{\n"
+        "}\n"
+        "\n"
+        "__kernel void fma_peak(__global REAL* out, const REAL a, const REAL b)\n"
+        "{\n"
+        "\tREAL x[8];\n"
+        "\tfor (int c = 0; c < 8; c++)\n"
+        "\t\tx[c] = get_global_id(0) + c;\n"
+        "\tfor (int i = 0; i < FMA_ITERS; i++) {\n"
+        "\t\tx[0] = fma(x[0], a, b); x[1] = fma(x[1], a, b); x[2] = fma(x[2], a, b); x[3] = fma(x[3], a, b);\n"
+        "\t\tx[4] = fma(x[4], a, b); x[5] = fma(x[5], a, b); x[6] = fma(x[6], a, b); x[7] = fma(x[7], a, b);\n"
+        "\t}\n"
+        "\tout[get_global_id(0)] = x[0] + x[1] + x[2] + x[3] + x[4] + x[5] + x[6] + x[7];\n"
+        "}\n"
+        "\n"
+        "// the local size has to be a power of two\n"
+        "__kernel void local_read(__global float* out, __local float* buf)\n"
+        "{\n"
+        "\tint l = get_local_id(0);\n"
+        "\tint mask = get_local_size(0) - 1;\n"
+        "\tbuf[l] = l;\n"
+        "\tbarrier(CLK_LOCAL_MEM_FENCE);\n"
+        "\tfloat sum = 0.0f;\n"
+        "\tfor (int i = 0; i < LOCAL_ITERS; i++)\n"
+        "\t\tsum += buf[(l + i) & mask];\n"
+        "\tout[get_global_id(0)] = sum;\n"
+        "}\n";
+
+    /// <summary>
+    /// Build options of the measurement kernels.
+    /// </summary>
+    inline std::string build_options(const char* real)
+    {
+        std::ostringstream options;
+        options << "-DREAL=" << real << " -DFMA_ITERS=" << FMA_ITERS << " -DLOCAL_ITERS=" << LOCAL_ITERS;
+        return options.str();
+    }
+
+    /// <summary>
+    /// The measured performance of a device, negative values were not measured.
+    /// </summary>
+    struct DeviceProfile
+    {
+        std::string platform;
+        std::string name;
+        std::string driver;
+        std::string type;
+        cl_uint compute_units;
+        cl_uint clock_mhz;
+        cl_ulong global_mem_bytes;
+        cl_ulong local_mem_bytes;
+
+        double h2d_pageable_gbs;        // host to device, pageable host memory
+        double h2d_pinned_gbs;          // host to device, pinned host memory
+        double d2h_pageable_gbs;        // device to host, pageable host memory
+        double d2h_pinned_gbs;          // device to host, pinned host memory
+        double d2d_copy_gbs;            // copy between device buffers (read + write)
+        double fp32_gflops;
+        double fp64_gflops;
+        double launch_latency_us;       // enqueue to completion of a single empty kernel
+        double launch_throughput_us;    // per kernel of back to back empty kernels
+        double local_mem_gbs;
+    };
+
+    /// <summary>
+    /// Duration of a profiled command in seconds.
+    /// </summary>
+    inline double event_seconds(const cl::Event& event)
+    {
+        cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        return (end - start) * 1.0e-9;
+    }
+
+    /// <summary>
+    /// Best host time in seconds of an operation that blocks until it is done.
+    /// </summary>
+    template<typename F>
+    double best_host_seconds(F operation)
+    {
+        operation();    // warm up
+
+        double best = 1.0e30;
+        for (int r = 0; r < RUNS; r++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            operation();
+            auto stop = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double>(stop - start).count());
+        }
+
+        return best;
+    }
+
+    /// <summary>
+    /// Best device time in seconds of a kernel launch.
+    /// </summary>
+    inline double best_kernel_seconds(cl::CommandQueue& queue, const cl::Kernel& kernel,
+        const cl::NDRange& global, const cl::NDRange& local)
+    {
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+        queue.finish();
+
+        double best = 1.0e30;
+        for (int r = 0; r < RUNS; r++) {
+            cl::Event event;
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, NULL, &event);
+            event.wait();
+            best = std::min(best, event_seconds(event));
+        }
+
+        return best;
+    }
+
+    /// <summary>
+    /// Measures the transfers between host and device.
+    /// </summary>
+    inline void measure_transfers(const cl::Context& context, cl::CommandQueue& queue, ::size_t bytes, DeviceProfile& p)
+    {
+        cl::Buffer device(context, CL_MEM_READ_WRITE, bytes);
+
+        // pageable: ordinary host memory, the driver stages it
+        std::vector<char> pageable(bytes, 1);
+        p.h2d_pageable_gbs = bytes / best_host_seconds([&]() {
+            queue.enqueueWriteBuffer(device, CL_TRUE, 0, bytes, pageable.data());
+        }) / 1.0e9;
+        p.d2h_pageable_gbs = bytes / best_host_seconds([&]() {
+            queue.enqueueReadBuffer(device, CL_TRUE, 0, bytes, pageable.data());
+        }) / 1.0e9;
+
+        // pinned: host memory allocated by the runtime, kept mapped
+        cl::Buffer staging(context, CL_MEM_ALLOC_HOST_PTR, bytes);
+        void* pinned = queue.enqueueMapBuffer(staging, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes);
+
+        p.h2d_pinned_gbs = bytes / best_host_seconds([&]() {
+            queue.enqueueWriteBuffer(device, CL_TRUE, 0, bytes, pinned);
+        }) / 1.0e9;
+        p.d2h_pinned_gbs = bytes / best_host_seconds([&]() {
+            queue.enqueueReadBuffer(device, CL_TRUE, 0, bytes, pinned);
+        }) / 1.0e9;
+
+        queue.enqueueUnmapMemObject(staging, pinned);
+        queue.finish();
+
+        // device copy: every byte is read and written
+        cl::Buffer copy(context, CL_MEM_READ_WRITE, bytes);
+        double best = 1.0e30;
+        for (int r = 0; r <= RUNS; r++) {
+            cl::Event event;
+            queue.enqueueCopyBuffer(device, copy, 0, 0, bytes, NULL, &event);
+            event.wait();
+            if (r > 0)      // the first run is the warm up
+                best = std::min(best, event_seconds(event));
+        }
+        p.d2d_copy_gbs = 2.0 * bytes / best / 1.0e9;
+    }
+
+    /// <summary>
+    /// Measures the FMA throughput of a program built for float or double.
+    /// </summary>
+    inline double measure_fma(const cl::Context& context, cl::CommandQueue& queue, const cl::Program& program,
+        const cl::Device& device, ::size_t real_size)
+    {
+        // enough work-items to keep every compute unit busy
+        ::size_t items = std::max<::size_t>(device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * 8192, 1 << 16);
+        cl::Buffer out(context, CL_MEM_WRITE_ONLY, real_size * items);
+
+        cl::Kernel kernel(program, "fma_peak");
+        kernel.setArg(0, out);
+        if (real_size == sizeof(float)) {
+            kernel.setArg(1, 0.999f);
+            kernel.setArg(2, 0.001f);
+        }
+        else {
+            kernel.setArg(1, 0.999);
+            kernel.setArg(2, 0.001);
+        }
+
+        double seconds = best_kernel_seconds(queue, kernel, cl::NDRange(items), cl::NullRange);
+        return 2.0 * FMA_CHAINS * FMA_ITERS * items / seconds / 1.0e9;
+    }
+
+    /// <summary>
+    /// Measures the launch latency and throughput of an empty kernel.
+    /// </summary>
+    inline void measure_launches(cl::CommandQueue& queue, const cl::Program& program, DeviceProfile& p)
+    {
+        cl::Kernel kernel(program, "empty");
+
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1), cl::NullRange);
+        queue.finish();
+
+        // round trip of a single launch
+        double best = 1.0e30;
+        for (int l = 0; l < LAUNCHES / 10; l++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1), cl::NullRange);
+            queue.finish();
+            auto stop = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double>(stop - start).count());
+        }
+        p.launch_latency_us = best * 1.0e6;
+
+        // back to back launches
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int l = 0; l < LAUNCHES; l++)
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1), cl::NullRange);
+        queue.finish();
+        auto stop = std::chrono::high_resolution_clock::now();
+        p.launch_throughput_us = std::chrono::duration<double>(stop - start).count() / LAUNCHES * 1.0e6;
+    }
+
+    /// <summary>
+    /// Measures the read bandwidth of local memory over all compute units.
+    /// </summary>
+    inline double measure_local(const cl::Context& context, cl::CommandQueue& queue, const cl::Program& program,
+        const cl::Device& device)
+    {
+        cl::Kernel kernel(program, "local_read");
+
+        // largest power of two local size up to 256
+        ::size_t limit = std::min<::size_t>(kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device), 256);
+        ::size_t local = 1;
+        while (local * 2 <= limit)
+            local *= 2;
+
+        ::size_t groups = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * 16;
+        ::size_t items = groups * local;
+
+        cl::Buffer out(context, CL_MEM_WRITE_ONLY, sizeof(float) * items);
+        kernel.setArg(0, out);
+        kernel.setArg(1, cl::Local(sizeof(float) * local));
+
+        double seconds = best_kernel_seconds(queue, kernel, cl::NDRange(items), cl::NDRange(local));
+        return (double)sizeof(float) * LOCAL_ITERS * items / seconds / 1.0e9;
+    }
+
+    /// <summary>
+    /// The identification and properties of a device, without measurements
+    /// (all negative).
+    /// </summary>
+    inline DeviceProfile identify(const cl::Platform& platform, const cl::Device& device)
+    {
+        DeviceProfile p;
+        p.platform = platform.getInfo<CL_PLATFORM_NAME>();
+        p.name = device.getInfo<CL_DEVICE_NAME>();
+        p.driver = device.getInfo<CL_DRIVER_VERSION>();
+
+        cl_device_type type = device.getInfo<CL_DEVICE_TYPE>();
+        p.type = (type & CL_DEVICE_TYPE_GPU) ? "GPU" : (type & CL_DEVICE_TYPE_CPU) ? "CPU"
+               : (type & CL_DEVICE_TYPE_ACCELERATOR) ? "ACCELERATOR" : "OTHER";
+
+        p.compute_units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+        p.clock_mhz = device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+        p.global_mem_bytes = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+        p.local_mem_bytes = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+
+        p.h2d_pageable_gbs = p.h2d_pinned_gbs = p.d2h_pageable_gbs = p.d2h_pinned_gbs = -1.0;
+        p.d2d_copy_gbs = p.fp32_gflops = p.fp64_gflops = -1.0;
+        p.launch_latency_us = p.launch_throughput_us = p.local_mem_gbs = -1.0;
+
+        return p;
+    }
+
+    /// <summary>
+    /// Characterizes a device. Measurements that fail stay negative.
+    /// </summary>
+    inline DeviceProfile characterize(const cl::Platform& platform, const cl::Device& device)
+    {
+        DeviceProfile p = identify(platform, device);
+
+        std::vector<cl::Device> devices(1, device);
+        cl::Context context;
+        cl::CommandQueue queue;
+
+        try {
+            context = cl::Context(devices);
+            queue = cl::CommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE);
+        }
+        catch (cl::Error err) {
+            std::cout << "\t\tNo context for the measurements: " << err.what() << std::endl;
+            return p;
+        }
+
+        try {
+            ::size_t bytes = std::min<::size_t>(TRANSFER_BYTES, device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / 2);
+            measure_transfers(context, queue, bytes, p);
+        }
+        catch (cl::Error err) {
+            std::cout << "\t\tTransfer measurement failed: " << err.what() << std::endl;
+        }
+
+        try {
+            cl::Program program(context, KERNEL_SOURCE);
+            program.build(devices, build_options("float").c_str());
+
+            p.fp32_gflops = measure_fma(context, queue, program, device, sizeof(float));
+            measure_launches(queue, program, p);
+            p.local_mem_gbs = measure_local(context, queue, program, device);
+        }
+        catch (cl::Error err) {
+            std::cout << "\t\tKernel measurement failed: " << err.what() << std::endl;
+        }
+
+        // double precision only where the device supports it: before OpenCL 1.2
+        // CL_DEVICE_DOUBLE_FP_CONFIG is an error without cl_khr_fp64
+        if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos) {
+            try {
+                if (device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>() != 0) {
+                    cl::Program program(context, KERNEL_SOURCE);
+                    program.build(devices, (build_options("double") + " -DUSE_DOUBLE").c_str());
+
+                    p.fp64_gflops = measure_fma(context, queue, program, device, sizeof(double));
+                }
+            }
+            catch (cl::Error err) {
+                std::cout << "\t\tFP64 measurement failed: " << err.what() << std::endl;
+            }
+        }
+
+        return p;
+    }
+
+    /// <summary>
+    /// Prints the measurements of a device.
+    /// </summary>
+    inline void print(std::ostream& out, const DeviceProfile& p)
+    {
+        out << "\t\tHost to Device (pageable / pinned): " << p.h2d_pageable_gbs << " / " << p.h2d_pinned_gbs << " GB/s" << std::endl;
+        out << "\t\tDevice to Host (pageable / pinned): " << p.d2h_pageable_gbs << " / " << p.d2h_pinned_gbs << " GB/s" << std::endl;
+        out << "\t\tDevice Copy: " << p.d2d_copy_gbs << " GB/s" << std::endl;
+        out << "\t\tFMA FP32 / FP64: " << p.fp32_gflops << " / " << p.fp64_gflops << " GFLOP/s" << std::endl;
+        out << "\t\tLaunch Latency / Throughput: " << p.launch_latency_us << " / " << p.launch_throughput_us << " us" << std::endl;
+        out << "\t\tLocal Memory: " << p.local_mem_gbs << " GB/s" << std::endl;
+    }
+
+    /// <summary>
+    /// A string as JSON string literal.
+    /// </summary>
+    inline std::string json_string(const std::string& s)
+    {
+        std::string out = "\"";
+        for (::size_t i = 0; i < s.size(); i++) {
+            char c = s[i];
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            }
+            else if ((unsigned char)c < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    /// <summary>
+    /// A measurement as JSON number, null if it was not measured.
+    /// </summary>
+    inline std::string json_number(double value)
+    {
+        if (value < 0.0)
+            return "null";
+
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.6g", value);
+        return number;
+    }
+
+    /// <summary>
+    /// Writes the profiles as JSON: {"version": 1, "devices": [{...}, ...]}.
+    /// </summary>
+    inline void write_json(std::ostream& out, const std::vector<DeviceProfile>& profiles)
+    {
+        out << "{\n  \"version\": 1,\n  \"devices\": [\n";
+
+        for (::size_t d = 0; d < profiles.size(); d++) {
+            const DeviceProfile& p = profiles[d];
+
+            out << "    {\n";
+            out << "      \"platform\": " << json_string(p.platform) << ",\n";
+            out << "      \"name\": " << json_string(p.name) << ",\n";
+            out << "      \"driver\": " << json_string(p.driver) << ",\n";
+            out << "      \"type\": " << json_string(p.type) << ",\n";
+            out << "      \"compute_units\": " << p.compute_units << ",\n";
+            out << "      \"clock_mhz\": " << p.clock_mhz << ",\n";
+            out << "      \"global_mem_bytes\": " << p.global_mem_bytes << ",\n";
+            out << "      \"local_mem_bytes\": " << p.local_mem_bytes << ",\n";
+            out << "      \"h2d_pageable_gbs\": " << json_number(p.h2d_pageable_gbs) << ",\n";
+            out << "      \"h2d_pinned_gbs\": " << json_number(p.h2d_pinned_gbs) << ",\n";
+            out << "      \"d2h_pageable_gbs\": " << json_number(p.d2h_pageable_gbs) << ",\n";
+            out << "      \"d2h_pinned_gbs\": " << json_number(p.d2h_pinned_gbs) << ",\n";
+            out << "      \"d2d_copy_gbs\": " << json_number(p.d2d_copy_gbs) << ",\n";
+            out << "      \"fp32_gflops\": " << json_number(p.fp32_gflops) << ",\n";
+            out << "      \"fp64_gflops\": " << json_number(p.fp64_gflops) << ",\n";
+            out << "      \"launch_latency_us\": " << json_number(p.launch_latency_us) << ",\n";
+            out << "      \"launch_throughput_us\": " << json_number(p.launch_throughput_us) << ",\n";
+            out << "      \"local_mem_gbs\": " << json_number(p.local_mem_gbs) << "\n";
+            out << "    }" << (d + 1 < profiles.size() ? "," : "") << "\n";
+        }
+
+        out << "  ]\n}\n";
+    }
+}
\ No newline at end of file
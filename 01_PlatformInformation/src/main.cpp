@@ -1,13 +1,28 @@
 /**
  * Display Device Information
+ * and characterize the performance of every device:
+ *     PlatformInformation [profile.json]
  */
+
+// enable opencl exceptions
+#define __CL_ENABLE_EXCEPTIONS
+
 #include "CL/cl.hpp"
 #include <iostream>
+#include <fstream>
+#include <string>
 #include <vector>
 #include "config.h"
+#include "characterize.hpp"
 
-int main(void)
+// file the device profiles are written to, unless given on the command line
+#define PROFILE_FILE "device_profile.json"
+
+int main(int argc, char* argv[])
 {
+    std::string profile_file = argc > 1 ? argv[1] : PROFILE_FILE;
+    std::vector<profile::DeviceProfile> profiles;
+
     std::cout << "OpenCL Platforminformation - Version " << 
         PlatformInformation_VERSION_MAJOR << "." << PlatformInformation_VERSION_MINOR << std::endl;
 
@@ -32,9 +47,14 @@ int main(void)
             plat->getInfo(CL_PLATFORM_VERSION, &s);
             std::cout << "\tVersion: " << s << std::endl;
 
-            // Discover number of devices
+            // Discover number of devices, a platform without any reports an error
             std::vector<cl::Device> devices;
-            plat->getDevices(CL_DEVICE_TYPE_ALL, &devices);
+            try {
+                plat->getDevices(CL_DEVICE_TYPE_ALL, &devices);
+            }
+            catch (cl::Error err) {
+                std::cout << "\tNo devices: " << err.what() << " (" << err.err() << ")" << std::endl;
+            }
             std::cout << "\n\tNumber of devices: " << devices.size() << std::endl;
 
             // Investigate each device
@@ -42,41 +62,63 @@ int main(void)
             {
                 std::cout << "\t-------------------------" << std::endl;
 
-                dev->getInfo(CL_DEVICE_NAME, &s);
-                std::cout << "\t\tName: " << s << std::endl;
-
-                dev->getInfo(CL_DEVICE_OPENCL_C_VERSION, &s);
-                std::cout << "\t\tVersion: " << s << std::endl;
+                // a failing device is listed without measurements, the others are still measured
+                try {
+                    dev->getInfo(CL_DEVICE_NAME, &s);
+                    std::cout << "\t\tName: " << s << std::endl;
+
+                    dev->getInfo(CL_DEVICE_OPENCL_C_VERSION, &s);
+                    std::cout << "\t\tVersion: " << s << std::endl;
+
+                    int i;
+                    dev->getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &i);
+                    std::cout << "\t\tMax. Compute Units: " << i << std::endl;
+
+                    size_t size;
+                    dev->getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &size);
+                    std::cout << "\t\tLocal Memory Size: " << size / 1024 << " KB" << std::endl;
+
+                    dev->getInfo(CL_DEVICE_GLOBAL_MEM_SIZE, &size);
+                    std::cout << "\t\tGlobal Memory Size: " << size / (1024 * 1024) << " MB" << std::endl;
+
+                    dev->getInfo(CL_DEVICE_MAX_MEM_ALLOC_SIZE, &size);
+                    std::cout << "\t\tMax Alloc Size: " << size / (1024 * 1024) << " MB" << std::endl;
+
+                    dev->getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &size);
+                    std::cout << "\t\tMax Work-group Total Size: " << size << std::endl;
+
+                    std::vector<size_t> d;
+                    dev->getInfo(CL_DEVICE_MAX_WORK_ITEM_SIZES, &d);
+                    std::cout << "\t\tMax Work-group Dims: (";
+                    for (std::vector<size_t>::iterator st = d.begin(); st != d.end(); st++)
+                        std::cout << *st << " ";
+                    std::cout << "\x08)" << std::endl;
+
+                    // measured performance
+                    std::cout << "\t\tMeasuring..." << std::endl;
+                    profiles.push_back(profile::characterize(*plat, *dev));
+                    profile::print(std::cout, profiles.back());
+                }
+                catch (cl::Error err) {
+                    std::cout << "\t\tOpenCL Error: " << err.what() << " (" << err.err() << "), device not measured" << std::endl;
+                    try {
+                        profiles.push_back(profile::identify(*plat, *dev));
+                    }
+                    catch (cl::Error) {
+                    }
+                }
 
-                int i;
-                dev->getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &i);
-                std::cout << "\t\tMax. Compute Units: " << i << std::endl;
-
-                size_t size;
-                dev->getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &size);
-                std::cout << "\t\tLocal Memory Size: " << size / 1024 << " KB" << std::endl;
-
-                dev->getInfo(CL_DEVICE_GLOBAL_MEM_SIZE, &size);
-                std::cout << "\t\tGlobal Memory Size: " << size / (1024 * 1024) << " MB" << std::endl;
-
-                dev->getInfo(CL_DEVICE_MAX_MEM_ALLOC_SIZE, &size);
-                std::cout << "\t\tMax Alloc Size: " << size / (1024 * 1024) << " MB" << std::endl;
-
-                dev->getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &size);
-                std::cout << "\t\tMax Work-group Total Size: " << size << std::endl;
-
-                std::vector<size_t> d;
-                dev->getInfo(CL_DEVICE_MAX_WORK_ITEM_SIZES, &d);
-                std::cout << "\t\tMax Work-group Dims: (";
-                for (std::vector<size_t>::iterator st = d.begin(); st != d.end(); st++)
-                    std::cout << *st << " ";
-                std::cout << "\x08)" << std::endl;
 
                 std::cout << "\t-------------------------" << std::endl;
             }
             std::cout << "\n-------------------------\n";
         }
 
+        // machine readable profile of all devices
+        std::ofstream json(profile_file.c_str());
+        profile::write_json(json, profiles);
+        std::cout << "\nDevice profiles written to " << profile_file << std::endl;
+
     } catch (std::exception e) {
         // catch errors and print error data
         std::cout << "OpenCL Error:" << e.what() << " returned " << std::endl;
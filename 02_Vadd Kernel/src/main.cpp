@@ -9,9 +9,11 @@
 
 #include "CL/cl.hpp"
 
+#include <chrono>
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 
 #include <iostream>
@@ -37,11 +39,30 @@ clock_t t;
 #define TOL    (0.001)   // tolerance used in floating point comparisons
 #define LENGTH (1024)    // length of vectors a, b, and c
 
+#define LAUNCHES      (1000)    // launches per launch overhead measurement
+#define TINY          (64)      // work-items of the tiny kernel launch
+#define REQUESTS      (1024)    // small vadd requests of the batching mode
+#define MAX_REQUEST   (256)     // largest request, in elements
+#define REQUEST_ALIGN (64)      // requests start at multiples of REQUEST_ALIGN elements
+
 // --------------------------------------------------------------------------------------
 // kernel: vadd 
 // Purpose: compute the elementwise sum c = a + b
 // input: a and b float vectors of length count
 // output: c float vector of length count holding the sum a + b
+//
+// kernel: empty
+// Purpose: does nothing, the cost of its launch is pure overhead
+//
+// kernel: vadd_batched
+// Purpose: many small vadd requests in one launch; request r has
+//          first[r+1] - first[r] elements starting at element offset[r]
+//          of the buffers, work-item i finds its request by a binary
+//          search of the first table
+// input: a and b float vectors, the tables first (requests + 1 entries)
+//        and offset (requests entries)
+// output: c float vector holding a + b for the elements of all requests
+//
 
 const char *KernelSource = "\n" \
 "__kernel void vadd(                                                 \n" \
@@ -54,6 +75,30 @@ const char *KernelSource = "\n" \
 "   if(i < count)                                                       \n" \
 "       c[i] = a[i] + b[i];                                             \n" \
 "}                                                                      \n" \
+"\n" \
+"__kernel void empty(void)                                              \n" \
+"{                                                                      \n" \
+"}                                                                      \n" \
+"\n" \
+"__kernel void vadd_batched(                                            \n" \
+"   __global float* a,                                                  \n" \
+"   __global float* b,                                                  \n" \
+"   __global float* c,                                                  \n" \
+"   __global const unsigned int* first,                                 \n" \
+"   __global const unsigned int* offset,                                \n" \
+"   const unsigned int requests)                                        \n" \
+"{                                                                      \n" \
+"   unsigned int i = get_global_id(0);                                  \n" \
+"   if(i >= first[requests])                                            \n" \
+"       return;                                                         \n" \
+"   unsigned int lo = 0, hi = requests;                                 \n" \
+"   while(hi - lo > 1) {                                                \n" \
+"       unsigned int mid = (lo + hi) / 2;                               \n" \
+"       if(first[mid] <= i) lo = mid; else hi = mid;                    \n" \
+"   }                                                                   \n" \
+"   unsigned int j = offset[lo] + i - first[lo];                        \n" \
+"   c[j] = a[j] + b[j];                                                 \n" \
+"}                                                                      \n" \
 "\n";
 
 // --------------------------------------------------------------------------------------
@@ -169,6 +214,90 @@ int output_device_info(cl_device_id device_id)
 
 #define checkError(E, S) check_error(E,S,__FILE__,__LINE__)
 
+// host clock in microseconds
+double host_us()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+// duration between two profiling counters of the event in microseconds
+double event_us(cl_event event, cl_profiling_info from, cl_profiling_info to)
+{
+    cl_ulong t0, t1;
+    int err = clGetEventProfilingInfo(event, from, sizeof(cl_ulong), &t0, NULL);
+    err |= clGetEventProfilingInfo(event, to, sizeof(cl_ulong), &t1, NULL);
+    checkError(err, "Reading profiling info");
+    return (t1 - t0) / 1000.0;
+}
+
+// launch overhead of a kernel, averages in microseconds
+struct launch_overhead
+{
+    double enqueue_to_start;    // queued until the kernel starts (device clock)
+    double execution;           // start until end (device clock)
+    double notification;        // end until the waiting host returns
+    double per_launch;          // host time per launch of a burst of launches
+};
+
+// measures the launch overhead of the kernel (with its arguments set) on a
+// queue with profiling enabled. flush: clFlush after every enqueue, else the
+// launches are only submitted by the wait.
+// The host and device clocks are not related in OpenCL 1.2, so the
+// notification is the host round trip minus the device time from queued to end.
+struct launch_overhead measure_launches(cl_command_queue queue, cl_kernel kernel, size_t global, int flush)
+{
+    int err;
+    struct launch_overhead result = { 0.0, 0.0, 0.0, 0.0 };
+    cl_event* events = (cl_event*)malloc(sizeof(cl_event) * LAUNCHES);
+
+    // warm up
+    err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+    checkError(err, "Enqueueing kernel");
+    err = clFinish(queue);
+    checkError(err, "Waiting for kernel to finish");
+
+    // single launches, the host waits for every one
+    for (int l = 0; l < LAUNCHES; l++)
+    {
+        double t0 = host_us();
+
+        err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global, NULL, 0, NULL, &events[l]);
+        checkError(err, "Enqueueing kernel");
+        if (flush)
+            clFlush(queue);
+
+        err = clWaitForEvents(1, &events[l]);
+        checkError(err, "Waiting for kernel to finish");
+
+        double round_trip = host_us() - t0;
+
+        result.enqueue_to_start += event_us(events[l], CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_START) / LAUNCHES;
+        result.execution += event_us(events[l], CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END) / LAUNCHES;
+        result.notification += (round_trip - event_us(events[l], CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_END)) / LAUNCHES;
+
+        clReleaseEvent(events[l]);
+    }
+
+    // a burst of launches, the host waits once
+    double t0 = host_us();
+
+    for (int l = 0; l < LAUNCHES; l++)
+    {
+        err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &global, NULL, 0, NULL, NULL);
+        checkError(err, "Enqueueing kernel");
+        if (flush)
+            clFlush(queue);
+    }
+
+    err = clFinish(queue);
+    checkError(err, "Waiting for kernel to finish");
+
+    result.per_launch = (host_us() - t0) / LAUNCHES;
+
+    free(events);
+    return result;
+}
+
 int main(void)
 {
     // Print Programm Infos
@@ -371,6 +500,170 @@ int main(void)
         // summarise the results 
         std::cout << "C = A+B: " << correct << " out of " << count << " results were correct.\n" << std::endl;
 
+        // 08. launch overhead
+        // -------------------
+
+        // a queue with profiling enabled for the device timestamps of the launches
+        cl_command_queue profiling = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &err);
+        checkError(err, "Creating profiling command queue");
+
+        cl_kernel ko_empty = clCreateKernel(program, "empty", &err);
+        checkError(err, "Creating kernel");
+
+        // the tiny launch is vadd on the first TINY elements
+        cl_kernel ko_tiny = clCreateKernel(program, "vadd", &err);
+        checkError(err, "Creating kernel");
+
+        unsigned int tiny = TINY;
+        err = clSetKernelArg(ko_tiny, 0, sizeof(cl_mem), &d_a);
+        err |= clSetKernelArg(ko_tiny, 1, sizeof(cl_mem), &d_b);
+        err |= clSetKernelArg(ko_tiny, 2, sizeof(cl_mem), &d_c);
+        err |= clSetKernelArg(ko_tiny, 3, sizeof(unsigned int), &tiny);
+        checkError(err, "Setting kernel arguments");
+
+        printf("Launch overhead, average of %d launches in microseconds\n", LAUNCHES);
+        printf("%-16s %-9s %17s %10s %13s %11s\n", "kernel", "flush", "enqueue to start", "execution", "notification", "per launch");
+
+        for (int k = 0; k < 2; k++)
+        {
+            for (int flush = 1; flush >= 0; flush--)
+            {
+                struct launch_overhead o = k == 0
+                    ? measure_launches(profiling, ko_empty, 1, flush)
+                    : measure_launches(profiling, ko_tiny, TINY, flush);
+
+                printf("%-16s %-9s %17.2f %10.2f %13.2f %11.2f\n", k == 0 ? "empty" : "vadd (64 items)",
+                    flush ? "each" : "none", o.enqueue_to_start, o.execution, o.notification, o.per_launch);
+            }
+        }
+        printf("\n");
+
+        // 09. launch batching
+        // -------------------
+
+        // many small vadd requests, placed in the buffers at aligned offsets.
+        // Unbatched every request is a launch of vadd with a global work offset,
+        // batched all requests are one launch of vadd_batched, which finds the
+        // request of a work-item in the offset table
+        unsigned int* h_first = (unsigned int*)calloc(REQUESTS + 1, sizeof(unsigned int));   // first work-item of each request
+        unsigned int* h_offset = (unsigned int*)calloc(REQUESTS, sizeof(unsigned int));      // first element of each request
+        unsigned int elements = 0;                                                           // length of the buffers
+
+        for (int r = 0; r < REQUESTS; r++)
+        {
+            unsigned int n = 1 + rand() % MAX_REQUEST;
+            h_offset[r] = elements;
+            h_first[r + 1] = h_first[r] + n;
+            elements += (n + REQUEST_ALIGN - 1) / REQUEST_ALIGN * REQUEST_ALIGN;
+        }
+
+        float* h_ra = (float*)calloc(elements, sizeof(float));
+        float* h_rb = (float*)calloc(elements, sizeof(float));
+        float* h_rc = (float*)calloc(elements, sizeof(float));
+
+        for (unsigned int i = 0; i < elements; i++) {
+            h_ra[i] = rand() / (float)RAND_MAX;
+            h_rb[i] = rand() / (float)RAND_MAX;
+        }
+
+        cl_mem d_ra = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * elements, h_ra, &err);
+        checkError(err, "Creating buffer d_ra");
+        cl_mem d_rb = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * elements, h_rb, &err);
+        checkError(err, "Creating buffer d_rb");
+        cl_mem d_rc = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * elements, NULL, &err);
+        checkError(err, "Creating buffer d_rc");
+        cl_mem d_first = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(unsigned int) * (REQUESTS + 1), h_first, &err);
+        checkError(err, "Creating buffer d_first");
+        cl_mem d_offset = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(unsigned int) * REQUESTS, h_offset, &err);
+        checkError(err, "Creating buffer d_offset");
+
+        cl_kernel ko_batched = clCreateKernel(program, "vadd_batched", &err);
+        checkError(err, "Creating kernel");
+
+        unsigned int requests = REQUESTS;
+        err = clSetKernelArg(ko_batched, 0, sizeof(cl_mem), &d_ra);
+        err |= clSetKernelArg(ko_batched, 1, sizeof(cl_mem), &d_rb);
+        err |= clSetKernelArg(ko_batched, 2, sizeof(cl_mem), &d_rc);
+        err |= clSetKernelArg(ko_batched, 3, sizeof(cl_mem), &d_first);
+        err |= clSetKernelArg(ko_batched, 4, sizeof(cl_mem), &d_offset);
+        err |= clSetKernelArg(ko_batched, 5, sizeof(unsigned int), &requests);
+        checkError(err, "Setting kernel arguments");
+
+        err = clSetKernelArg(ko_tiny, 0, sizeof(cl_mem), &d_ra);
+        err |= clSetKernelArg(ko_tiny, 1, sizeof(cl_mem), &d_rb);
+        err |= clSetKernelArg(ko_tiny, 2, sizeof(cl_mem), &d_rc);
+        checkError(err, "Setting kernel arguments");
+
+        for (int batched = 0; batched < 2; batched++)
+        {
+            // clear the results
+            memset(h_rc, 0, sizeof(float) * elements);
+            err = clEnqueueWriteBuffer(commands, d_rc, CL_TRUE, 0, sizeof(float) * elements, h_rc, 0, NULL, NULL);
+            checkError(err, "Clearing d_rc");
+
+            double t0 = host_us();
+
+            if (batched)
+            {
+                global = h_first[REQUESTS];
+                err = clEnqueueNDRangeKernel(commands, ko_batched, 1, NULL, &global, NULL, 0, NULL, NULL);
+                checkError(err, "Enqueueing kernel");
+            }
+            else
+            {
+                for (int r = 0; r < REQUESTS; r++)
+                {
+                    // global ids start at the offset of the request, vadd compares them to the end
+                    size_t offset = h_offset[r];
+                    unsigned int end = h_offset[r] + h_first[r + 1] - h_first[r];
+                    global = h_first[r + 1] - h_first[r];
+
+                    err = clSetKernelArg(ko_tiny, 3, sizeof(unsigned int), &end);
+                    checkError(err, "Setting kernel arguments");
+                    err = clEnqueueNDRangeKernel(commands, ko_tiny, 1, &offset, &global, NULL, 0, NULL, NULL);
+                    checkError(err, "Enqueueing kernel");
+                }
+            }
+
+            err = clFinish(commands);
+            checkError(err, "Waiting for kernel to finish");
+
+            double time_us = host_us() - t0;
+
+            err = clEnqueueReadBuffer(commands, d_rc, CL_TRUE, 0, sizeof(float) * elements, h_rc, 0, NULL, NULL);
+            checkError(err, "Reading back d_rc");
+
+            // test the results
+            correct = 0;
+            for (int r = 0; r < REQUESTS; r++) {
+                for (unsigned int i = h_offset[r]; i < h_offset[r] + h_first[r + 1] - h_first[r]; i++) {
+                    tmp = h_ra[i] + h_rb[i] - h_rc[i];
+                    if (tmp * tmp < TOL * TOL)
+                        correct++;
+                }
+            }
+
+            std::cout << (batched ? "Batched: 1 launch for " : "Unbatched: 1 launch per request, ") << REQUESTS
+                      << " requests in " << time_us << " microseconds, " << correct << " out of "
+                      << h_first[REQUESTS] << " results were correct." << std::endl;
+        }
+
+        clReleaseMemObject(d_ra);
+        clReleaseMemObject(d_rb);
+        clReleaseMemObject(d_rc);
+        clReleaseMemObject(d_first);
+        clReleaseMemObject(d_offset);
+        clReleaseKernel(ko_empty);
+        clReleaseKernel(ko_tiny);
+        clReleaseKernel(ko_batched);
+        clReleaseCommandQueue(profiling);
+
+        free(h_first);
+        free(h_offset);
+        free(h_ra);
+        free(h_rb);
+        free(h_rc);
+
         // cleanup then shutdown
         clReleaseMemObject(d_a);
         clReleaseMemObject(d_b);
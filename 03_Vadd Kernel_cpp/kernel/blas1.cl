@@ -0,0 +1,473 @@
+// --------------------------------------------------------------------------------------
+// BLAS level 1 kernels
+// Purpose: the vector operations of BLAS level 1 (axpy, scal, copy, swap, dot,
+//          nrm2, asum, iamax) and generic element-wise map / zip, specialized
+//          at build time:
+//
+//              -DT=float|double        element type, the options of ocl::ElementType
+//              -DVW=1|2|4|8|16         elements per load and store
+//              #define MAP(x) ...      the function of map (prepended to the source)
+//              #define ZIP(x, y) ...   the function of zip (prepended to the source)
+//
+//          Vectors are passed as Tn pointers and hold n elements; the
+//          n % VW elements after the last full vector are handled one per
+//          work item through the scalar view. The host launches
+//          max(n / VW, n % VW) work items for the element-wise kernels,
+//          padded to whole work groups.
+//
+//          Reductions run in two passes: every work group reduces a strided
+//          share of the vector to a partial result with a tree reduction in
+//          local memory, a single work group then reduces the partials. Work
+//          group sizes are powers of two.
+//
+
+// built with the prelude of ocl::typedSource, which enables fp64 for double
+#ifndef T
+#define T float
+#endif
+
+#ifndef VW
+#define VW 1
+#endif
+
+#define CAT_(a, b) a##b
+#define CAT(a, b) CAT_(a, b)
+
+// the vector type and the sum of its components
+#define HSUM2(v) ((v).s0 + (v).s1)
+#define HSUM4(v) (HSUM2((v).lo) + HSUM2((v).hi))
+#define HSUM8(v) (HSUM4((v).lo) + HSUM4((v).hi))
+#define HSUM16(v) (HSUM8((v).lo) + HSUM8((v).hi))
+
+#if VW == 1
+#define VTYPE T
+#define HSUM(v) (v)
+#else
+#define VTYPE CAT(T, VW)
+#define HSUM(v) CAT(HSUM, VW)(v)
+#endif
+
+// index of the i-th element after the last full vector
+#define TAIL(i, n) ((n) / VW * VW + (i))
+
+// --------------------------------------------------------------------------------------
+// Purpose: tree reduction of one value per work item
+//
+// input: local T* scratch one element per work item
+//        T value the value of the work item
+//
+// output: the sum over the work group, in every work item
+//
+
+T group_sum(
+	__local T*	scratch,
+	T			value)
+{
+	uint lid = get_local_id(0);
+
+	scratch[lid] = value;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (uint offset = get_local_size(0) / 2; offset > 0; offset /= 2) {
+		if (lid < offset)
+			scratch[lid] += scratch[lid + offset];
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	return scratch[0];
+}
+
+// --------------------------------------------------------------------------------------
+// Purpose: tree reduction to the largest magnitude and its index, the smallest
+//          index wins among equal magnitudes
+//
+// input: local T* values, uint* indices one element per work item
+//        T value, uint index the candidate of the work item
+//
+// output: the index of the largest magnitude over the work group, in every work item
+//
+
+uint group_argmax(
+	__local T*	values,
+	__local uint*	indices,
+	T			value,
+	uint			index)
+{
+	uint lid = get_local_id(0);
+
+	values[lid] = value;
+	indices[lid] = index;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (uint offset = get_local_size(0) / 2; offset > 0; offset /= 2) {
+		if (lid < offset) {
+			T other = values[lid + offset];
+			uint other_index = indices[lid + offset];
+
+			if (other > values[lid] || (other == values[lid] && other_index < indices[lid])) {
+				values[lid] = other;
+				indices[lid] = other_index;
+			}
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	return indices[0];
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: axpy
+// Purpose: y = alpha * x + y
+// input: T alpha, x and y vectors of length n
+// output: y
+//
+
+__kernel void axpy(
+	const T				alpha,
+	__global const VTYPE*	x,
+	__global VTYPE*			y,
+	const uint				n)
+{
+	uint i = get_global_id(0);
+
+	if (i < n / VW)
+		y[i] = alpha * x[i] + y[i];
+
+	if (i < n % VW) {
+		__global const T* xs = (__global const T*)x;
+		__global T* ys = (__global T*)y;
+		ys[TAIL(i, n)] = alpha * xs[TAIL(i, n)] + ys[TAIL(i, n)];
+	}
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: scal
+// Purpose: x = alpha * x
+// input: T alpha, x vector of length n
+// output: x
+//
+
+__kernel void scal(
+	const T		alpha,
+	__global VTYPE*	x,
+	const uint		n)
+{
+	uint i = get_global_id(0);
+
+	if (i < n / VW)
+		x[i] = alpha * x[i];
+
+	if (i < n % VW) {
+		__global T* xs = (__global T*)x;
+		xs[TAIL(i, n)] = alpha * xs[TAIL(i, n)];
+	}
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: copy
+// Purpose: y = x
+// input: x vector of length n
+// output: y vector of length n
+//
+
+__kernel void copy(
+	__global const VTYPE*	x,
+	__global VTYPE*			y,
+	const uint				n)
+{
+	uint i = get_global_id(0);
+
+	if (i < n / VW)
+		y[i] = x[i];
+
+	if (i < n % VW)
+		((__global T*)y)[TAIL(i, n)] = ((__global const T*)x)[TAIL(i, n)];
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: swap
+// Purpose: exchanges x and y
+// input: x and y vectors of length n
+// output: x and y
+//
+
+__kernel void swap(
+	__global VTYPE*	x,
+	__global VTYPE*	y,
+	const uint		n)
+{
+	uint i = get_global_id(0);
+
+	if (i < n / VW) {
+		VTYPE tmp = x[i];
+		x[i] = y[i];
+		y[i] = tmp;
+	}
+
+	if (i < n % VW) {
+		__global T* xs = (__global T*)x;
+		__global T* ys = (__global T*)y;
+		T tmp = xs[TAIL(i, n)];
+		xs[TAIL(i, n)] = ys[TAIL(i, n)];
+		ys[TAIL(i, n)] = tmp;
+	}
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: dot_partial
+// Purpose: first pass of dot, sum of x[i] * y[i] over the share of each work group
+// input: x and y vectors of length n, local T* one element per work item
+// output: partials one sum per work group
+//
+
+__kernel void dot_partial(
+	__global const VTYPE*	x,
+	__global const VTYPE*	y,
+	const uint				n,
+	__local T*			scratch,
+	__global T*			partials)
+{
+	uint gid = get_global_id(0);
+	VTYPE acc = (VTYPE)((T)0);
+
+	for (uint i = gid; i < n / VW; i += get_global_size(0))
+		acc += x[i] * y[i];
+
+	T sum = HSUM(acc);
+	if (gid < n % VW)
+		sum += ((__global const T*)x)[TAIL(gid, n)] * ((__global const T*)y)[TAIL(gid, n)];
+
+	sum = group_sum(scratch, sum);
+	if (get_local_id(0) == 0)
+		partials[get_group_id(0)] = sum;
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: nrm2_partial
+// Purpose: first pass of nrm2, sum of (x[i] / scale)^2 over the share of each
+//          work group, scale the largest magnitude, so that no square over-
+//          or underflows
+// input: x vector of length n, amax the index of the largest magnitude (iamax),
+//        local T* one element per work item
+// output: partials one sum per work group
+//
+
+__kernel void nrm2_partial(
+	__global const VTYPE*	x,
+	const uint				n,
+	__global const uint*	amax,
+	__local T*			scratch,
+	__global T*			partials)
+{
+	uint gid = get_global_id(0);
+	T scale = fabs(((__global const T*)x)[amax[0]]);
+	VTYPE acc = (VTYPE)((T)0);
+
+	// a zero vector sums to zero
+	if (scale > 0) {
+		for (uint i = gid; i < n / VW; i += get_global_size(0)) {
+			VTYPE v = x[i] / scale;
+			acc += v * v;
+		}
+	}
+
+	T sum = HSUM(acc);
+	if (gid < n % VW && scale > 0) {
+		T v = ((__global const T*)x)[TAIL(gid, n)] / scale;
+		sum += v * v;
+	}
+
+	sum = group_sum(scratch, sum);
+	if (get_local_id(0) == 0)
+		partials[get_group_id(0)] = sum;
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: nrm2_partials
+// Purpose: second pass of nrm2, run by a single work group
+// input: partials of count work groups, x and amax as for nrm2_partial,
+//        local T* one element per work item
+// output: result scale * sqrt(sum of the partials)
+//
+
+__kernel void nrm2_partials(
+	__global const T*	partials,
+	const uint				count,
+	__global const T*	x,
+	__global const uint*	amax,
+	__local T*			scratch,
+	__global T*			result)
+{
+	T sum = 0;
+
+	for (uint i = get_local_id(0); i < count; i += get_local_size(0))
+		sum += partials[i];
+
+	sum = group_sum(scratch, sum);
+	if (get_local_id(0) == 0)
+		result[0] = fabs(x[amax[0]]) * sqrt(sum);
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: asum_partial
+// Purpose: first pass of asum, sum of |x[i]| over the share of each work group
+// input: x vector of length n, local T* one element per work item
+// output: partials one sum per work group
+//
+
+__kernel void asum_partial(
+	__global const VTYPE*	x,
+	const uint				n,
+	__local T*			scratch,
+	__global T*			partials)
+{
+	uint gid = get_global_id(0);
+	VTYPE acc = (VTYPE)((T)0);
+
+	for (uint i = gid; i < n / VW; i += get_global_size(0))
+		acc += fabs(x[i]);
+
+	T sum = HSUM(acc);
+	if (gid < n % VW)
+		sum += fabs(((__global const T*)x)[TAIL(gid, n)]);
+
+	sum = group_sum(scratch, sum);
+	if (get_local_id(0) == 0)
+		partials[get_group_id(0)] = sum;
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: sum_partials
+// Purpose: second pass of dot and asum, run by a single work group
+// input: partials of count work groups, local T* one element per work item
+// output: result the reduced value
+//
+
+__kernel void sum_partials(
+	__global const T*	partials,
+	const uint				count,
+	__local T*			scratch,
+	__global T*			result)
+{
+	T sum = 0;
+
+	for (uint i = get_local_id(0); i < count; i += get_local_size(0))
+		sum += partials[i];
+
+	sum = group_sum(scratch, sum);
+	if (get_local_id(0) == 0)
+		result[0] = sum;
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: iamax_partial
+// Purpose: first pass of iamax, the first index of the largest |x[i]| over the
+//          share of each work group
+// input: x vector of length n, local T* and uint* one element per work item
+// output: values and indices one candidate per work group
+//
+
+__kernel void iamax_partial(
+	__global const T*	x,
+	const uint				n,
+	__local T*			scratch_values,
+	__local uint*			scratch_indices,
+	__global T*			values,
+	__global uint*			indices)
+{
+	// increasing indices, the first of equal magnitudes is kept
+	T best = -1;
+	uint best_index = n;
+
+	for (uint i = get_global_id(0); i < n; i += get_global_size(0)) {
+		T v = fabs(x[i]);
+		if (v > best) {
+			best = v;
+			best_index = i;
+		}
+	}
+
+	uint index = group_argmax(scratch_values, scratch_indices, best, best_index);
+	if (get_local_id(0) == 0) {
+		values[get_group_id(0)] = scratch_values[0];
+		indices[get_group_id(0)] = index;
+	}
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: iamax_partials
+// Purpose: second pass of iamax, run by a single work group
+// input: values and indices of count work groups, local T* and uint* one
+//        element per work item
+// output: result the index of the largest magnitude
+//
+
+__kernel void iamax_partials(
+	__global const T*	values,
+	__global const uint*	indices,
+	const uint				count,
+	__local T*			scratch_values,
+	__local uint*			scratch_indices,
+	__global uint*			result)
+{
+	T best = -1;
+	uint best_index = 0xFFFFFFFF;
+
+	for (uint i = get_local_id(0); i < count; i += get_local_size(0)) {
+		if (values[i] > best || (values[i] == best && indices[i] < best_index)) {
+			best = values[i];
+			best_index = indices[i];
+		}
+	}
+
+	uint index = group_argmax(scratch_values, scratch_indices, best, best_index);
+	if (get_local_id(0) == 0)
+		result[0] = index;
+}
+
+#ifdef MAP
+// --------------------------------------------------------------------------------------
+// kernel: map
+// Purpose: y = MAP(x) element-wise
+// input: x vector of length n
+// output: y vector of length n
+//
+
+__kernel void map(
+	__global const VTYPE*	x,
+	__global VTYPE*			y,
+	const uint				n)
+{
+	uint i = get_global_id(0);
+
+	if (i < n / VW)
+		y[i] = MAP(x[i]);
+
+	if (i < n % VW)
+		((__global T*)y)[TAIL(i, n)] = MAP(((__global const T*)x)[TAIL(i, n)]);
+}
+#endif
+
+#ifdef ZIP
+// --------------------------------------------------------------------------------------
+// kernel: zip
+// Purpose: z = ZIP(x, y) element-wise
+// input: x and y vectors of length n
+// output: z vector of length n
+//
+
+__kernel void zip(
+	__global const VTYPE*	x,
+	__global const VTYPE*	y,
+	__global VTYPE*			z,
+	const uint				n)
+{
+	uint i = get_global_id(0);
+
+	if (i < n / VW)
+		z[i] = ZIP(x[i], y[i]);
+
+	if (i < n % VW)
+		((__global T*)z)[TAIL(i, n)] = ZIP(((__global const T*)x)[TAIL(i, n)], ((__global const T*)y)[TAIL(i, n)]);
+}
+#endif
\ No newline at end of file
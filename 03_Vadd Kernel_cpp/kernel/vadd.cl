@@ -1,17 +1,18 @@
 // --------------------------------------------------------------------------------------
 // kernel: vadd 
-// Purpose: compute the elementwise sum c = a + b
-// input: a and b float vectors of length count
-// output: c float vector of length count holding the sum a + b
+// Purpose: compute the elementwise sum c = a + b for any element type T,
+//          built for a type by ocl::typedProgram (common/src/typed_program.hpp)
+// input: a and b T vectors of length count
+// output: c T vector of length count holding the sum a + b
 //
 
 __kernel void vadd(
-	__global float* a,
-	__global float* b,
-	__global float* c,
+	__global const T* a,
+	__global const T* b,
+	__global T* c,
 	const unsigned int count)
 {
 	int i = get_global_id(0);
 	if (i < count)
-		c[i] = a[i] + b[i];
+		STORE(LOAD(a, i) + LOAD(b, i), c, i);
 }
\ No newline at end of file
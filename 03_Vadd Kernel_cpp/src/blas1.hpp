@@ -0,0 +1,297 @@
+//------------------------------------------------------------------------------
+//
+//  BLAS level 1
+//
+//  The vector operations of BLAS level 1 and generic element-wise map / zip
+//  on float or double vectors in device memory, generalizing vadd. The
+//  kernels (kernel/blas1.cl) are type-generic (typed_program.hpp) and
+//  specialized for the element type and the number of elements per load
+//  and store (the vector width), every specialization is built once by the
+//  shared runtime.
+//
+//  Reductions (dot, nrm2, asum, iamax) run two kernels, a tree reduction
+//  per work group and one over the partial results, and block until the
+//  result is read back. nrm2 runs those of iamax first and sums the squares
+//  relative to the largest magnitude.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+#include "typed_program.hpp"
+#include "launch.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace blas1 {
+
+    /// <summary>
+    /// The level 1 operations on vectors of T, cl_float or cl_double.
+    /// </summary>
+    template<typename T>
+    class Level1
+    {
+    public:
+        /// <summary>
+        /// Builds the kernels for the device.
+        /// </summary>
+        /// <param name="device">The device</param>
+        /// <param name="queue">The queue the kernels are enqueued on</param>
+        /// <param name="path">The kernel file (kernel/blas1.cl)</param>
+        /// <param name="width">Elements per load and store: 1, 2, 4, 8 or 16</param>
+        Level1(const cl::Device& device, cl::CommandQueue& queue, const std::string& path, unsigned width = 4)
+            : device_(device), queue_(queue), width_(width), source_(ocl::typedSource(path)),
+              options_(ocl::typedOptions<T>("-DVW=" + std::to_string(width)))
+        {
+            ocl::Runtime& runtime = ocl::Runtime::instance();
+            program_ = runtime.programFromSource(device, source_, options_);
+
+            // power of two work groups for the tree reductions
+            ::size_t limit = std::min<::size_t>(256, cl::Kernel(program_, "dot_partial").getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+            group_size_ = 1;
+            while (group_size_ * 2 <= limit)
+                group_size_ *= 2;
+
+            // a few groups per compute unit, the partials fit one group of the second pass
+            groups_ = std::min<::size_t>(4 * device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>(), group_size_);
+
+            cl::Context& context = runtime.context(device);
+            partials_ = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T) * groups_);
+            partial_indices_ = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * groups_);
+            result_ = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(T));
+            index_ = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint));
+        }
+
+        unsigned width() const { return width_; }
+
+        /// <summary>
+        /// y = alpha * x + y
+        /// </summary>
+        void axpy(T alpha, const cl::Buffer& x, const cl::Buffer& y, ::size_t n)
+        {
+            cl::Kernel& k = kernel("axpy");
+            k.setArg(0, alpha);
+            k.setArg(1, x);
+            k.setArg(2, y);
+            k.setArg(3, (cl_uint)n);
+            elementwise(k, n);
+        }
+
+        /// <summary>
+        /// x = alpha * x
+        /// </summary>
+        void scal(T alpha, const cl::Buffer& x, ::size_t n)
+        {
+            cl::Kernel& k = kernel("scal");
+            k.setArg(0, alpha);
+            k.setArg(1, x);
+            k.setArg(2, (cl_uint)n);
+            elementwise(k, n);
+        }
+
+        /// <summary>
+        /// y = x
+        /// </summary>
+        void copy(const cl::Buffer& x, const cl::Buffer& y, ::size_t n)
+        {
+            cl::Kernel& k = kernel("copy");
+            k.setArg(0, x);
+            k.setArg(1, y);
+            k.setArg(2, (cl_uint)n);
+            elementwise(k, n);
+        }
+
+        /// <summary>
+        /// Exchanges x and y.
+        /// </summary>
+        void swap(const cl::Buffer& x, const cl::Buffer& y, ::size_t n)
+        {
+            cl::Kernel& k = kernel("swap");
+            k.setArg(0, x);
+            k.setArg(1, y);
+            k.setArg(2, (cl_uint)n);
+            elementwise(k, n);
+        }
+
+        /// <summary>
+        /// Sum of x[i] * y[i].
+        /// </summary>
+        T dot(const cl::Buffer& x, const cl::Buffer& y, ::size_t n)
+        {
+            cl::Kernel& k = kernel("dot_partial");
+            k.setArg(0, x);
+            k.setArg(1, y);
+            k.setArg(2, (cl_uint)n);
+            k.setArg(3, cl::Local(sizeof(T) * group_size_));
+            k.setArg(4, partials_);
+            return reduce(k);
+        }
+
+        /// <summary>
+        /// Euclidean norm of x. The squares are summed relative to the
+        /// largest magnitude (found as by iamax), so the norm of vectors with
+        /// elements beyond the square root of the largest or smallest T
+        /// neither overflows nor vanishes; x is read twice.
+        /// </summary>
+        T nrm2(const cl::Buffer& x, ::size_t n)
+        {
+            if (n == 0)
+                return 0;
+
+            argmax(x, n);
+
+            cl::Kernel& partial = kernel("nrm2_partial");
+            partial.setArg(0, x);
+            partial.setArg(1, (cl_uint)n);
+            partial.setArg(2, index_);
+            partial.setArg(3, cl::Local(sizeof(T) * group_size_));
+            partial.setArg(4, partials_);
+            queue_.enqueueNDRangeKernel(partial, cl::NullRange, cl::NDRange(groups_ * group_size_), cl::NDRange(group_size_));
+
+            cl::Kernel& final_pass = kernel("nrm2_partials");
+            final_pass.setArg(0, partials_);
+            final_pass.setArg(1, (cl_uint)groups_);
+            final_pass.setArg(2, x);
+            final_pass.setArg(3, index_);
+            final_pass.setArg(4, cl::Local(sizeof(T) * group_size_));
+            final_pass.setArg(5, result_);
+            queue_.enqueueNDRangeKernel(final_pass, cl::NullRange, cl::NDRange(group_size_), cl::NDRange(group_size_));
+
+            T result;
+            queue_.enqueueReadBuffer(result_, CL_TRUE, 0, sizeof(T), &result);
+            return result;
+        }
+
+        /// <summary>
+        /// Sum of |x[i]|.
+        /// </summary>
+        T asum(const cl::Buffer& x, ::size_t n)
+        {
+            cl::Kernel& k = kernel("asum_partial");
+            k.setArg(0, x);
+            k.setArg(1, (cl_uint)n);
+            k.setArg(2, cl::Local(sizeof(T) * group_size_));
+            k.setArg(3, partials_);
+            return reduce(k);
+        }
+
+        /// <summary>
+        /// Index of the first element of the largest magnitude (0 based).
+        /// </summary>
+        ::size_t iamax(const cl::Buffer& x, ::size_t n)
+        {
+            argmax(x, n);
+
+            cl_uint index;
+            queue_.enqueueReadBuffer(index_, CL_TRUE, 0, sizeof(cl_uint), &index);
+            return index;
+        }
+
+        /// <summary>
+        /// y = f(x) element-wise. f is an OpenCL C expression of x, valid for
+        /// scalars and vectors of the element type, like "sqrt(x) + 1".
+        /// </summary>
+        void map(const std::string& f, const cl::Buffer& x, const cl::Buffer& y, ::size_t n)
+        {
+            cl::Kernel& k = generated("#define MAP(x) (" + f + ")\n", "map");
+            k.setArg(0, x);
+            k.setArg(1, y);
+            k.setArg(2, (cl_uint)n);
+            elementwise(k, n);
+        }
+
+        /// <summary>
+        /// z = f(x, y) element-wise. f is an OpenCL C expression of x and y,
+        /// like "x * y + 1".
+        /// </summary>
+        void zip(const std::string& f, const cl::Buffer& x, const cl::Buffer& y, const cl::Buffer& z, ::size_t n)
+        {
+            cl::Kernel& k = generated("#define ZIP(x, y) (" + f + ")\n", "zip");
+            k.setArg(0, x);
+            k.setArg(1, y);
+            k.setArg(2, z);
+            k.setArg(3, (cl_uint)n);
+            elementwise(k, n);
+        }
+
+    private:
+        // enqueues both passes of iamax, the index is left in index_
+        void argmax(const cl::Buffer& x, ::size_t n)
+        {
+            cl::Kernel& partial = kernel("iamax_partial");
+            partial.setArg(0, x);
+            partial.setArg(1, (cl_uint)n);
+            partial.setArg(2, cl::Local(sizeof(T) * group_size_));
+            partial.setArg(3, cl::Local(sizeof(cl_uint) * group_size_));
+            partial.setArg(4, partials_);
+            partial.setArg(5, partial_indices_);
+            queue_.enqueueNDRangeKernel(partial, cl::NullRange, cl::NDRange(groups_ * group_size_), cl::NDRange(group_size_));
+
+            cl::Kernel& final_pass = kernel("iamax_partials");
+            final_pass.setArg(0, partials_);
+            final_pass.setArg(1, partial_indices_);
+            final_pass.setArg(2, (cl_uint)groups_);
+            final_pass.setArg(3, cl::Local(sizeof(T) * group_size_));
+            final_pass.setArg(4, cl::Local(sizeof(cl_uint) * group_size_));
+            final_pass.setArg(5, index_);
+            queue_.enqueueNDRangeKernel(final_pass, cl::NullRange, cl::NDRange(group_size_), cl::NDRange(group_size_));
+        }
+
+        cl::Kernel& kernel(const char* name)
+        {
+            return ocl::Runtime::instance().kernel(program_, name);
+        }
+
+        // the program of a map or zip function, built on first use
+        cl::Kernel& generated(const std::string& define, const char* name)
+        {
+            ocl::Runtime& runtime = ocl::Runtime::instance();
+            cl::Program& program = runtime.programFromSource(device_, define + source_, options_);
+            return runtime.kernel(program, name);
+        }
+
+        // one work item per vector, or per element after the last full vector,
+        // padded to whole work-groups (the kernels check both ranges)
+        void elementwise(cl::Kernel& k, ::size_t n)
+        {
+            ::size_t items = std::max<::size_t>(n / width_, n % width_);
+            if (items > 0) {
+                ocl::LaunchConfig launch = ocl::launchConfig(k, device_, items);
+                queue_.enqueueNDRangeKernel(k, cl::NullRange, launch.global, launch.local);
+            }
+        }
+
+        // runs the first pass and sums its partials
+        T reduce(cl::Kernel& partial)
+        {
+            queue_.enqueueNDRangeKernel(partial, cl::NullRange, cl::NDRange(groups_ * group_size_), cl::NDRange(group_size_));
+
+            cl::Kernel& final_pass = kernel("sum_partials");
+            final_pass.setArg(0, partials_);
+            final_pass.setArg(1, (cl_uint)groups_);
+            final_pass.setArg(2, cl::Local(sizeof(T) * group_size_));
+            final_pass.setArg(3, result_);
+            queue_.enqueueNDRangeKernel(final_pass, cl::NullRange, cl::NDRange(group_size_), cl::NDRange(group_size_));
+
+            T result;
+            queue_.enqueueReadBuffer(result_, CL_TRUE, 0, sizeof(T), &result);
+            return result;
+        }
+
+        cl::Device device_;
+        cl::CommandQueue& queue_;
+        unsigned width_;
+        std::string source_;
+        std::string options_;
+        cl::Program program_;
+
+        ::size_t group_size_;
+        ::size_t groups_;
+        cl::Buffer partials_;
+        cl::Buffer partial_indices_;
+        cl::Buffer result_;
+        cl::Buffer index_;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+//------------------------------------------------------------------------------
+//
+//  Lazy device vectors
+//
+//  Arithmetic on DeviceVector builds an expression tree at compile time
+//  (expression templates). Assigning an expression to a DeviceVector
+//  generates one element-wise kernel for the whole tree, so a chain like
+//  f = a + b + e + g costs one pass over memory instead of one launch and
+//  one intermediate buffer per operator. Generated kernels are built and
+//  cached by the shared runtime, expressions of the same shape share one
+//  kernel.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CL/cl.hpp"
+#include "runtime.hpp"
+#include "launch.hpp"
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lazy {
+
+    class DeviceVector;
+
+    /// <summary>
+    /// Leaves and scalars of an expression in the order they appear,
+    /// they become the arguments of the generated kernel.
+    /// </summary>
+    struct Arguments
+    {
+        std::vector<const DeviceVector*> vectors;
+        std::vector<float> scalars;
+
+        /// <summary>
+        /// Index of the kernel argument of a vector, a vector used twice is passed once.
+        /// </summary>
+        ::size_t vectorIndex(const DeviceVector* v)
+        {
+            for (::size_t i = 0; i < vectors.size(); i++)
+                if (vectors[i] == v)
+                    return i;
+
+            vectors.push_back(v);
+            return vectors.size() - 1;
+        }
+
+        /// <summary>
+        /// Index of the kernel argument of a scalar.
+        /// </summary>
+        ::size_t scalarIndex(float s)
+        {
+            scalars.push_back(s);
+            return scalars.size() - 1;
+        }
+    };
+
+    /// <summary>
+    /// Base of all expressions (CRTP).
+    /// </summary>
+    template<typename E>
+    struct Expr
+    {
+        const E& self() const { return static_cast<const E&>(*this); }
+    };
+
+    // sub-expressions are held by value, vectors by reference
+    template<typename E> struct Stored { typedef const E type; };
+    template<> struct Stored<DeviceVector> { typedef const DeviceVector& type; };
+
+    /// <summary>
+    /// A scalar operand, passed to the kernel as argument so that different
+    /// values share one kernel.
+    /// </summary>
+    struct Scalar : public Expr<Scalar>
+    {
+        explicit Scalar(float v) : value(v) {}
+
+        void build(Arguments& args, std::ostringstream& code) const
+        {
+            code << "s" << args.scalarIndex(value);
+        }
+
+        float value;
+    };
+
+    /// <summary>
+    /// Element-wise binary operation of two expressions.
+    /// </summary>
+    template<typename L, typename R, char Op>
+    struct BinaryExpr : public Expr<BinaryExpr<L, R, Op> >
+    {
+        BinaryExpr(const L& l, const R& r) : lhs(l), rhs(r) {}
+
+        void build(Arguments& args, std::ostringstream& code) const
+        {
+            code << "(";
+            lhs.build(args, code);
+            code << " " << Op << " ";
+            rhs.build(args, code);
+            code << ")";
+        }
+
+        typename Stored<L>::type lhs;
+        typename Stored<R>::type rhs;
+    };
+
+    /// <summary>
+    /// Context, queue and cache of the generated kernels.
+    /// </summary>
+    class Engine
+    {
+    public:
+        /// <summary>
+        /// Creates the engine for the device of the queue.
+        /// </summary>
+        /// <param name="context">The context of the device in the runtime (ocl::Runtime::context)</param>
+        /// <param name="queue">The queue the fused kernels are enqueued on</param>
+        Engine(const cl::Context& context, const cl::CommandQueue& queue)
+            : context_(context), queue_(queue), device_(queue.getInfo<CL_QUEUE_DEVICE>())
+        {
+        }
+
+        const cl::Context& context() const { return context_; }
+        cl::CommandQueue& queue() { return queue_; }
+
+        /// <summary>
+        /// Number of kernels generated so far.
+        /// </summary>
+        ::size_t cachedKernels() const { return kernels_.size(); }
+
+        /// <summary>
+        /// Evaluates the expression into out with a single kernel launch.
+        /// </summary>
+        template<typename E>
+        void evaluate(DeviceVector& out, const Expr<E>& expr);
+
+    private:
+        /// <summary>
+        /// Looks up the kernel for a source, building it through the runtime on
+        /// first use (which prints the build log if it fails).
+        /// </summary>
+        cl::Kernel& kernel(const std::string& source)
+        {
+            std::map<std::string, cl::Kernel*>::iterator it = kernels_.find(source);
+
+            if (it == kernels_.end()) {
+                ocl::Runtime& runtime = ocl::Runtime::instance();
+                cl::Program& program = runtime.programFromSource(device_, source);
+                it = kernels_.insert(std::make_pair(source, &runtime.kernel(program, "fused"))).first;
+            }
+
+            return *it->second;
+        }
+
+        cl::Context context_;
+        cl::CommandQueue queue_;
+        cl::Device device_;
+        std::map<std::string, cl::Kernel*> kernels_;       // owned by the runtime
+    };
+
+    /// <summary>
+    /// A float vector in device memory.
+    /// </summary>
+    class DeviceVector : public Expr<DeviceVector>
+    {
+    public:
+        /// <summary>
+        /// Allocates an uninitialized vector of n elements.
+        /// </summary>
+        DeviceVector(Engine& engine, ::size_t n)
+            : engine_(&engine), size_(n), buffer_(engine.context(), CL_MEM_READ_WRITE, sizeof(float) * n)
+        {
+        }
+
+        /// <summary>
+        /// Allocates a vector and copies the host values into it (blocking).
+        /// </summary>
+        DeviceVector(Engine& engine, const std::vector<float>& host)
+            : engine_(&engine), size_(host.size()), buffer_(engine.context(), host.begin(), host.end(), false)
+        {
+        }
+
+        /// <summary>
+        /// Evaluates the expression into this vector with one fused kernel.
+        /// </summary>
+        template<typename E>
+        DeviceVector& operator=(const Expr<E>& expr)
+        {
+            engine_->evaluate(*this, expr);
+            return *this;
+        }
+
+        /// <summary>
+        /// Copies the elements of another vector on the device.
+        /// </summary>
+        DeviceVector& operator=(const DeviceVector& other)
+        {
+            engine_->evaluate(*this, static_cast<const Expr<DeviceVector>&>(other));
+            return *this;
+        }
+
+        /// <summary>
+        /// Copies the vector back to the host (blocking).
+        /// </summary>
+        void read(std::vector<float>& host) const
+        {
+            host.resize(size_);
+            cl::copy(engine_->queue(), buffer_, host.begin(), host.end());
+        }
+
+        void build(Arguments& args, std::ostringstream& code) const
+        {
+            code << "v" << args.vectorIndex(this) << "[i]";
+        }
+
+        ::size_t size() const { return size_; }
+        const cl::Buffer& buffer() const { return buffer_; }
+
+    private:
+        // no copy construction, expressions refer to vectors by address
+        DeviceVector(const DeviceVector&);
+
+        Engine* engine_;
+        ::size_t size_;
+        cl::Buffer buffer_;
+    };
+
+    template<typename E>
+    void Engine::evaluate(DeviceVector& out, const Expr<E>& expr)
+    {
+        Arguments args;
+        std::ostringstream body;
+        expr.self().build(args, body);
+
+        // generate the kernel, it only depends on the shape of the expression
+        std::ostringstream source;
+        source << "__kernel void fused(\n";
+        for (::size_t v = 0; v < args.vectors.size(); v++)
+            source << "\t__global const float* v" << v << ",\n";
+        for (::size_t s = 0; s < args.scalars.size(); s++)
+            source << "\tconst float s" << s << ",\n";
+        source << "\t__global float* out,\n";
+        source << "\tconst unsigned int count)\n";
+        source << "{\n";
+        source << "\tint i = get_global_id(0);\n";
+        source << "\tif (i < count)\n";
+        source << "\t\tout[i] = " << body.str() << ";\n";
+        source << "}\n";
+
+        cl::Kernel& k = kernel(source.str());
+
+        cl_uint arg = 0;
+        for (::size_t v = 0; v < args.vectors.size(); v++) {
+            if (args.vectors[v]->size() != out.size())
+                throw cl::Error(CL_INVALID_VALUE, "lazy::DeviceVector size mismatch");
+            k.setArg(arg++, args.vectors[v]->buffer());
+        }
+        for (::size_t s = 0; s < args.scalars.size(); s++)
+            k.setArg(arg++, args.scalars[s]);
+        k.setArg(arg++, out.buffer());
+        k.setArg(arg++, static_cast<cl_uint>(out.size()));
+
+        // the range padded to whole work-groups, the kernel checks i < count
+        ocl::LaunchConfig launch = ocl::launchConfig(k, device_, out.size());
+        queue_.enqueueNDRangeKernel(k, cl::NullRange, launch.global, launch.local);
+    }
+
+    // --------------------------------------------------------------------------------------
+    // operators
+
+    template<typename L, typename R>
+    BinaryExpr<L, R, '+'> operator+(const Expr<L>& l, const Expr<R>& r)
+    {
+        return BinaryExpr<L, R, '+'>(l.self(), r.self());
+    }
+
+    template<typename L, typename R>
+    BinaryExpr<L, R, '-'> operator-(const Expr<L>& l, const Expr<R>& r)
+    {
+        return BinaryExpr<L, R, '-'>(l.self(), r.self());
+    }
+
+    template<typename L, typename R>
+    BinaryExpr<L, R, '*'> operator*(const Expr<L>& l, const Expr<R>& r)
+    {
+        return BinaryExpr<L, R, '*'>(l.self(), r.self());
+    }
+
+    template<typename R>
+    BinaryExpr<Scalar, R, '*'> operator*(float s, const Expr<R>& r)
+    {
+        return BinaryExpr<Scalar, R, '*'>(Scalar(s), r.self());
+    }
+
+    template<typename L>
+    BinaryExpr<L, Scalar, '*'> operator*(const Expr<L>& l, float s)
+    {
+        return BinaryExpr<L, Scalar, '*'>(l.self(), Scalar(s));
+    }
+}
\ No newline at end of file
@@ -14,7 +14,20 @@
 
 #include "filesystem.h"
 #include "util.hpp"
-
+#include "runtime.hpp"
+#include "device_selector.hpp"
+#include "device_vector.hpp"
+#include "task_graph.hpp"
+#include "async.hpp"
+#include "stream_map.hpp"
+#include "blas1.hpp"
+#include "typed_program.hpp"
+#include "launch.hpp"
+#include "device_profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <chrono> 
 #include <vector>
 #include <cstdio>
@@ -30,9 +43,9 @@
  //#define  VERBOSE 1
 
  // pick up device type from compiler command line or from
- // the default type
+ // the default type, the selector ranks the devices of this type
 #ifndef DEVICE
-#define DEVICE CL_DEVICE_TYPE_DEFAULT
+#define DEVICE CL_DEVICE_TYPE_ALL
 #endif
 
 //------------------------------------------------------------------------------
@@ -40,10 +53,566 @@
 #define TOL    (0.001)   // tolerance used in floating point comparisons
 #define LENGTH (1024)    // length of vectors a, b, and c
 
+#define TASK_LENGTH   (1 << 20)     // length of the vectors of the task graph
+
+#define ASYNC_LENGTH  (1 << 20)     // length of the vectors of every asynchronous batch
+#define ASYNC_BATCHES 8             // batches of the asynchronous vadd
+
+#define STREAM_LENGTH (1 << 24)     // default length of the streamed vectors (64 MiB each, 4 chunks), --stream-length=<n> for more
+#define STREAM_CHUNK  (1 << 22)     // elements per chunk of the stream
+#define STREAM_DEPTH  3             // chunks in flight
+
+#define BLAS_LENGTH   (1 << 24)     // length of the BLAS level 1 vectors
+#define BLAS_RUNS     5             // timed runs of every operation, the best one counts
+
+#define TYPED_LENGTH  (1 << 24)     // length of the vectors of the type-generic vadd
+#define TYPED_RUNS    5             // timed runs of every type, the best one counts
+
+
+// --------------------------------------------------------------------------------------
+
+/// <summary>
+/// c = a + b on vectors of the element type T with the type-generic vadd.
+/// Prints the best time and bandwidth, narrower types move fewer bytes.
+/// </summary>
+/// <returns>The number of correct elements</returns>
+template<typename T>
+int typedVadd(const cl::Device& device, cl::CommandQueue& queue, int count)
+{
+    typedef ocl::ElementType<T> Type;
+
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+
+    // small integers, exact in every type
+    std::vector<T> h_a(count), h_b(count), h_c(count);
+    for (int i = 0; i < count; i++) {
+        h_a[i] = Type::fromDouble(rand() % 1024);
+        h_b[i] = Type::fromDouble(rand() % 1024);
+    }
+
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * count, h_a.data());
+    cl::Buffer d_b(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * count, h_b.data());
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(T) * count);
+
+    // one program per type, cached by the runtime
+    cl::Program& program = ocl::typedProgram<T>(device, FileSystem::getPath("kernel/vadd.cl"));
+    cl::Kernel& vadd = runtime.kernel(program, "vadd");
+    vadd.setArg(0, d_a);
+    vadd.setArg(1, d_b);
+    vadd.setArg(2, d_c);
+    vadd.setArg(3, (cl_uint)count);
+
+    ocl::LaunchConfig launch = ocl::launchConfig(vadd, device, count);
+
+    double best = 1.0e30;
+    for (int r = 0; r <= TYPED_RUNS; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        queue.enqueueNDRangeKernel(vadd, cl::NullRange, launch.global, launch.local);
+        queue.finish();
+
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        // the first run is the warm up
+        if (r > 0)
+            best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+
+    queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(T) * count, h_c.data());
+
+    int correct = 0;
+    for (int i = 0; i < count; i++) {
+        double expected = Type::toDouble(h_a[i]) + Type::toDouble(h_b[i]);
+        if (std::fabs(Type::toDouble(h_c[i]) - expected) <= Type::epsilon() * std::fabs(expected))
+            correct++;
+    }
+
+    printf("%8s %10.3f ms %10.2f GB/s %10d of %d correct\n", Type::name(), best * 1000.0,
+        3.0 * sizeof(T) * count / best / 1.0e9, correct, count);
+
+    return correct;
+}
+
+/// <summary>
+/// The vadd chain F = A+B+E+G and vadd3 D3 = A3+B3+C3 as one task graph.
+/// The two do not depend on each other: the transfers and kernels of both
+/// are enqueued at once with event wait lists, and the host only waits
+/// where it reads a result.
+/// </summary>
+/// <returns>The number of correct elements of F and D3</returns>
+int taskGraphVadd(const cl::Device& device)
+{
+    int count = TASK_LENGTH;
+
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+
+    std::vector<float> h_a(count), h_b(count), h_e(count), h_g(count), h_f(count, 0xdeadbeef);
+    std::vector<float> h_a3(count), h_b3(count), h_c3(count), h_d3(count, 0xdeadbeef);
+    for (int i = 0; i < count; i++) {
+        h_a[i] = rand() / (float)RAND_MAX;
+        h_b[i] = rand() / (float)RAND_MAX;
+        h_e[i] = rand() / (float)RAND_MAX;
+        h_g[i] = rand() / (float)RAND_MAX;
+
+        h_a3[i] = rand() / (float)RAND_MAX;
+        h_b3[i] = rand() / (float)RAND_MAX;
+        h_c3[i] = rand() / (float)RAND_MAX;
+    }
+
+    cl::Kernel ko_vadd(ocl::typedProgram<cl_float>(device, FileSystem::getPath("kernel/vadd.cl")), "vadd");
+    auto vadd = cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, int>(ko_vadd);
+    ocl::LaunchConfig launch = ocl::launchConfig(ko_vadd, device, count);
+
+    cl::Kernel ko_vadd_3(runtime.program(device, FileSystem::getPath("kernel/vadd3.cl")), "vadd3");
+    auto vadd_3 = cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, int>(ko_vadd_3);
+    ocl::LaunchConfig launch_3 = ocl::launchConfig(ko_vadd_3, device, count);
+
+    graph::TaskGraph tasks(context, device);
+
+    cl::Buffer t_a(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_b(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_e(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_g(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_c(context, CL_MEM_READ_WRITE, sizeof(float) * count);
+    cl::Buffer t_d(context, CL_MEM_READ_WRITE, sizeof(float) * count);
+    cl::Buffer t_f(context, CL_MEM_WRITE_ONLY, sizeof(float) * count);
+
+    cl::Buffer t_a3(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_b3(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_c3(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+    cl::Buffer t_d3(context, CL_MEM_WRITE_ONLY, sizeof(float) * count);
+
+    // a kernel node: out = x + y
+    auto vadd_node = [&](const cl::Buffer& x, const cl::Buffer& y, const cl::Buffer& out) {
+        return [&vadd, &launch, x, y, out, count](cl::CommandQueue& q, const std::vector<cl::Event>& wait, cl::Event& done) {
+            done = vadd(cl::EnqueueArgs(q, wait, launch.global, launch.local), x, y, out, count);
+        };
+    };
+
+    ::size_t w_a = tasks.write("write a", t_a, h_a.data(), sizeof(float) * count);
+    ::size_t w_b = tasks.write("write b", t_b, h_b.data(), sizeof(float) * count);
+    ::size_t w_e = tasks.write("write e", t_e, h_e.data(), sizeof(float) * count);
+    ::size_t w_g = tasks.write("write g", t_g, h_g.data(), sizeof(float) * count);
+
+    ::size_t k_c = tasks.add("c = a + b", vadd_node(t_a, t_b, t_c), { w_a, w_b });
+    ::size_t k_d = tasks.add("d = c + e", vadd_node(t_c, t_e, t_d), { k_c, w_e });
+    ::size_t k_f = tasks.add("f = d + g", vadd_node(t_d, t_g, t_f), { k_d, w_g });
+    ::size_t r_f = tasks.read("read f", t_f, h_f.data(), sizeof(float) * count, { k_f });
+
+    ::size_t w_a3 = tasks.write("write a3", t_a3, h_a3.data(), sizeof(float) * count);
+    ::size_t w_b3 = tasks.write("write b3", t_b3, h_b3.data(), sizeof(float) * count);
+    ::size_t w_c3 = tasks.write("write c3", t_c3, h_c3.data(), sizeof(float) * count);
+
+    ::size_t k_d3 = tasks.add("d3 = a3 + b3 + c3",
+        [&vadd_3, &launch_3, &t_a3, &t_b3, &t_c3, &t_d3, count](cl::CommandQueue& q, const std::vector<cl::Event>& wait, cl::Event& done) {
+            done = vadd_3(cl::EnqueueArgs(q, wait, launch_3.global, launch_3.local), t_a3, t_b3, t_c3, t_d3, count);
+        }, { w_a3, w_b3, w_c3 });
+    ::size_t r_d3 = tasks.read("read d3", t_d3, h_d3.data(), sizeof(float) * count, { k_d3 });
+
+    // start timepoint
+    auto start = std::chrono::high_resolution_clock::now();
+
+    tasks.run();
+
+    // host synchronization only where the results are consumed
+    tasks.wait(r_f);
+    tasks.wait(r_d3);
+
+    // end time stopping
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+    std::cout << "Time taken by execution: " << duration.count() << " microseconds (task graph on "
+              << (tasks.outOfOrder() ? std::string("an out-of-order queue") : std::to_string(tasks.queues()) + " in-order queues")
+              << ", including transfers)" << std::endl;
+
+    // test the results
+    int correct_f = 0, correct_d3 = 0;
+
+    for (int i = 0; i < count; i++) {
+        float tmp = h_a[i] + h_b[i] + h_e[i] + h_g[i] - h_f[i];
+        if (tmp * tmp < TOL * TOL)
+            correct_f++;
+
+        tmp = h_a3[i] + h_b3[i] + h_c3[i] - h_d3[i];
+        if (tmp * tmp < TOL * TOL)
+            correct_d3++;
+    }
+
+    // summarize results
+    std::cout << "task graph F = A+B+E+G: " << correct_f << " and D3 = A3+B3+C3: " << correct_d3
+              << " out of " << count << " results were correct" << std::endl;
+
+    return correct_f + correct_d3;
+}
+
+/// <summary>
+/// Batches of vadd without blocking the host: writes, launches and reads
+/// return futures. While the device adds a batch the host prepares the
+/// next one, and the continuation of each read checks its batch on the
+/// worker thread of the library. The in-order queue keeps the two sets of
+/// buffers from being overwritten before they are read.
+/// </summary>
+/// <returns>The number of correct elements of all batches</returns>
+int asyncVadd(const cl::Device& device)
+{
+    int count = ASYNC_LENGTH;
+
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+    cl::CommandQueue& queue = runtime.queue(device);
+
+    std::vector<float> h_a(count), h_b(count);
+    for (int i = 0; i < count; i++) {
+        h_a[i] = rand() / (float)RAND_MAX;
+        h_b[i] = rand() / (float)RAND_MAX;
+    }
+
+    cl::Kernel async_vadd(ocl::typedProgram<cl_float>(device, FileSystem::getPath("kernel/vadd.cl")), "vadd");
+    ocl::LaunchConfig launch = ocl::launchConfig(async_vadd, device, count);
+
+    cl::Buffer x_d[2], y_d[2], z_d[2];
+    for (int k = 0; k < 2; k++) {
+        x_d[k] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+        y_d[k] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * count);
+        z_d[k] = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * count);
+    }
+
+    std::vector<ocl::Future<int>> checked;
+
+    // start timepoint
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int batch = 0; batch < ASYNC_BATCHES; batch++)
+    {
+        int k = batch % 2;
+
+        // host work, overlapping the previous batch on the device
+        std::vector<float> x(count), y(count);
+        for (int i = 0; i < count; i++) {
+            x[i] = h_a[i] * (batch + 1);
+            y[i] = h_b[(i + batch) % count];
+        }
+
+        ocl::writeAsync(queue, x_d[k], x);
+        ocl::writeAsync(queue, y_d[k], y);
+
+        async_vadd.setArg(0, x_d[k]);
+        async_vadd.setArg(1, y_d[k]);
+        async_vadd.setArg(2, z_d[k]);
+        async_vadd.setArg(3, count);
+        ocl::launchAsync(queue, async_vadd, launch.global, launch.local);
+
+        checked.push_back(ocl::readAsync<float>(queue, z_d[k], count).then(
+            [x, y](const std::vector<float>& z) {
+                int ok = 0;
+                for (::size_t i = 0; i < z.size(); i++) {
+                    float err = x[i] + y[i] - z[i];
+                    if (err * err < TOL * TOL)
+                        ok++;
+                }
+                return ok;
+            }));
+    }
+
+    // the only place the host waits
+    std::vector<int> batch_correct = ocl::whenAll(checked).get();
+
+    // end time stopping
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+    std::cout << "Time taken by execution: " << duration.count() << " microseconds (" << ASYNC_BATCHES
+              << " asynchronous batches, including transfers and checks)" << std::endl;
+
+    int correct = 0;
+    for (::size_t b = 0; b < batch_correct.size(); b++)
+        correct += batch_correct[b];
+
+    // summarize results
+    std::cout << "asynchronous vector add: " << correct << " out of " << count * ASYNC_BATCHES
+              << " results were correct" << std::endl;
+
+    return correct;
+}
+
+/// <summary>
+/// vadd and vadd3 over vectors far larger than the other sections (and
+/// possibly than device memory), streamed in chunks through a ring of
+/// device buffers: uploads, kernels and downloads of different chunks
+/// overlap on separate queues. The inputs are generated chunk by chunk,
+/// stream::fileSource and stream::fileSink read and write raw float files
+/// instead.
+/// </summary>
+/// <returns>The number of correct elements of both streams</returns>
+::size_t streamVadd(const cl::Device& device, ::size_t length)
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+
+    auto input = [](unsigned k) -> stream::Source {
+        return [k](::size_t offset, ::size_t n, float* dst) {
+            for (::size_t i = 0; i < n; i++)
+                dst[i] = ((offset + i) * (2 * k + 1) % 1024) / 1024.0f;
+        };
+    };
+
+    cl::Kernel vadd_kernel(ocl::typedProgram<cl_float>(device, FileSystem::getPath("kernel/vadd.cl")), "vadd");
+    cl::Kernel vadd3_kernel(runtime.program(device, FileSystem::getPath("kernel/vadd3.cl")), "vadd3");
+
+    ::size_t correct = 0;
+
+    for (unsigned num_inputs = 2; num_inputs <= 3; num_inputs++)
+    {
+        stream::StreamMap streamer(context, device, num_inputs == 2 ? vadd_kernel : vadd3_kernel,
+            num_inputs, STREAM_CHUNK, STREAM_DEPTH);
+
+        std::vector<stream::Source> inputs;
+        for (unsigned k = 0; k < num_inputs; k++)
+            inputs.push_back(input(k));
+
+        // the sink checks every chunk against the generated inputs
+        ::size_t stream_correct = 0;
+        std::vector<float> expected(STREAM_CHUNK), term(STREAM_CHUNK);
+        stream::Sink check = [&](::size_t offset, ::size_t n, const float* result) {
+            std::fill(expected.begin(), expected.begin() + n, 0.0f);
+            for (unsigned k = 0; k < num_inputs; k++) {
+                inputs[k](offset, n, term.data());
+                for (::size_t i = 0; i < n; i++)
+                    expected[i] += term[i];
+            }
+            for (::size_t i = 0; i < n; i++) {
+                float tmp = expected[i] - result[i];
+                if (tmp * tmp < TOL * TOL)
+                    stream_correct++;
+            }
+        };
+
+        // start timepoint
+        auto start = std::chrono::high_resolution_clock::now();
+
+        streamer.run(length, inputs, check);
+
+        // end time stopping
+        auto stop = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+        // every input is uploaded and the output downloaded once
+        double bytes = (double)sizeof(float) * length * (num_inputs + 1);
+
+        std::cout << "Time taken by execution: " << duration.count() << " microseconds (streamed in chunks of "
+                  << STREAM_CHUNK << ", " << bytes / duration.count() / 1000.0 << " GB/s including host work)" << std::endl;
+
+        std::cout << "streamed " << (num_inputs == 2 ? "vadd" : "vadd3") << ": " << stream_correct
+                  << " out of " << length << " results were correct" << std::endl;
+
+        correct += stream_correct;
+    }
+
+    return correct;
+}
+
+/// <summary>
+/// The BLAS level 1 operations and map / zip for several vector widths,
+/// checked against the host and measured in GB/s. The efficiency is
+/// relative to the device copy bandwidth of the PlatformInformation
+/// profile, or to the fastest copy without a profile.
+/// </summary>
+/// <returns>The number of checks passed</returns>
+int blasLevel1(const cl::Device& device)
+{
+    std::cout << "\n===== BLAS level 1, " << BLAS_LENGTH << " floats, best of " << BLAS_RUNS << " runs ======\n" << std::endl;
+
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+    cl::CommandQueue& blas_queue = runtime.queue(device);
+    ::size_t blas_bytes = sizeof(float) * BLAS_LENGTH;
+
+    std::vector<float> h_x(BLAS_LENGTH), h_y(BLAS_LENGTH), h_r(BLAS_LENGTH), h_s(BLAS_LENGTH);
+    for (int i = 0; i < BLAS_LENGTH; i++) {
+        h_x[i] = 2.0f * rand() / (float)RAND_MAX - 1.0f;
+        h_y[i] = 2.0f * rand() / (float)RAND_MAX - 1.0f;
+    }
+
+    cl::Buffer b_x(context, CL_MEM_READ_WRITE, blas_bytes);
+    cl::Buffer b_y(context, CL_MEM_READ_WRITE, blas_bytes);
+    cl::Buffer b_z(context, CL_MEM_READ_WRITE, blas_bytes);
+
+    // the inputs of every check
+    auto reset = [&]() {
+        blas_queue.enqueueWriteBuffer(b_x, CL_FALSE, 0, blas_bytes, h_x.data());
+        blas_queue.enqueueWriteBuffer(b_y, CL_TRUE, 0, blas_bytes, h_y.data());
+    };
+
+    auto read = [&](const cl::Buffer& b, std::vector<float>& h) {
+        blas_queue.enqueueReadBuffer(b, CL_TRUE, 0, blas_bytes, h.data());
+    };
+
+    // element-wise check of a device vector
+    auto matches = [&](const std::vector<float>& h, std::function<float(int)> expected) {
+        for (int i = 0; i < BLAS_LENGTH; i++) {
+            float err = h[i] - expected(i);
+            if (err * err > TOL * TOL)
+                return false;
+        }
+        return true;
+    };
+
+    // the sums the reductions are checked against, and their scales
+    double dot_ref = 0.0, dot_scale = 0.0, sq_ref = 0.0, asum_ref = 0.0;
+    ::size_t iamax_ref = 0;
+    for (int i = 0; i < BLAS_LENGTH; i++) {
+        dot_ref += (double)h_x[i] * h_y[i];
+        dot_scale += std::fabs((double)h_x[i] * h_y[i]);
+        sq_ref += (double)h_x[i] * h_x[i];
+        asum_ref += std::fabs(h_x[i]);
+        if (std::fabs(h_x[i]) > std::fabs(h_x[iamax_ref]))
+            iamax_ref = i;
+    }
+
+    const char* blas_ops[] = { "axpy", "scal", "copy", "swap", "dot", "nrm2", "asum", "iamax", "map", "zip" };
+    const double blas_arrays[] = { 3, 2, 2, 4, 2, 2, 1, 1, 2, 3 };     // vectors read and written, nrm2 reads x twice
+    const int NBLAS_OPS = sizeof(blas_ops) / sizeof(blas_ops[0]);
+    const unsigned blas_widths[] = { 1, 4, 16 };
+    const int NBLAS_WIDTHS = sizeof(blas_widths) / sizeof(blas_widths[0]);
+
+    double blas_gbs[NBLAS_OPS][NBLAS_WIDTHS];
+    int blas_passed = 0;
+
+    for (int w = 0; w < NBLAS_WIDTHS; w++)
+    {
+        blas1::Level1<cl_float> level1(device, blas_queue, FileSystem::getPath("kernel/blas1.cl"), blas_widths[w]);
+
+        // one checked run, then the timed runs
+        std::function<void()> runs[NBLAS_OPS] = {
+            [&]() { level1.axpy(2.0f, b_x, b_y, BLAS_LENGTH); },
+            [&]() { level1.scal(2.0f, b_x, BLAS_LENGTH); },
+            [&]() { level1.copy(b_x, b_z, BLAS_LENGTH); },
+            [&]() { level1.swap(b_x, b_y, BLAS_LENGTH); },
+            [&]() { level1.dot(b_x, b_y, BLAS_LENGTH); },
+            [&]() { level1.nrm2(b_x, BLAS_LENGTH); },
+            [&]() { level1.asum(b_x, BLAS_LENGTH); },
+            [&]() { level1.iamax(b_x, BLAS_LENGTH); },
+            [&]() { level1.map("sqrt(fabs(x))", b_x, b_z, BLAS_LENGTH); },
+            [&]() { level1.zip("x * y + x", b_x, b_y, b_z, BLAS_LENGTH); },
+        };
+
+        std::function<bool()> checks[NBLAS_OPS] = {
+            [&]() { level1.axpy(2.0f, b_x, b_y, BLAS_LENGTH); read(b_y, h_r);
+                    return matches(h_r, [&](int i) { return 2.0f * h_x[i] + h_y[i]; }); },
+            [&]() { level1.scal(2.0f, b_x, BLAS_LENGTH); read(b_x, h_r);
+                    return matches(h_r, [&](int i) { return 2.0f * h_x[i]; }); },
+            [&]() { level1.copy(b_x, b_z, BLAS_LENGTH); read(b_z, h_r);
+                    return matches(h_r, [&](int i) { return h_x[i]; }); },
+            [&]() { level1.swap(b_x, b_y, BLAS_LENGTH); read(b_x, h_r); read(b_y, h_s);
+                    return matches(h_r, [&](int i) { return h_y[i]; }) && matches(h_s, [&](int i) { return h_x[i]; }); },
+            [&]() { return std::fabs(level1.dot(b_x, b_y, BLAS_LENGTH) - dot_ref) < TOL * dot_scale; },
+            [&]() { return std::fabs(level1.nrm2(b_x, BLAS_LENGTH) - std::sqrt(sq_ref)) < TOL * std::sqrt(sq_ref); },
+            [&]() { return std::fabs(level1.asum(b_x, BLAS_LENGTH) - asum_ref) < TOL * asum_ref; },
+            [&]() { return level1.iamax(b_x, BLAS_LENGTH) == iamax_ref; },
+            [&]() { level1.map("sqrt(fabs(x))", b_x, b_z, BLAS_LENGTH); read(b_z, h_r);
+                    return matches(h_r, [&](int i) { return std::sqrt(std::fabs(h_x[i])); }); },
+            [&]() { level1.zip("x * y + x", b_x, b_y, b_z, BLAS_LENGTH); read(b_z, h_r);
+                    return matches(h_r, [&](int i) { return h_x[i] * h_y[i] + h_x[i]; }); },
+        };
+
+        for (int op = 0; op < NBLAS_OPS; op++)
+        {
+            reset();
+            if (checks[op]())
+                blas_passed++;
+            else
+                std::cout << blas_ops[op] << " with vector width " << blas_widths[w] << " failed the check" << std::endl;
+
+            double best = 1.0e30;
+            for (int r = 0; r < BLAS_RUNS; r++) {
+                // start timepoint
+                auto start = std::chrono::high_resolution_clock::now();
+
+                runs[op]();
+                blas_queue.finish();
+
+                // end time stopping
+                auto stop = std::chrono::high_resolution_clock::now();
+                best = std::min(best, std::chrono::duration<double>(stop - start).count());
+            }
+
+            blas_gbs[op][w] = blas_arrays[op] * blas_bytes / best / 1.0e9;
+        }
+    }
+
+    // the reference bandwidth
+    double reference = -1.0;
+    ocl::DeviceProfile profile;
+    if (profile.load(ocl::DeviceProfile::defaultPath(), device))
+        reference = profile.value("d2d_copy_gbs");
+
+    if (reference <= 0.0) {
+        for (int w = 0; w < NBLAS_WIDTHS; w++)
+            reference = std::max(reference, blas_gbs[2][w]);
+        std::cout << "Efficiency relative to the fastest copy, " << reference << " GB/s" << std::endl;
+    }
+    else {
+        std::cout << "Efficiency relative to the device copy bandwidth, " << reference << " GB/s" << std::endl;
+    }
+
+    printf("\n%8s", "");
+    for (int w = 0; w < NBLAS_WIDTHS; w++)
+        printf("   width %2u (GB/s, eff)", blas_widths[w]);
+    printf("\n");
+
+    for (int op = 0; op < NBLAS_OPS; op++) {
+        printf("%8s", blas_ops[op]);
+        for (int w = 0; w < NBLAS_WIDTHS; w++)
+            printf("   %10.2f %9.1f%%", blas_gbs[op][w], 100.0 * blas_gbs[op][w] / reference);
+        printf("\n");
+    }
+
+    // summarize results
+    std::cout << "\nBLAS level 1: " << blas_passed << " out of " << NBLAS_OPS * NBLAS_WIDTHS
+              << " checks passed" << std::endl;
+    return blas_passed;
+}
+
+/// <summary>
+/// vadd written once for an element type T and built per type through
+/// build options, half is stored in 16 bits and added in float.
+/// </summary>
+/// <returns>The number of correct elements of all types</returns>
+int typeGenericVadd(const cl::Device& device)
+{
+    std::cout << "\n===== type-generic vadd, " << TYPED_LENGTH << " elements ======\n" << std::endl;
+
+    cl::CommandQueue& queue = ocl::Runtime::instance().queue(device);
+
+    int correct = 0;
+    correct += typedVadd<cl_int>(device, queue, TYPED_LENGTH);
+    correct += typedVadd<cl_float>(device, queue, TYPED_LENGTH);
+    if (ocl::ElementType<cl_double>::supported(device))
+        correct += typedVadd<cl_double>(device, queue, TYPED_LENGTH);
+    else
+        std::cout << "  double not supported by the device" << std::endl;
+    correct += typedVadd<ocl::half>(device, queue, TYPED_LENGTH);
+
+    return correct;
+}
 
 // --------------------------------------------------------------------------------------
-int main(void)
+int main(int argc, char* argv[])
 {
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
+    // vectors larger than device memory: --stream-length=268435456 (1 GiB each)
+    ::size_t stream_length = STREAM_LENGTH;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 16, "--stream-length=") == 0)
+            stream_length = std::strtoull(arg.c_str() + 16, nullptr, 10);
+    }
+
     // Print Programm Infos
     std::cout << "OpenCL Vadd_Kernel CPP - Version " << 
         Vadd_Kernel_cpp_VERSION_MAJOR << "." << Vadd_Kernel_cpp_VERSION_MINOR << std::endl;
@@ -94,21 +663,31 @@ int main(void)
 
     try 
     {
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.type(DEVICE).select();
+
+        // print device name of the chosen device
+        std::cout << "\nUsing OpenCL Device " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
+
         // create a context
-        cl::Context context(DEVICE);
+        cl::Context context = ocl::Runtime::instance().context(device);
 
         // Load in kernel source, creating a program object for the context
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        cl::Program program(context, util::loadProgram(FileSystem::getPath("kernel/vadd.cl")), true);
+        // the kernel is written for any element type (T), the float program
+        // is built with the options of ocl::ElementType<cl_float> on first use
+        cl::Program program = ocl::typedProgram<cl_float>(device, FileSystem::getPath("kernel/vadd.cl"));
 
 
         // Get the command queue
         cl::CommandQueue queue(context);
 
         // create the kernel functor
-        auto vadd = cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, int>(program, "vadd");
+        cl::Kernel ko_vadd(program, "vadd");
+        auto vadd = cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, int>(ko_vadd);
+
+        // work-groups of a multiple of the preferred size, the range padded to whole groups
+        ocl::LaunchConfig launch = ocl::launchConfig(ko_vadd, device, count);
               
 
         // buffer construction
@@ -139,7 +718,8 @@ int main(void)
         vadd(
             cl::EnqueueArgs(
                             queue,
-                            cl::NDRange(count)
+                            launch.global,
+                            launch.local
                             ),
             d_a,
             d_b,
@@ -152,7 +732,8 @@ int main(void)
         vadd(
             cl::EnqueueArgs(
                 queue,
-                cl::NDRange(count)
+                launch.global,
+                launch.local
                 ),
             d_c,
             d_e,
@@ -165,7 +746,8 @@ int main(void)
         vadd(
             cl::EnqueueArgs(
                 queue,
-                cl::NDRange(count)
+                launch.global,
+                launch.local
                 ),
             d_d,
             d_g,
@@ -203,6 +785,60 @@ int main(void)
         // summarize results
         std::cout << "vector add to find C = A+B D=C+E F=D+G Checked F: " << correct << " out of " << count << " results were correct" << std::endl;
 
+        // lazy device vectors
+        // -------------------
+
+        // the same chain as one fused kernel: F = A+B+E+G is an expression tree,
+        // assigning it generates (and caches) a single element-wise kernel
+        lazy::Engine engine(context, queue);
+
+        lazy::DeviceVector l_a(engine, h_a);
+        lazy::DeviceVector l_b(engine, h_b);
+        lazy::DeviceVector l_e(engine, h_e);
+        lazy::DeviceVector l_g(engine, h_g);
+        lazy::DeviceVector l_f(engine, count);
+
+        // first evaluation generates and builds the kernel
+        l_f = l_a + l_b + l_e + l_g;
+        queue.finish();
+
+        // start timepoint
+        start = std::chrono::high_resolution_clock::now();
+
+        // RUN f = a + b + e + g
+        l_f = l_a + l_b + l_e + l_g;
+
+        queue.finish();
+
+        // end time stopping
+        stop = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+        std::cout << "Time taken by execution: " << duration.count() << " microseconds (fused, "
+                  << engine.cachedKernels() << " generated kernel)" << std::endl;
+
+        // copy data back from device
+        std::fill(h_f.begin(), h_f.end(), 0xdeadbeef);
+        l_f.read(h_f);
+
+        // test the results
+        correct = 0;
+
+        for (int i = 0; i < count; i++) {
+            tmp = h_a[i] + h_b[i] + h_e[i] + h_g[i];    // expected value for d_f[i]
+            tmp -= h_f[i];            // compute errors
+            if (tmp * tmp < TOL * TOL) {    // correct if square deviation is less
+                correct++;                  // than tollenace squared
+            }
+            else {
+                printf("tmp %f h_a %f + h_b %f + h_e %f + h_g %f != h_f %f \n", tmp, h_a[i], h_b[i], h_e[i], h_g[i], h_f[i]);
+            }
+
+        }
+
+        // summarize results
+        std::cout << "fused vector add to find F = A+B+E+G: " << correct << " out of " << count << " results were correct" << std::endl;
+
         // vadd 3
         // ------
 
@@ -217,7 +853,10 @@ int main(void)
         cl::CommandQueue queue_3(context);
 
         // create the kernel functor
-        auto vadd_3 = cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, int>(program_3, "vadd3");
+        cl::Kernel ko_vadd_3(program_3, "vadd3");
+        auto vadd_3 = cl::make_kernel<cl::Buffer, cl::Buffer, cl::Buffer, cl::Buffer, int>(ko_vadd_3);
+
+        ocl::LaunchConfig launch_3 = ocl::launchConfig(ko_vadd_3, device, count);
 
 
         // buffer construction
@@ -244,7 +883,8 @@ int main(void)
         vadd_3(
             cl::EnqueueArgs(
                 queue_3,
-                cl::NDRange(count)
+                launch_3.global,
+                launch_3.local
                 ),
             d_a3,
             d_b3,
@@ -283,6 +923,26 @@ int main(void)
         // summarize results
         std::cout << "vector add to find D3 = A3+B3+C3: " << correct << " out of " << count << " results were correct" << std::endl;
 
+        // task graph
+        // ----------
+        taskGraphVadd(device);
+
+        // asynchronous launches
+        // ---------------------
+        asyncVadd(device);
+
+        // streaming
+        // ---------
+        streamVadd(device, stream_length);
+
+        // BLAS level 1
+        // ------------
+        blasLevel1(device);
+
+        // type-generic vadd
+        // -----------------
+        typeGenericVadd(device);
+
     }
     // catch opencl error
     catch (cl::Error err) {
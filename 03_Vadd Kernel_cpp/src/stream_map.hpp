@@ -0,0 +1,230 @@
+//------------------------------------------------------------------------------
+//
+//  Streaming element-wise kernels
+//
+//  Runs an element-wise kernel over inputs of any length, chunk by chunk,
+//  through a ring of device buffers. Uploads, kernels and downloads are
+//  enqueued on three queues and linked with events, so while chunk i is
+//  computed chunk i+1 is uploaded and chunk i-1 is downloaded, and the host
+//  fills and drains pinned staging memory in parallel.
+//
+//  The kernel has to take its inputs, the output and the element count:
+//      kernel(in_0, ..., in_k-1, out, count)
+//  like vadd and vadd3, and check i < count: the range of a chunk is padded
+//  to whole work-groups.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CL/cl.hpp"
+#include "launch.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stream {
+
+    /// <summary>
+    /// Produces count elements of an input, starting at element offset, into dst.
+    /// Chunks are requested in increasing order.
+    /// </summary>
+    typedef std::function<void(::size_t offset, ::size_t count, float* dst)> Source;
+
+    /// <summary>
+    /// Consumes count elements of the output, starting at element offset.
+    /// Chunks are delivered in increasing order.
+    /// </summary>
+    typedef std::function<void(::size_t offset, ::size_t count, const float* src)> Sink;
+
+    /// <summary>
+    /// A source reading raw floats from a file.
+    /// </summary>
+    inline Source fileSource(const std::string& path)
+    {
+        std::shared_ptr<std::ifstream> file(new std::ifstream(path.c_str(), std::ios::binary));
+        if (!file->is_open())
+            throw cl::Error(CL_INVALID_VALUE, "stream::fileSource cannot open file");
+
+        return [file](::size_t offset, ::size_t count, float* dst) {
+            file->seekg(static_cast<std::streamoff>(offset * sizeof(float)));
+            file->read(reinterpret_cast<char*>(dst), count * sizeof(float));
+            if (static_cast<::size_t>(file->gcount()) != count * sizeof(float))
+                throw cl::Error(CL_INVALID_VALUE, "stream::fileSource file too short");
+        };
+    }
+
+    /// <summary>
+    /// A sink writing raw floats to a file.
+    /// </summary>
+    inline Sink fileSink(const std::string& path)
+    {
+        std::shared_ptr<std::ofstream> file(new std::ofstream(path.c_str(), std::ios::binary));
+        if (!file->is_open())
+            throw cl::Error(CL_INVALID_VALUE, "stream::fileSink cannot open file");
+
+        return [file](::size_t offset, ::size_t count, const float* src) {
+            file->seekp(static_cast<std::streamoff>(offset * sizeof(float)));
+            file->write(reinterpret_cast<const char*>(src), count * sizeof(float));
+            if (!*file)
+                throw cl::Error(CL_INVALID_VALUE, "stream::fileSink cannot write file");
+        };
+    }
+
+    class StreamMap
+    {
+    public:
+        /// <summary>
+        /// Allocates the ring of device buffers and pinned staging memory.
+        /// </summary>
+        /// <param name="context">The context</param>
+        /// <param name="device">The device</param>
+        /// <param name="kernel">The element-wise kernel</param>
+        /// <param name="num_inputs">Number of input vectors of the kernel</param>
+        /// <param name="chunk">Elements per chunk</param>
+        /// <param name="depth">Number of chunks in flight</param>
+        StreamMap(const cl::Context& context, const cl::Device& device, const cl::Kernel& kernel,
+            unsigned num_inputs, ::size_t chunk, unsigned depth = 3)
+            : device_(device), kernel_(kernel), num_inputs_(num_inputs), chunk_(chunk),
+              write_queue_(context, device), compute_queue_(context, device), read_queue_(context, device)
+        {
+            ::size_t bytes = sizeof(float) * chunk_;
+
+            for (unsigned s = 0; s < depth; s++) {
+                Slot slot;
+
+                for (unsigned k = 0; k < num_inputs_; k++) {
+                    slot.inputs.push_back(cl::Buffer(context, CL_MEM_READ_ONLY, bytes));
+                    slot.input_pinned.push_back(cl::Buffer(context, CL_MEM_ALLOC_HOST_PTR, bytes));
+                    slot.input_host.push_back(static_cast<float*>(write_queue_.enqueueMapBuffer(
+                        slot.input_pinned[k], CL_TRUE, CL_MAP_WRITE, 0, bytes)));
+                }
+
+                slot.output = cl::Buffer(context, CL_MEM_WRITE_ONLY, bytes);
+                slot.output_pinned = cl::Buffer(context, CL_MEM_ALLOC_HOST_PTR, bytes);
+                slot.output_host = static_cast<float*>(read_queue_.enqueueMapBuffer(
+                    slot.output_pinned, CL_TRUE, CL_MAP_READ, 0, bytes));
+
+                slot.busy = false;
+                slots_.push_back(slot);
+            }
+        }
+
+        ~StreamMap()
+        {
+            // also runs while an exception of run() unwinds, so nothing may escape
+            try {
+                compute_queue_.finish();
+                for (::size_t s = 0; s < slots_.size(); s++) {
+                    for (unsigned k = 0; k < num_inputs_; k++)
+                        write_queue_.enqueueUnmapMemObject(slots_[s].input_pinned[k], slots_[s].input_host[k]);
+                    read_queue_.enqueueUnmapMemObject(slots_[s].output_pinned, slots_[s].output_host);
+                }
+                write_queue_.finish();
+                read_queue_.finish();
+            }
+            catch (cl::Error) {
+            }
+        }
+
+        /// <summary>
+        /// Streams total elements of the inputs through the kernel into the output.
+        /// </summary>
+        /// <param name="total">Number of elements</param>
+        /// <param name="inputs">One source per kernel input</param>
+        /// <param name="output">The sink of the result</param>
+        void run(::size_t total, const std::vector<Source>& inputs, const Sink& output)
+        {
+            if (inputs.size() != num_inputs_)
+                throw cl::Error(CL_INVALID_VALUE, "stream::StreamMap wrong number of inputs");
+
+            ::size_t num_chunks = (total + chunk_ - 1) / chunk_;
+
+            for (::size_t c = 0; c < num_chunks; c++) {
+                Slot& slot = slots_[c % slots_.size()];
+
+                // the slot's previous chunk is done once it has been read back
+                drain(slot, output);
+
+                slot.offset = c * chunk_;
+                slot.count = std::min(chunk_, total - slot.offset);
+                ::size_t bytes = sizeof(float) * slot.count;
+
+                // fill the pinned staging memory and upload it
+                std::vector<cl::Event> written(num_inputs_);
+                for (unsigned k = 0; k < num_inputs_; k++) {
+                    inputs[k](slot.offset, slot.count, slot.input_host[k]);
+                    write_queue_.enqueueWriteBuffer(slot.inputs[k], CL_FALSE, 0, bytes, slot.input_host[k], NULL, &written[k]);
+                }
+
+                // compute once the inputs have arrived
+                cl_uint arg = 0;
+                for (unsigned k = 0; k < num_inputs_; k++)
+                    kernel_.setArg(arg++, slot.inputs[k]);
+                kernel_.setArg(arg++, slot.output);
+                kernel_.setArg(arg++, static_cast<cl_uint>(slot.count));
+
+                cl::Event computed;
+                ocl::LaunchConfig launch = ocl::launchConfig(kernel_, device_, slot.count);
+                compute_queue_.enqueueNDRangeKernel(kernel_, cl::NullRange, launch.global, launch.local, &written, &computed);
+
+                // download once computed
+                std::vector<cl::Event> wait(1, computed);
+                read_queue_.enqueueReadBuffer(slot.output, CL_FALSE, 0, bytes, slot.output_host, &wait, &slot.read);
+                slot.busy = true;
+
+                write_queue_.flush();
+                compute_queue_.flush();
+                read_queue_.flush();
+            }
+
+            // hand out the chunks still in flight, in order
+            for (::size_t c = num_chunks; c < num_chunks + slots_.size(); c++)
+                drain(slots_[c % slots_.size()], output);
+        }
+
+    private:
+        struct Slot
+        {
+            std::vector<cl::Buffer> inputs;         // device buffers
+            std::vector<cl::Buffer> input_pinned;   // pinned staging buffers
+            std::vector<float*> input_host;         // mapped staging memory
+            cl::Buffer output;
+            cl::Buffer output_pinned;
+            float* output_host;
+
+            ::size_t offset;                        // chunk currently in the slot
+            ::size_t count;
+            cl::Event read;                         // completion of the download
+            bool busy;
+        };
+
+        /// <summary>
+        /// Waits for the chunk in the slot and passes it to the sink.
+        /// </summary>
+        void drain(Slot& slot, const Sink& output)
+        {
+            if (!slot.busy)
+                return;
+
+            slot.read.wait();
+            output(slot.offset, slot.count, slot.output_host);
+            slot.busy = false;
+        }
+
+        cl::Device device_;
+        cl::Kernel kernel_;
+        unsigned num_inputs_;
+        ::size_t chunk_;
+
+        cl::CommandQueue write_queue_;
+        cl::CommandQueue compute_queue_;
+        cl::CommandQueue read_queue_;
+
+        std::vector<Slot> slots_;
+    };
+}
\ No newline at end of file
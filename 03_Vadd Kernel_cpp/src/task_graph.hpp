@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+//
+//  Task graph executor
+//
+//  Nodes are commands (kernel launches, transfers), edges are dependencies.
+//  Every node is enqueued with the events of its dependencies as wait list,
+//  so independent nodes can overlap. On devices with out-of-order queues a
+//  single out-of-order queue is used, otherwise the nodes are spread over
+//  several in-order queues: a node goes to the queue of its first dependency,
+//  nodes without dependencies are distributed round robin.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CL/cl.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace graph {
+
+    /// <summary>
+    /// Enqueues a command on the queue, waiting for the events in the wait
+    /// list, and returns the event of the command in done.
+    /// </summary>
+    typedef std::function<void(cl::CommandQueue& queue, const std::vector<cl::Event>& wait, cl::Event& done)> Command;
+
+    class TaskGraph
+    {
+    public:
+        /// <summary>
+        /// Creates the queues of the graph.
+        /// </summary>
+        /// <param name="context">The context</param>
+        /// <param name="device">The device the commands run on</param>
+        /// <param name="num_queues">Number of in-order queues if the device has no out-of-order queues</param>
+        TaskGraph(const cl::Context& context, const cl::Device& device, unsigned num_queues = 2)
+            : next_queue_(0)
+        {
+            cl_command_queue_properties props = device.getInfo<CL_DEVICE_QUEUE_PROPERTIES>();
+            out_of_order_ = (props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+
+            if (out_of_order_) {
+                queues_.push_back(cl::CommandQueue(context, device, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE));
+            }
+            else {
+                for (unsigned q = 0; q < (num_queues > 0 ? num_queues : 1); q++)
+                    queues_.push_back(cl::CommandQueue(context, device));
+            }
+        }
+
+        /// <summary>
+        /// Adds a node. Dependencies have to be added before, so the order
+        /// of insertion is a topological order.
+        /// </summary>
+        /// <param name="name">The name of the node</param>
+        /// <param name="command">Enqueues the command</param>
+        /// <param name="deps">The nodes this one depends on</param>
+        /// <returns>The id of the node</returns>
+        ::size_t add(const std::string& name, const Command& command, const std::vector<::size_t>& deps = std::vector<::size_t>())
+        {
+            for (::size_t d = 0; d < deps.size(); d++) {
+                if (deps[d] >= nodes_.size())
+                    throw cl::Error(CL_INVALID_VALUE, "graph::TaskGraph dependency on a later node");
+            }
+
+            Node node;
+            node.name = name;
+            node.command = command;
+            node.deps = deps;
+            node.queue = 0;
+            nodes_.push_back(node);
+
+            return nodes_.size() - 1;
+        }
+
+        /// <summary>
+        /// Adds a non-blocking write of host memory into a buffer.
+        /// The host memory has to stay valid until the node has completed.
+        /// </summary>
+        ::size_t write(const std::string& name, const cl::Buffer& buffer, const void* host, ::size_t bytes,
+            const std::vector<::size_t>& deps = std::vector<::size_t>())
+        {
+            return add(name, [buffer, host, bytes](cl::CommandQueue& queue, const std::vector<cl::Event>& wait, cl::Event& done) {
+                queue.enqueueWriteBuffer(buffer, CL_FALSE, 0, bytes, host, &wait, &done);
+            }, deps);
+        }
+
+        /// <summary>
+        /// Adds a non-blocking read of a buffer into host memory.
+        /// The host memory is valid once wait() on the node has returned.
+        /// </summary>
+        ::size_t read(const std::string& name, const cl::Buffer& buffer, void* host, ::size_t bytes,
+            const std::vector<::size_t>& deps = std::vector<::size_t>())
+        {
+            return add(name, [buffer, host, bytes](cl::CommandQueue& queue, const std::vector<cl::Event>& wait, cl::Event& done) {
+                queue.enqueueReadBuffer(buffer, CL_FALSE, 0, bytes, host, &wait, &done);
+            }, deps);
+        }
+
+        /// <summary>
+        /// Enqueues all nodes and flushes the queues, does not wait.
+        /// </summary>
+        void run()
+        {
+            for (::size_t n = 0; n < nodes_.size(); n++) {
+                Node& node = nodes_[n];
+
+                std::vector<cl::Event> wait;
+                for (::size_t d = 0; d < node.deps.size(); d++)
+                    wait.push_back(nodes_[node.deps[d]].event);
+
+                // keep chains on one queue, spread independent work
+                if (node.deps.empty()) {
+                    node.queue = next_queue_;
+                    next_queue_ = (next_queue_ + 1) % queues_.size();
+                }
+                else {
+                    node.queue = nodes_[node.deps[0]].queue;
+                }
+
+                node.command(queues_[node.queue], wait, node.event);
+            }
+
+            for (::size_t q = 0; q < queues_.size(); q++)
+                queues_[q].flush();
+        }
+
+        /// <summary>
+        /// Blocks until the node (and therefore all its dependencies) has completed.
+        /// </summary>
+        void wait(::size_t node)
+        {
+            nodes_[node].event.wait();
+        }
+
+        /// <summary>
+        /// Blocks until all nodes have completed.
+        /// </summary>
+        void finish()
+        {
+            for (::size_t q = 0; q < queues_.size(); q++)
+                queues_[q].finish();
+        }
+
+        /// <summary>
+        /// True if the graph runs on an out-of-order queue.
+        /// </summary>
+        bool outOfOrder() const { return out_of_order_; }
+
+        /// <summary>
+        /// Number of queues the nodes are spread over.
+        /// </summary>
+        ::size_t queues() const { return queues_.size(); }
+
+    private:
+        struct Node
+        {
+            std::string name;
+            Command command;
+            std::vector<::size_t> deps;
+            ::size_t queue;         // index of the queue the node was enqueued on
+            cl::Event event;        // completion of the node
+        };
+
+        std::vector<Node> nodes_;
+        std::vector<cl::CommandQueue> queues_;
+        ::size_t next_queue_;
+        bool out_of_order_;
+    };
+}
\ No newline at end of file
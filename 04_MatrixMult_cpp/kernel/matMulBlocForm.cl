@@ -24,8 +24,13 @@
 //             Iblk, Jblk, Kblk ... indices of matrix blocks
 //             iloc, jloc, kloc ... indices inside blocks
 //
-// input: A and B float matrices of dimension dim
-// output: C float matrix of dimension dim holding the product of A * B
+//          Written for any element type T and built for a type by
+//          ocl::typedProgram (common/src/typed_program.hpp): the blocks are
+//          held and multiplied in ACC (float for half), the result is
+//          rounded to T once.
+//
+// input: A and B T matrices of dimension dim
+// output: C T matrix of dimension dim holding the product of A * B
 //
 
 // It turns out that the compiler generates much better code if
@@ -36,14 +41,14 @@
 // __kernel declares a functions as a kernel (makes it visible to host code so it can be enqueued)
 __kernel void mat_mul(
 		const		int				N,
-		__global	const		float* restrict A,		// __global address space qualifiers
-		__global	const		float* restrict B,
-		__global				float* restrict C,
-		__local					float* restrict	Awrk,					// local shared by workitems in the work group
-		__local					float* restrict	Bwrk)
+		__global	const		T* restrict A,		// __global address space qualifiers
+		__global	const		T* restrict B,
+		__global				T* restrict C,
+		__local					ACC* restrict	Awrk,					// local shared by workitems in the work group
+		__local					ACC* restrict	Bwrk)
 {
 	int kloc, Kblk;
-	float Ctmp = 0.0f;
+	ACC Ctmp = 0;
 
 	//  This work-item will compute element C(i,j)
 	const int i = get_global_id(0);
@@ -77,8 +82,8 @@ __kernel void mat_mul(
 		// Each work-item loads a single element of the two blocks
 		// which are shared with the entire work-group
 
-		Awrk[jloc * blksz + iloc] = A[Abase + jloc * N + iloc];
-		Bwrk[jloc * blksz + iloc] = B[Bbase + jloc * N + iloc];
+		Awrk[jloc * blksz + iloc] = LOAD(A, Abase + jloc * N + iloc);
+		Bwrk[jloc * blksz + iloc] = LOAD(B, Bbase + jloc * N + iloc);
 
 		barrier(CLK_LOCAL_MEM_FENCE);
 
@@ -95,5 +100,156 @@ __kernel void mat_mul(
 	}
 
 	// update global C matrix
-	C[j * N + i] = Ctmp;
+	STORE(Ctmp, C, j * N + i);
+}
+
+// --------------------------------------------------------------------------------------
+// function: epilogue
+// Purpose: the element-wise work that follows a matrix product in a network
+//          layer, applied to the product element acc = (A * B)(row, col) of
+//          C in registers. Every step is selected at build time:
+//
+//             -DEPILOGUE_SCALE      alpha * acc + beta * C(row, col), C is not read for beta == 0
+//             -DEPILOGUE_ROW_BIAS   + row_bias[row]
+//             -DEPILOGUE_COL_BIAS   + col_bias[col]
+//             -DEPILOGUE_RELU       max(x, 0)
+//             -DEPILOGUE_GELU       x * Phi(x), tanh approximation, floating point types only
+//             -DEPILOGUE_RESIDUAL   + R(row, col), after the activation
+//
+//          without any of them the result is the product. The steps are
+//          computed in ACC.
+//
+
+#define GELU_K0 0.7978845608f	// sqrt(2 / pi)
+#define GELU_K1 0.044715f
+
+ACC epilogue(
+	ACC acc,
+	const int row,
+	const int col,
+	const int N,
+	const ACC alpha,
+	const ACC beta,
+	__global const T* C,
+	__global const T* row_bias,
+	__global const T* col_bias,
+	__global const T* R)
+{
+	ACC x = acc;
+
+#ifdef EPILOGUE_SCALE
+	x = alpha * x;
+	if (beta != 0)
+		x += beta * LOAD(C, row * N + col);
+#endif
+#ifdef EPILOGUE_ROW_BIAS
+	x += LOAD(row_bias, row);
+#endif
+#ifdef EPILOGUE_COL_BIAS
+	x += LOAD(col_bias, col);
+#endif
+#ifdef EPILOGUE_RELU
+	x = x > 0 ? x : 0;
+#endif
+#ifdef EPILOGUE_GELU
+	x = (ACC)0.5 * x * (1 + tanh((ACC)GELU_K0 * (x + (ACC)GELU_K1 * x * x * x)));
+#endif
+#ifdef EPILOGUE_RESIDUAL
+	x += LOAD(R, row * N + col);
+#endif
+
+	return x;
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: mat_mul_epilogue
+// Purpose: the blocked product of mat_mul with the epilogue fused into the
+//          single store of C, instead of a second pass reading all of C
+//          back from global memory
+//
+// input: A and B T matrices of dimension N, alpha and beta (ACC), the bias
+//        vectors and the residual matrix R of the selected epilogue steps
+//        (the others may be NULL), C for EPILOGUE_SCALE with beta != 0
+// output: C T matrix of dimension N holding epilogue(A * B)
+//
+
+__kernel void mat_mul_epilogue(
+		const		int				N,
+		__global	const		T* restrict A,
+		__global	const		T* restrict B,
+		__global				T* restrict C,
+		__local					ACC* restrict	Awrk,
+		__local					ACC* restrict	Bwrk,
+		const					ACC				alpha,
+		const					ACC				beta,
+		__global	const		T* restrict row_bias,
+		__global	const		T* restrict col_bias,
+		__global	const		T* restrict R)
+{
+	int kloc, Kblk;
+	ACC Ctmp = 0;
+
+	//  This work-item will compute element C(j,i), see mat_mul
+	const int i = get_global_id(0);
+	const int j = get_global_id(1);
+
+	const int Iblk = get_group_id(0);
+	const int Jblk = get_group_id(1);
+
+	const int iloc = get_local_id(0);
+	const int jloc = get_local_id(1);
+
+	const int Num_BLK = N / blksz;
+
+	int Abase = Jblk * N * blksz;
+	const int Ainc = blksz;
+
+	int Bbase = Iblk * blksz;
+	const int Binc = blksz * N;
+
+	for (Kblk = 0; Kblk < Num_BLK; Kblk++)
+	{
+		Awrk[jloc * blksz + iloc] = LOAD(A, Abase + jloc * N + iloc);
+		Bwrk[jloc * blksz + iloc] = LOAD(B, Bbase + jloc * N + iloc);
+
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+#pragma unroll
+		for (kloc = 0; kloc < blksz; kloc++)
+			Ctmp += Awrk[jloc * blksz + kloc] * Bwrk[kloc * blksz + iloc];
+
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		Abase += Ainc;
+		Bbase += Binc;
+	}
+
+	// epilogue in registers, one store
+	STORE(epilogue(Ctmp, j, i, N, alpha, beta, C, row_bias, col_bias, R), C, j * N + i);
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: epilogue_pass
+// Purpose: the same epilogue as a separate element-wise pass over a product
+//          P = A * B, the unfused reference for mat_mul_epilogue
+//
+// input: P T matrix of dimension N, the epilogue arguments as above
+// output: C T matrix of dimension N holding epilogue(P)
+//
+
+__kernel void epilogue_pass(
+		const		int				N,
+		__global	const		T* restrict P,
+		__global				T* restrict C,
+		const					ACC				alpha,
+		const					ACC				beta,
+		__global	const		T* restrict row_bias,
+		__global	const		T* restrict col_bias,
+		__global	const		T* restrict R)
+{
+	const int col = get_global_id(0);
+	const int row = get_global_id(1);
+
+	if ((row < N) && (col < N))
+		STORE(epilogue(LOAD(P, row * N + col), row, col, N, alpha, beta, C, row_bias, col_bias, R), C, row * N + col);
 }
\ No newline at end of file
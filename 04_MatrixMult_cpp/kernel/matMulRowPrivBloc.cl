@@ -28,26 +28,29 @@ __kernel void mat_mul(
 
 	float tmp;
 
+	// copy row of A into private memory
 	if (i < N) {
-		// copy row of A into private memory
 		for (k = 0; k < N; k++)
 			Awrk[k] = A[i * N + k];
+	}
 
+	// every work-item of the group reaches the barriers, also those past
+	// the last row of a padded range, they only help copying B
+	for (j = 0; j < N; j++) {
 
-		for (j = 0; j < N; j++) {
-
-			// pass a work array in local memoy to hold a column 
-			// of B
-			// all the work-items do the copy 
-			// "in parallel" using a cyclic loop distribution
-			// (hence why we need iloc and nloc)
+		// pass a work array in local memoy to hold a column 
+		// of B
+		// all the work-items do the copy 
+		// "in parallel" using a cyclic loop distribution
+		// (hence why we need iloc and nloc)
 
-			for (k = iloc; k < N; k += nloc) {
-				Bwrk[k] = B[k * N + k];
-			}
+		for (k = iloc; k < N; k += nloc) {
+			Bwrk[k] = B[k * N + j];
+		}
 
-			barrier(CLK_LOCAL_MEM_FENCE);
+		barrier(CLK_LOCAL_MEM_FENCE);
 
+		if (i < N) {
 			// use local scalar for intermediate C element values
 			tmp = 0.0f;
 			for (k = 0; k < N; k++) {
@@ -57,8 +60,8 @@ __kernel void mat_mul(
 
 			// write result to C
 			C[i * N + j] = tmp;
-
-			barrier(CLK_LOCAL_MEM_FENCE);
 		}
+
+		barrier(CLK_LOCAL_MEM_FENCE);
 	}
 }
\ No newline at end of file
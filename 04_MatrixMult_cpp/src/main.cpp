@@ -10,7 +10,10 @@
 
 #include "CL/cl.hpp"    // Khronos C++ Wrapper API
 
+#include <algorithm>
 #include <chrono> 
+#include <cmath>
+#include <memory>
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
@@ -18,16 +21,20 @@
 
 #include "filesystem.h"
 #include "util.hpp"
+#include "runtime.hpp"
+#include "il_program.hpp"
+#include "typed_program.hpp"
+#include "trace.hpp"
+#include "launch.hpp"
+#include "device_selector.hpp"
 #include "matrix_lib.h"
+#include "matrix_file.h"
 
 #include <iostream>
 #include <fstream>
 
 #include "config.h"
 
-// device index
-#define DEVICE_INDEX 0
-
 // flag if CPU Matrix multiplication shall be run
 #define RUN_CPU 0
 
@@ -40,36 +47,362 @@
 #define AVAL    3.0     // A elements are constant and equal to AVAL
 #define BVAL    5.0     // B elements are constant and equal to BVAL
 
+#define TYPED_ORDER 512 // order of the matrices of the type-generic multiplication
+
+#define EPILOGUE_ORDER  512 // order of the matrices of the fused epilogues, a multiple of 16
+#define EPILOGUE_RUNS   5   // timed runs of fused and unfused epilogues, the best one counts
+
 // --------------------------------------------------------------------------------------
 
+
 /// <summary>
-/// Gets the device list.
+/// Maps a matrix file holding a square float matrix the kernels can multiply.
 /// </summary>
-/// <param name="devices">The devices.</param>
-/// <returns></returns>
-unsigned getDeviceList(std::vector<cl::Device>& devices)
+/// <param name="path">The matrix file</param>
+/// <returns>The mapped matrix, or nullptr if the file cannot be used</returns>
+std::unique_ptr<matfile::MappedMatrix> mapMatrix(const std::string& path)
 {
-    cl_int err;
+    std::unique_ptr<matfile::MappedMatrix> mat;
 
-    // Get list of platforms
-    std::vector<cl::Platform> platforms;
-    cl::Platform::get(&platforms);
+    try {
+        mat.reset(new matfile::MappedMatrix(path));
+    }
+    catch (cl::Error err) {
+        std::cout << path << ": " << err.what() << std::endl;
+        return nullptr;
+    }
 
-    // Enumerate devices
-    for (int i = 0; i < platforms.size(); i++)
-    {
-        cl_uint num = 0;
-        std::vector<cl::Device> plat_devices;
-        platforms[i].getDevices(CL_DEVICE_TYPE_ALL, &plat_devices);
-        devices.insert(devices.end(), plat_devices.begin(), plat_devices.end());
+    const matfile::Header& header = mat->header();
+
+    // the row private kernels hold a row of A in a private array of ORDER
+    // elements and the blocked kernel works on 16x16 blocks
+    if (header.dtype != matfile::FLOAT32 || header.layout != matfile::ROW_MAJOR || header.rows != header.cols
+        || header.rows == 0 || header.rows > ORDER || header.rows % 16 != 0) {
+        std::cout << path << ": expected a square row major float matrix of an order that is a multiple of 16 up to "
+                  << ORDER << std::endl;
+        return nullptr;
+    }
+
+    return mat;
+}
+
+
+/// <summary>
+/// Multiplies two matrices of the element type T with the type-generic
+/// blocked kernel and prints the time, the rate and the check.
+/// </summary>
+/// <param name="device">The device</param>
+/// <param name="queue">The queue</param>
+/// <param name="N">The order of the matrices, a multiple of 16</param>
+template<typename T>
+void typedMatMul(const cl::Device& device, cl::CommandQueue& queue, int N)
+{
+    typedef ocl::ElementType<T> Type;
+
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+    ocl::Trace& trace = ocl::Trace::instance();
+
+    // small integers, the products and sums are exact in every type
+    std::vector<double> A(N * N), B(N * N);
+    std::vector<T> h_A(N * N), h_B(N * N), h_C(N * N);
+    for (int i = 0; i < N * N; i++) {
+        A[i] = (i % 5) - 2;
+        B[i] = (i % 3) - 1;
+        h_A[i] = Type::fromDouble(A[i]);
+        h_B[i] = Type::fromDouble(B[i]);
+    }
+
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY, sizeof(T) * N * N);
+    cl::Buffer d_b(context, CL_MEM_READ_ONLY, sizeof(T) * N * N);
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(T) * N * N);
+
+    trace.command("write", std::string("write A (") + Type::name() + ")", queue, [&](cl::Event& event) {
+        queue.enqueueWriteBuffer(d_a, CL_FALSE, 0, sizeof(T) * N * N, h_A.data(), nullptr, &event);
+    });
+    trace.command("write", std::string("write B (") + Type::name() + ")", queue, [&](cl::Event& event) {
+        queue.enqueueWriteBuffer(d_b, CL_FALSE, 0, sizeof(T) * N * N, h_B.data(), nullptr, &event);
+    });
+
+    // one program per type, cached by the runtime
+    cl::Program& program = ocl::typedProgram<T>(device, FileSystem::getPath("kernel/matMulBlocForm.cl"));
+    cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg> typed_mmul(program, "mat_mul");
+
+    // the blocks are held in the arithmetic type
+    cl::LocalSpaceArg A_block = cl::Local(sizeof(typename Type::acc_type) * 16 * 16);
+    cl::LocalSpaceArg B_block = cl::Local(sizeof(typename Type::acc_type) * 16 * 16);
+
+    std::string kernel_name = std::string("mat_mul (") + Type::name() + ")";
+
+    // warm up, then the timed run
+    trace.command("kernel", kernel_name, queue, [&](cl::Event& event) {
+        event = typed_mmul(cl::EnqueueArgs(queue, cl::NDRange(N, N), cl::NDRange(16, 16)), N, d_a, d_b, d_c, A_block, B_block);
+    });
+    queue.finish();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    trace.command("kernel", kernel_name, queue, [&](cl::Event& event) {
+        event = typed_mmul(cl::EnqueueArgs(queue, cl::NDRange(N, N), cl::NDRange(16, 16)), N, d_a, d_b, d_c, A_block, B_block);
+    });
+    queue.finish();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+
+    trace.command("read", "read C", queue, [&](cl::Event& event) {
+        queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(T) * N * N, h_C.data(), nullptr, &event);
+    });
+
+    int correct = 0;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            double expected = 0.0;
+            for (int k = 0; k < N; k++)
+                expected += A[i * N + k] * B[k * N + j];
+
+            if (std::fabs(Type::toDouble(h_C[i * N + j]) - expected) <= Type::epsilon() * std::fabs(expected))
+                correct++;
+        }
+    }
+
+    printf("%8s %10.3f ms %10.2f GFLOP/s %10d of %d correct\n", Type::name(), seconds * 1000.0,
+        2.0 * N * N * N / seconds / 1.0e9, correct, N * N);
+}
+
+/// <summary>
+/// Activation of an epilogue.
+/// </summary>
+enum Activation
+{
+    NONE,
+    RELU,
+    GELU
+};
+
+/// <summary>
+/// The steps of an epilogue of the blocked kernel (kernel/matMulBlocForm.cl),
+/// in the order they are applied.
+/// </summary>
+struct Epilogue
+{
+    const char* label;
+    bool scale;                 // alpha * A * B + beta * C
+    bool row_bias;
+    bool col_bias;
+    Activation activation;
+    bool residual;              // + R, after the activation
+};
+
+const Epilogue EPILOGUES[] = {
+    { "col bias + ReLU",                false,  false,  true,   RELU,   false },
+    { "col bias + GELU + residual",     false,  false,  true,   GELU,   true },
+    { "alpha, beta + row bias",         true,   true,   false,  NONE,   false },
+    { "all steps",                      true,   true,   true,   GELU,   true },
+};
+const int NEPILOGUES = sizeof(EPILOGUES) / sizeof(EPILOGUES[0]);
+
+/// <summary>
+/// The build options selecting the steps of an epilogue.
+/// </summary>
+std::string epilogueOptions(const Epilogue& e)
+{
+    std::string options;
+    if (e.scale)
+        options += " -DEPILOGUE_SCALE";
+    if (e.row_bias)
+        options += " -DEPILOGUE_ROW_BIAS";
+    if (e.col_bias)
+        options += " -DEPILOGUE_COL_BIAS";
+    if (e.activation == RELU)
+        options += " -DEPILOGUE_RELU";
+    if (e.activation == GELU)
+        options += " -DEPILOGUE_GELU";
+    if (e.residual)
+        options += " -DEPILOGUE_RESIDUAL";
+    return options;
+}
+
+/// <summary>
+/// The epilogue on the host, in double precision.
+/// </summary>
+double hostEpilogue(const Epilogue& e, double acc, double alpha, double beta, double c, double row_bias, double col_bias, double r)
+{
+    double x = acc;
+    if (e.scale)
+        x = alpha * x + beta * c;
+    if (e.row_bias)
+        x += row_bias;
+    if (e.col_bias)
+        x += col_bias;
+    if (e.activation == RELU)
+        x = std::max(x, 0.0);
+    if (e.activation == GELU)    // tanh approximation, 0.797... = sqrt(2 / pi)
+        x = 0.5 * x * (1.0 + std::tanh(0.7978845608028654 * (x + 0.044715 * x * x * x)));
+    if (e.residual)
+        x += r;
+    return x;
+}
+
+/// <summary>
+/// Runs an epilogue fused into the blocked kernel and as a separate pass
+/// after it, checks both against the host and prints the times.
+/// </summary>
+/// <param name="device">The device</param>
+/// <param name="queue">The queue</param>
+/// <param name="e">The epilogue</param>
+/// <param name="N">The order of the matrices, a multiple of 16</param>
+/// <param name="h_A">A</param>
+/// <param name="h_B">B</param>
+/// <param name="product">A * B on the host</param>
+void runEpilogue(const cl::Device& device, cl::CommandQueue& queue, const Epilogue& e, int N,
+    const std::vector<float>& h_A, const std::vector<float>& h_B, const std::vector<double>& product)
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+    ocl::Trace& trace = ocl::Trace::instance();
+
+    const int blocksize = 16;
+    float alpha = e.scale ? 0.5f : 1.0f;
+    float beta = e.scale ? 0.25f : 0.0f;
+
+    // the inputs of every step, passed whether the step is built or not
+    std::vector<float> h_C0(N * N), h_R(N * N), h_row_bias(N), h_col_bias(N), h_C(N * N);
+    for (int i = 0; i < N * N; i++) {
+        h_C0[i] = rand() / (float)RAND_MAX - 0.5f;
+        h_R[i] = rand() / (float)RAND_MAX - 0.5f;
+    }
+    for (int i = 0; i < N; i++) {
+        h_row_bias[i] = rand() / (float)RAND_MAX - 0.5f;
+        h_col_bias[i] = rand() / (float)RAND_MAX - 0.5f;
+    }
+
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY, sizeof(float) * N * N);
+    cl::Buffer d_b(context, CL_MEM_READ_ONLY, sizeof(float) * N * N);
+    cl::Buffer d_r(context, CL_MEM_READ_ONLY, sizeof(float) * N * N);
+    cl::Buffer d_row_bias(context, CL_MEM_READ_ONLY, sizeof(float) * N);
+    cl::Buffer d_col_bias(context, CL_MEM_READ_ONLY, sizeof(float) * N);
+    cl::Buffer d_p(context, CL_MEM_READ_WRITE, sizeof(float) * N * N);
+    cl::Buffer d_c(context, CL_MEM_READ_WRITE, sizeof(float) * N * N);
+
+    // the inputs, traced like every other command
+    auto upload = [&](const char* name, const cl::Buffer& buffer, const float* data, ::size_t count) {
+        trace.command("write", name, queue, [&](cl::Event& event) {
+            queue.enqueueWriteBuffer(buffer, CL_FALSE, 0, sizeof(float) * count, data, nullptr, &event);
+        });
+    };
+    upload("write A", d_a, h_A.data(), N * N);
+    upload("write B", d_b, h_B.data(), N * N);
+    upload("write R", d_r, h_R.data(), N * N);
+    upload("write row bias", d_row_bias, h_row_bias.data(), N);
+    upload("write col bias", d_col_bias, h_col_bias.data(), N);
+
+    // one program per epilogue, cached by the runtime
+    cl::Program& program = ocl::typedProgram<cl_float>(device, FileSystem::getPath("kernel/matMulBlocForm.cl"), epilogueOptions(e));
+
+    cl::Kernel& fused = runtime.kernel(program, "mat_mul_epilogue");
+    fused.setArg(0, N);
+    fused.setArg(1, d_a);
+    fused.setArg(2, d_b);
+    fused.setArg(3, d_c);
+    fused.setArg(4, cl::Local(sizeof(float) * blocksize * blocksize));
+    fused.setArg(5, cl::Local(sizeof(float) * blocksize * blocksize));
+    fused.setArg(6, alpha);
+    fused.setArg(7, beta);
+    fused.setArg(8, d_row_bias);
+    fused.setArg(9, d_col_bias);
+    fused.setArg(10, d_r);
+
+    cl::Kernel& mat_mul = runtime.kernel(program, "mat_mul");
+    mat_mul.setArg(0, N);
+    mat_mul.setArg(1, d_a);
+    mat_mul.setArg(2, d_b);
+    mat_mul.setArg(3, d_p);
+    mat_mul.setArg(4, cl::Local(sizeof(float) * blocksize * blocksize));
+    mat_mul.setArg(5, cl::Local(sizeof(float) * blocksize * blocksize));
+
+    cl::Kernel& pass = runtime.kernel(program, "epilogue_pass");
+    pass.setArg(0, N);
+    pass.setArg(1, d_p);
+    pass.setArg(2, d_c);
+    pass.setArg(3, alpha);
+    pass.setArg(4, beta);
+    pass.setArg(5, d_row_bias);
+    pass.setArg(6, d_col_bias);
+    pass.setArg(7, d_r);
+    ocl::LaunchConfig pass_launch = ocl::launchConfig2D(pass, device, N, N);
+
+    // C is read by the epilogue with beta != 0, so every run starts from C0
+    auto best = [&](bool fuse, std::vector<float>& result) {
+        double best_seconds = 1.0e30;
+
+        for (int r = 0; r <= EPILOGUE_RUNS; r++) {
+            upload("write C", d_c, h_C0.data(), N * N);
+            queue.finish();
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            if (fuse) {
+                trace.command("kernel", std::string("mat_mul_epilogue (") + e.label + ")", queue, [&](cl::Event& event) {
+                    queue.enqueueNDRangeKernel(fused, cl::NullRange, cl::NDRange(N, N), cl::NDRange(blocksize, blocksize), nullptr, &event);
+                });
+            }
+            else {
+                trace.command("kernel", "mat_mul (blocked)", queue, [&](cl::Event& event) {
+                    queue.enqueueNDRangeKernel(mat_mul, cl::NullRange, cl::NDRange(N, N), cl::NDRange(blocksize, blocksize), nullptr, &event);
+                });
+                trace.command("kernel", std::string("epilogue_pass (") + e.label + ")", queue, [&](cl::Event& event) {
+                    queue.enqueueNDRangeKernel(pass, cl::NullRange, pass_launch.global, pass_launch.local, nullptr, &event);
+                });
+            }
+            queue.finish();
+
+            auto stop = std::chrono::high_resolution_clock::now();
+
+            // the first run is the warm up
+            if (r > 0)
+                best_seconds = std::min(best_seconds, std::chrono::duration<double>(stop - start).count());
+        }
+
+        trace.command("read", "read C", queue, [&](cl::Event& event) {
+            queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * N * N, result.data(), nullptr, &event);
+        });
+        return best_seconds;
+    };
+
+    std::vector<float> h_fused(N * N), h_unfused(N * N);
+    double fused_seconds = best(true, h_fused);
+    double unfused_seconds = best(false, h_unfused);
+
+    int correct_fused = 0, correct_unfused = 0;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            int idx = i * N + j;
+            double expected = hostEpilogue(e, product[idx], alpha, beta, h_C0[idx], h_row_bias[i], h_col_bias[j], h_R[idx]);
+            double tol = TOL * std::fabs(expected) + TOL;
+
+            if (std::fabs(h_fused[idx] - expected) <= tol)
+                correct_fused++;
+            if (std::fabs(h_unfused[idx] - expected) <= tol)
+                correct_unfused++;
+        }
     }
 
-    return devices.size();
+    printf("%-28s %10.3f ms %10.3f ms %8.2fx %10d %10d of %d correct\n", e.label, fused_seconds * 1000.0,
+        unfused_seconds * 1000.0, unfused_seconds / fused_seconds, correct_fused, correct_unfused, N * N);
 }
 
 
-int main(void)
+/// <summary>
+/// Multiplies two matrices, either constant ones or two matrix files:
+///     MatrixMult [--device=...] [A.mat B.mat]
+///     MatrixMult --write A.mat B.mat      writes the constant matrices as files
+/// </summary>
+int main(int argc, char* argv[])
 {
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
     // Print Programm Infos
     std::cout << "OpenCL Expanded Vadd_Kernel CPP - Version " << 
        VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
@@ -79,6 +412,26 @@ int main(void)
 
     int Ndim = ORDER;                           // init dimensions to a global order  A[N][N], B[N][N], C[N][N]
 
+    // input matrices memory mapped from files
+    std::unique_ptr<matfile::MappedMatrix> file_A, file_B;
+    bool from_files = argc == 3;
+
+    if (from_files) {
+        file_A = mapMatrix(argv[1]);
+        file_B = mapMatrix(argv[2]);
+
+        if (!file_A || !file_B)
+            return EXIT_FAILURE;
+
+        if (file_A->rows() != file_B->rows()) {
+            std::cout << "The matrices in " << argv[1] << " and " << argv[2] << " differ in order" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Ndim = static_cast<int>(file_A->rows());
+        std::cout << "Multiplying the matrices in " << argv[1] << " and " << argv[2] << std::endl;
+    }
+
     int szA, szB, szC;                          // num elements in each matrix
 
     szA = Ndim * Ndim;                          // sizes of the matrices
@@ -100,6 +453,23 @@ int main(void)
     // zero mat C
     initmat(Ndim, Ndim, h_C, 0.0f);
 
+    if (argc == 4 && std::string(argv[1]) == "--write") {
+        try {
+            matfile::write(argv[2], Ndim, Ndim, h_A);
+            matfile::write(argv[3], Ndim, Ndim, h_B);
+        }
+        catch (cl::Error err) {
+            std::cout << err.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Wrote A to " << argv[2] << " and B to " << argv[3] << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    // the inputs on the host, the mapped payloads if read from files
+    const float* A_data = from_files ? file_A->as<float>() : h_A.data();
+    const float* B_data = from_files ? file_B->as<float>() : h_B.data();
+
     // Run sequential mat mult on CPU
 #if RUN_CPU
     {
@@ -108,7 +478,7 @@ int main(void)
         // start timepoint
         auto start = std::chrono::high_resolution_clock::now();
 
-        mat_mul(Ndim, h_A, h_B, h_C);
+        mat_mul(Ndim, A_data, B_data, h_C.data());
 
         // end time stopping
         auto stop = std::chrono::high_resolution_clock::now();
@@ -124,33 +494,36 @@ int main(void)
     // zero mat C
     initmat(Ndim, Ndim, h_C, 0.0f);
 
-    try 
-    {        
-        // Get list of devices
-        std::vector<cl::Device> devices;
-        unsigned numDevices = getDeviceList(devices);
+    // the expected result, errors of file inputs are relative to its magnitude
+    float ref_scale = 1.0f;
 
-        // check if device indes is in range
-        if (DEVICE_INDEX >= numDevices)
-        {
-            std::cout << "Invalid device index \n" << std::endl;
-            return EXIT_FAILURE;
-        }
+    if (from_files) {
+        mat_mul(Ndim, A_data, B_data, h_Ctest.data());
+        for (int i = 0; i < szC; i++)
+            ref_scale = std::max(ref_scale, std::fabs(h_Ctest[i]));
+    }
+    else {
+        initmat(Ndim, Ndim, h_Ctest, Ndim * AVAL * BVAL);
+    }
 
-        cl::Device device = devices[DEVICE_INDEX];
+    try 
+    {        
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
         
         // print device name of the chosen device 
         std::string name = device.getInfo<CL_DEVICE_NAME>();
         std::cout << "\nUsing OpenCL Device " << name << std::endl;
 
-        // chosen device needs to be pushed in as an array
-        std::vector<cl::Device> chosen_device;
-        chosen_device.push_back(device);
+        // OCL_TRACE=<file> records the writes, kernels and reads as a Chrome trace,
+        // the queue then has profiling enabled
+        ocl::Trace& trace = ocl::Trace::instance();
 
-        // create a context
-        cl::Context context(chosen_device);
+        // context and queue of the device from the shared runtime
+        ocl::Runtime& runtime = ocl::Runtime::instance();
+        cl::Context context = runtime.context(device);
         // Get the command queue
-        cl::CommandQueue queue(context, device);
+        cl::CommandQueue queue = runtime.queue(device, trace.queueProperties());
 
         //--------------------------------------------------------------------------------
         // OpenCL matrix multiplication ... Naive
@@ -159,26 +532,48 @@ int main(void)
 
         // Load in kernel source, creating a program object for the context
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        cl::Program program(context, util::loadProgram(FileSystem::getPath("kernel/matMul.cl")), true);
+        // the runtime loads and builds the program once and caches it,
+        // build flags are the optional 3rd parameter
+        cl::Program program = runtime.program(device, FileSystem::getPath("kernel/matMul.cl"));
        
         // create the kernel functor
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer>naive_mmul(program, "mat_mul");
+        cl::Kernel ko_naive(program, "mat_mul");
+        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer>naive_mmul(ko_naive);
+
+        // entire range of C matrix elements, padded to whole work-groups
+        ocl::LaunchConfig naive_launch = ocl::launchConfig2D(ko_naive, device, Ndim, Ndim);
               
 
         // buffer construction
-        // - this is a blcoking call
-        // - constructor will enqueue a copy to the first device in the context
-        // - ocl runtime will AUTOMATICALLY ensure the buffer is copied across to the actual device you enqueue a kenrel on later
-        //   if you enqueue the kernel on a different device within this context
-        // 1st parameter context to use
-        // 2nd parameter startIterator
-        // 3rd parameter endIterator
-        // 4th parameter readOnly boolen, specifies whether the memory is: CL_MEM_READ_ONLY (true) or CL_MEM_READ_WRITE (false)
-        // 5th parameter useHostPtr, array defined by itrators is implicitly copied into device memory(default: false)
-        d_a = cl::Buffer(context, h_A.begin(), h_A.end(), true);
-        d_b = cl::Buffer(context, h_B.begin(), h_B.end(), true);
+        // - the buffers are created empty and filled by a write on the queue
+        // - the in-order queue runs the kernels after the writes, the trace
+        //   records the writes next to the kernels
+        if (from_files) {
+            // the mapped pages back the buffers on devices sharing host memory,
+            // otherwise they are uploaded with one write each
+            if (device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE) {
+                d_a = file_A->buffer(context, queue, true);
+                d_b = file_B->buffer(context, queue, true);
+            }
+            else {
+                trace.command("write", "write A", queue, [&](cl::Event& event) {
+                    d_a = file_A->buffer(context, queue, false, &event);
+                });
+                trace.command("write", "write B", queue, [&](cl::Event& event) {
+                    d_b = file_B->buffer(context, queue, false, &event);
+                });
+            }
+        }
+        else {
+            d_a = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * szA);
+            d_b = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * szB);
+            trace.command("write", "write A", queue, [&](cl::Event& event) {
+                queue.enqueueWriteBuffer(d_a, CL_FALSE, 0, sizeof(float) * szA, h_A.data(), nullptr, &event);
+            });
+            trace.command("write", "write B", queue, [&](cl::Event& event) {
+                queue.enqueueWriteBuffer(d_b, CL_FALSE, 0, sizeof(float) * szB, h_B.data(), nullptr, &event);
+            });
+        }
 
         d_c = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * szC);
  
@@ -193,16 +588,15 @@ int main(void)
             // start timepoint
             auto start = std::chrono::high_resolution_clock::now();
 
-            // entire range of C matrix elements
-            cl::NDRange global(Ndim, Ndim);
-
             // RUN C = A*B
-            naive_mmul(
-                cl::EnqueueArgs(queue, global),
-                Ndim,
-                d_a,
-                d_b,
-                d_c);
+            trace.command("kernel", "mat_mul (naive)", queue, [&](cl::Event& event) {
+                event = naive_mmul(
+                    cl::EnqueueArgs(queue, naive_launch.global, naive_launch.local),
+                    Ndim,
+                    d_a,
+                    d_b,
+                    d_c);
+            });
 
             queue.finish();
 
@@ -215,7 +609,9 @@ int main(void)
             std::cout << "Time taken by execution " << duration.count() / 1000 << " milliseconds at " << mflops << " MFLOPS" << std::endl;
 
             // copy data back from device
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            trace.command("read", "read C", queue, [&](cl::Event& event) {
+                queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * szC, h_C.data(), nullptr, &event);
+            });
 
             // test the results
             int correct = 0;
@@ -224,7 +620,7 @@ int main(void)
             for (int i = 0; i < Ndim; i++) {
                 for (int j = 0; j < Ndim; j++) {
                     // check if matrix mult was sucessfull
-                    float err = h_C[i * Ndim + j] - (Ndim * AVAL * BVAL);
+                    float err = (h_C[i * Ndim + j] - h_Ctest[i * Ndim + j]) / ref_scale;
                     errsq += err * err;
                 }
             }
@@ -241,12 +637,15 @@ int main(void)
 
         std::cout << "\n===== OpenCL, matrix mult, C row per work item, order " << Ndim << " ======\n" << std::endl;
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        program = cl::Program(context, util::loadProgram(FileSystem::getPath("kernel/matMulRow.cl")), true);
+        // loaded and built by the runtime on first use
+        program = runtime.program(device, FileSystem::getPath("kernel/matMulRow.cl"));
        
         // create the kernel functor
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer>crow_mmul(program, "mat_mul");
+        cl::Kernel ko_crow(program, "mat_mul");
+        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer>crow_mmul(ko_crow);
+
+        // one work item per row of C
+        ocl::LaunchConfig crow_launch = ocl::launchConfig(ko_crow, device, Ndim);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
@@ -256,16 +655,15 @@ int main(void)
             // start timepoint
             auto start = std::chrono::high_resolution_clock::now();
 
-            // entire range of C matrix elements
-            cl::NDRange global(Ndim);
-
             // RUN C = A*B
-            crow_mmul(
-                cl::EnqueueArgs(queue, global),
-                Ndim,
-                d_a,
-                d_b,
-                d_c);
+            trace.command("kernel", "mat_mul (C row)", queue, [&](cl::Event& event) {
+                event = crow_mmul(
+                    cl::EnqueueArgs(queue, crow_launch.global, crow_launch.local),
+                    Ndim,
+                    d_a,
+                    d_b,
+                    d_c);
+            });
 
             queue.finish();
 
@@ -278,7 +676,9 @@ int main(void)
             std::cout << "Time taken by execution " << duration.count() / 1000 << " milliseconds at " << mflops << " MFLOPS" << std::endl;
 
             // copy data back from device
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            trace.command("read", "read C", queue, [&](cl::Event& event) {
+                queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * szC, h_C.data(), nullptr, &event);
+            });
 
             // test the results
             int correct = 0;
@@ -287,7 +687,7 @@ int main(void)
             for (int i = 0; i < Ndim; i++) {
                 for (int j = 0; j < Ndim; j++) {
                     // check if matrix mult was sucessfull
-                    float err = h_C[i * Ndim + j] - (Ndim * AVAL * BVAL);
+                    float err = (h_C[i * Ndim + j] - h_Ctest[i * Ndim + j]) / ref_scale;
                     errsq += err * err;
                 }
             }
@@ -304,12 +704,15 @@ int main(void)
 
         std::cout << "\n===== OpenCL, matrix mult, C row, A row in priv mem, order " << Ndim << " ======\n" << std::endl;
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        program = cl::Program(context, util::loadProgram(FileSystem::getPath("kernel/matMulRowPriv.cl")), true);
+        // loaded and built by the runtime on first use
+        program = runtime.program(device, FileSystem::getPath("kernel/matMulRowPriv.cl"));
 
         // create the kernel functor
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer>arowpriv_mmul(program, "mat_mul");
+        cl::Kernel ko_arowpriv(program, "mat_mul");
+        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer>arowpriv_mmul(ko_arowpriv);
+
+        // one work item per row of C
+        ocl::LaunchConfig arowpriv_launch = ocl::launchConfig(ko_arowpriv, device, Ndim);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
@@ -319,17 +722,15 @@ int main(void)
             // start timepoint
             auto start = std::chrono::high_resolution_clock::now();
 
-            // entire range of C matrix elements
-            cl::NDRange global(Ndim);
-            cl::NDRange local(ORDER / 16);
-
             // RUN C = A*B
-            arowpriv_mmul(
-                cl::EnqueueArgs(queue, global, local),
-                Ndim,
-                d_a,
-                d_b,
-                d_c);
+            trace.command("kernel", "mat_mul (A row private)", queue, [&](cl::Event& event) {
+                event = arowpriv_mmul(
+                    cl::EnqueueArgs(queue, arowpriv_launch.global, arowpriv_launch.local),
+                    Ndim,
+                    d_a,
+                    d_b,
+                    d_c);
+            });
 
             queue.finish();
 
@@ -342,7 +743,9 @@ int main(void)
             std::cout << "Time taken by execution " << duration.count() / 1000 << " milliseconds at " << mflops << " MFLOPS" << std::endl;
 
             // copy data back from device
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            trace.command("read", "read C", queue, [&](cl::Event& event) {
+                queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * szC, h_C.data(), nullptr, &event);
+            });
            
             // test the results
             int correct = 0;
@@ -351,7 +754,7 @@ int main(void)
             for (int i = 0; i < Ndim; i++) {
                 for (int j = 0; j < Ndim; j++) {
                     // check if matrix mult was sucessfull
-                    float err = h_C[i * Ndim + j] - (Ndim * AVAL * BVAL);
+                    float err = (h_C[i * Ndim + j] - h_Ctest[i * Ndim + j]) / ref_scale;
                     errsq += err * err;
                 }
             }
@@ -368,12 +771,15 @@ int main(void)
 
         std::cout << "\n===== OpenCL, mat mult, C row, priv A, B cols loc, order " << Ndim << " ======\n" << std::endl;
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        program = cl::Program(context, util::loadProgram(FileSystem::getPath("kernel/matMulRowPrivBloc.cl")), true);
+        // loaded and built by the runtime on first use
+        program = runtime.program(device, FileSystem::getPath("kernel/matMulRowPrivBloc.cl"));
 
         // create the kernel functor
-        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg>browloc_mmul(program, "mat_mul");
+        cl::Kernel ko_browloc(program, "mat_mul");
+        cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg>browloc_mmul(ko_browloc);
+
+        // one work item per row of C, every work-group holds a column of B in local memory
+        ocl::LaunchConfig browloc_launch = ocl::launchConfig(ko_browloc, device, Ndim, 0, sizeof(float) * Ndim);
 
         // Do the multiplication COUNT times
         for (int i = 0; i < COUNT; i++)
@@ -383,19 +789,18 @@ int main(void)
             // start timepoint
             auto start = std::chrono::high_resolution_clock::now();
 
-            // entire range of C matrix elements
-            cl::NDRange global(Ndim);
-            cl::NDRange local(ORDER / 16);
             // calc size of local memory in bytes
             cl::LocalSpaceArg localmem = cl::Local(sizeof(float) * Ndim);
 
             // RUN C = A*B
-            browloc_mmul(
-                cl::EnqueueArgs(queue, global, local),
-                Ndim,
-                d_a,
-                d_b,
-                d_c, localmem);
+            trace.command("kernel", "mat_mul (B row local)", queue, [&](cl::Event& event) {
+                event = browloc_mmul(
+                    cl::EnqueueArgs(queue, browloc_launch.global, browloc_launch.local),
+                    Ndim,
+                    d_a,
+                    d_b,
+                    d_c, localmem);
+            });
 
             queue.finish();
 
@@ -408,7 +813,9 @@ int main(void)
             std::cout << "Time taken by execution " << duration.count() / 1000 << " milliseconds at " << mflops << " MFLOPS" << std::endl;
 
             // copy data back from device
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            trace.command("read", "read C", queue, [&](cl::Event& event) {
+                queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * szC, h_C.data(), nullptr, &event);
+            });
 
             // test the results
             int correct = 0;
@@ -417,7 +824,7 @@ int main(void)
             for (int i = 0; i < Ndim; i++) {
                 for (int j = 0; j < Ndim; j++) {
                     // check if matrix mult was sucessfull
-                    float err = h_C[i * Ndim + j] - (Ndim * AVAL * BVAL);
+                    float err = (h_C[i * Ndim + j] - h_Ctest[i * Ndim + j]) / ref_scale;
                     errsq += err * err;
                 }
             }
@@ -434,9 +841,8 @@ int main(void)
 
         std::cout << "\n===== Parallel matrix mult (blocked), order " << Ndim << " on device ======\n" << std::endl;
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        program = cl::Program(context, util::loadProgram(FileSystem::getPath("kernel/matMulBlocForm.cl")), true);
+        // the type-generic kernel for float, built by the runtime on first use
+        program = ocl::typedProgram<cl_float>(device, FileSystem::getPath("kernel/matMulBlocForm.cl"));
   
         // create the kernel functor
         cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg>block_mmul(program, "mat_mul");
@@ -465,14 +871,16 @@ int main(void)
             // RUN C = A*B
             cl::make_kernel<int, cl::Buffer, cl::Buffer, cl::Buffer, cl::LocalSpaceArg, cl::LocalSpaceArg>block_mmul(program, "mat_mul");
        
-            block_mmul(
-                cl::EnqueueArgs(queue, global, local),
-                Ndim,
-                d_a,
-                d_b,
-                d_c,
-                A_block,
-                B_block);
+            trace.command("kernel", "mat_mul (blocked)", queue, [&](cl::Event& event) {
+                event = block_mmul(
+                    cl::EnqueueArgs(queue, global, local),
+                    Ndim,
+                    d_a,
+                    d_b,
+                    d_c,
+                    A_block,
+                    B_block);
+            });
 
             queue.finish();
 
@@ -485,7 +893,9 @@ int main(void)
             std::cout << "Time taken by execution " << duration.count() / 1000 << " milliseconds at " << mflops << " MFLOPS" << std::endl;
 
             // copy data back from device
-            cl::copy(queue, d_c, h_C.begin(), h_C.end());
+            trace.command("read", "read C", queue, [&](cl::Event& event) {
+                queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * szC, h_C.data(), nullptr, &event);
+            });
 
             // test the results
             int correct = 0;
@@ -494,7 +904,7 @@ int main(void)
             for (int i = 0; i < Ndim; i++) {
                 for (int j = 0; j < Ndim; j++) {
                     // check if matrix mult was sucessfull
-                    float err = h_C[i * Ndim + j] - (Ndim * AVAL * BVAL);
+                    float err = (h_C[i * Ndim + j] - h_Ctest[i * Ndim + j]) / ref_scale;
                     errsq += err * err;
                 }
             }
@@ -504,6 +914,83 @@ int main(void)
             }
 
         }
+
+        //--------------------------------------------------------------------------------
+        // OpenCL matrix multiplication ... type-generic blocked
+        //--------------------------------------------------------------------------------
+
+        // the blocked kernel written once for an element type T, built per type
+        // through build options; half is stored in 16 bits and multiplied in float
+        std::cout << "\n===== OpenCL, type-generic blocked matrix mult, order " << TYPED_ORDER << " ======\n" << std::endl;
+
+        typedMatMul<cl_int>(device, queue, TYPED_ORDER);
+        typedMatMul<cl_float>(device, queue, TYPED_ORDER);
+        if (ocl::ElementType<cl_double>::supported(device))
+            typedMatMul<cl_double>(device, queue, TYPED_ORDER);
+        else
+            std::cout << "  double not supported by the device" << std::endl;
+        typedMatMul<ocl::half>(device, queue, TYPED_ORDER);
+
+        //--------------------------------------------------------------------------------
+        // OpenCL matrix multiplication ... blocked with fused epilogues
+        //--------------------------------------------------------------------------------
+
+        // bias, activation, scaling and residual applied before the single
+        // store of C, against a second element-wise pass that reads C back
+        std::cout << "\n===== OpenCL, blocked matrix mult with fused epilogues, order " << EPILOGUE_ORDER << " ======\n" << std::endl;
+
+        {
+            const int N = EPILOGUE_ORDER;
+
+            std::vector<float> e_A(N * N), e_B(N * N);
+            for (int i = 0; i < N * N; i++) {
+                e_A[i] = rand() / (float)RAND_MAX - 0.5f;
+                e_B[i] = rand() / (float)RAND_MAX - 0.5f;
+            }
+
+            // the product on the host, shared by all epilogues
+            std::vector<double> product(N * N);
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; j < N; j++) {
+                    double tmp = 0.0;
+                    for (int k = 0; k < N; k++)
+                        tmp += (double)e_A[i * N + k] * e_B[k * N + j];
+                    product[i * N + j] = tmp;
+                }
+            }
+
+            printf("%-28s %13s %13s %9s %10s %10s\n", "epilogue", "fused", "separate", "speedup", "fused", "separate");
+
+            for (int e = 0; e < NEPILOGUES; e++)
+                runEpilogue(device, queue, EPILOGUES[e], N, e_A, e_B, product);
+        }
+
+        //--------------------------------------------------------------------------------
+        // Program build latency ... OpenCL C source against SPIR-V
+        //--------------------------------------------------------------------------------
+
+        // the SPIR-V modules embedded at build time skip the front end of the driver
+        std::cout << "\n===== Program build latency, SPIR-V " << (ocl::supportsIL(device) ? "supported" : "not supported")
+                  << " by the device ======\n" << std::endl;
+        printf("%-28s %14s %14s %14s %14s\n", "kernel file", "source first", "source avg", "SPIR-V first", "SPIR-V avg");
+
+        // the type-generic matMulBlocForm.cl only builds with the type options, so it is not embedded as SPIR-V
+        const char* kernel_files[] = { "kernel/matMul.cl", "kernel/matMulRow.cl", "kernel/matMulRowPriv.cl",
+            "kernel/matMulRowPrivBloc.cl" };
+
+        for (const char* file : kernel_files)
+        {
+            ocl::BuildLatency latency = ocl::measureBuildLatency(device, FileSystem::getPath(file));
+
+            if (latency.il_first < 0.0)
+                printf("%-28s %11.2f ms %11.2f ms %14s %14s\n", file, latency.source_first, latency.source_average, "-", "-");
+            else
+                printf("%-28s %11.2f ms %11.2f ms %11.2f ms %11.2f ms\n", file, latency.source_first, latency.source_average,
+                    latency.il_first, latency.il_average);
+        }
+
+        // the timeline, if OCL_TRACE asked for one
+        trace.write();
     }
     // catch opencl error
     catch (cl::Error err) {
@@ -0,0 +1,287 @@
+//------------------------------------------------------------------------------
+//
+//  Binary matrix files
+//
+//  A fixed 64 byte header (shape, dtype, layout, alignment) followed by the
+//  dense payload at an offset that is a multiple of the alignment (a page).
+//  Files are memory mapped, so the payload can be handed to the OpenCL
+//  runtime directly, either as the host pointer of a CL_MEM_USE_HOST_PTR
+//  buffer or as the source of a single enqueueWriteBuffer, without being
+//  parsed or copied into a std::vector first.
+//
+//  Vectors are stored as matrices with one column.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __MATRIX_FILE_HDR
+#define __MATRIX_FILE_HDR
+
+#include "CL/cl.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace matfile {
+
+    const char MAGIC[8] = { 'O', 'C', 'L', 'M', 'A', 'T', '\0', '\0' };
+    const uint32_t VERSION = 1;
+
+    // default payload alignment, a multiple of the page size of common systems
+    const uint64_t DEFAULT_ALIGNMENT = 4096;
+
+    enum DType : uint32_t { FLOAT32 = 0, FLOAT64 = 1, INT32 = 2, UINT32 = 3 };
+    enum Layout : uint32_t { ROW_MAJOR = 0, COL_MAJOR = 1 };
+
+    /// <summary>
+    /// Size of an element of the type in bytes.
+    /// </summary>
+    inline uint64_t dtype_size(uint32_t dtype)
+    {
+        switch (dtype) {
+        case FLOAT32: return 4;
+        case FLOAT64: return 8;
+        case INT32:   return 4;
+        case UINT32:  return 4;
+        default:      return 0;
+        }
+    }
+
+    /// <summary>
+    /// The file header, stored little endian at the start of the file.
+    /// </summary>
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t dtype;         // DType
+        uint32_t layout;        // Layout
+        uint32_t reserved;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t alignment;     // the payload offset is a multiple of it
+        uint64_t offset;        // byte offset of the payload
+        uint64_t bytes;         // byte size of the payload
+    };
+
+    static_assert(sizeof(Header) == 64, "matfile::Header has to be 64 bytes");
+
+    /// <summary>
+    /// Writes a matrix file.
+    /// </summary>
+    /// <param name="path">The file</param>
+    /// <param name="rows">Number of rows</param>
+    /// <param name="cols">Number of columns</param>
+    /// <param name="dtype">Type of the elements</param>
+    /// <param name="layout">Storage order of the elements</param>
+    /// <param name="data">rows * cols elements</param>
+    /// <param name="alignment">Alignment of the payload, a multiple of the page size</param>
+    inline void write(const std::string& path, uint64_t rows, uint64_t cols, DType dtype, Layout layout,
+        const void* data, uint64_t alignment = DEFAULT_ALIGNMENT)
+    {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.dtype = dtype;
+        header.layout = layout;
+        header.rows = rows;
+        header.cols = cols;
+        header.alignment = alignment;
+        header.offset = (sizeof(Header) + alignment - 1) / alignment * alignment;
+        header.bytes = rows * cols * dtype_size(dtype);
+
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (!file.is_open())
+            throw cl::Error(CL_INVALID_VALUE, "matfile::write cannot open file");
+
+        std::vector<char> padding(header.offset - sizeof(Header), 0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding.data(), padding.size());
+        file.write(static_cast<const char*>(data), header.bytes);
+
+        if (!file)
+            throw cl::Error(CL_INVALID_VALUE, "matfile::write failed");
+    }
+
+    /// <summary>
+    /// Writes a row major float matrix.
+    /// </summary>
+    inline void write(const std::string& path, uint64_t rows, uint64_t cols, const std::vector<float>& data)
+    {
+        if (data.size() != rows * cols)
+            throw cl::Error(CL_INVALID_VALUE, "matfile::write size mismatch");
+
+        write(path, rows, cols, FLOAT32, ROW_MAJOR, data.data());
+    }
+
+    /// <summary>
+    /// A memory mapped matrix file.
+    ///
+    /// The mapping is private (copy on write): the OpenCL runtime may write
+    /// to a CL_MEM_USE_HOST_PTR buffer without the file being modified.
+    /// The mapping has to outlive every buffer created with useHostPtr.
+    /// </summary>
+    class MappedMatrix
+    {
+    public:
+        /// <summary>
+        /// Maps the file and validates its header.
+        /// </summary>
+        /// <param name="path">The file</param>
+        explicit MappedMatrix(const std::string& path)
+            : base_(NULL), size_(0)
+        {
+#ifdef _WIN32
+            file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file_ == INVALID_HANDLE_VALUE)
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix cannot open file");
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_, &size)) {
+                CloseHandle(file_);
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix cannot stat file");
+            }
+            size_ = static_cast<::size_t>(size.QuadPart);
+
+            mapping_ = CreateFileMappingA(file_, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+            if (mapping_ != NULL)
+                base_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0));
+#else
+            file_ = open(path.c_str(), O_RDONLY);
+            if (file_ < 0)
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix cannot open file");
+
+            struct stat st;
+            if (fstat(file_, &st) != 0) {
+                close();
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix cannot stat file");
+            }
+            size_ = static_cast<::size_t>(st.st_size);
+
+            void* base = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, file_, 0);
+            base_ = (base == MAP_FAILED) ? NULL : static_cast<char*>(base);
+#endif
+            if (base_ == NULL) {
+                close();
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix cannot map file");
+            }
+
+            if (size_ < sizeof(Header)) {
+                close();
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix file too small");
+            }
+
+            std::memcpy(&header_, base_, sizeof(Header));
+
+            // the shape is checked before its product, the payload without
+            // adding to the offset: neither may wrap around for any header
+            uint64_t element = dtype_size(header_.dtype);
+            if (std::memcmp(header_.magic, MAGIC, sizeof(MAGIC)) != 0 || header_.version != VERSION
+                || element == 0
+                || (header_.cols != 0 && header_.rows > UINT64_MAX / header_.cols / element)
+                || header_.bytes != header_.rows * header_.cols * element
+                || header_.alignment == 0 || (header_.alignment & (header_.alignment - 1)) != 0
+                || header_.offset % header_.alignment != 0 || header_.offset < sizeof(Header)
+                || header_.offset > size_ || header_.bytes > size_ - header_.offset) {
+                close();
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix invalid header");
+            }
+        }
+
+        ~MappedMatrix()
+        {
+            close();
+        }
+
+        const Header& header() const { return header_; }
+        uint64_t rows() const { return header_.rows; }
+        uint64_t cols() const { return header_.cols; }
+        uint64_t bytes() const { return header_.bytes; }
+
+        /// <summary>
+        /// The payload, aligned to the alignment of the file.
+        /// </summary>
+        const void* data() const { return base_ + header_.offset; }
+
+        /// <summary>
+        /// The payload as elements of type T.
+        /// </summary>
+        template<typename T>
+        const T* as() const
+        {
+            if (sizeof(T) != dtype_size(header_.dtype))
+                throw cl::Error(CL_INVALID_VALUE, "matfile::MappedMatrix type mismatch");
+            return reinterpret_cast<const T*>(data());
+        }
+
+        /// <summary>
+        /// Creates a read-only device buffer holding the payload.
+        ///
+        /// With useHostPtr the mapped pages back the buffer (CL_MEM_USE_HOST_PTR),
+        /// which avoids any copy on devices sharing host memory. Otherwise the
+        /// payload is uploaded with a single blocking write.
+        /// </summary>
+        /// <param name="context">The context</param>
+        /// <param name="queue">The queue of the upload</param>
+        /// <param name="useHostPtr">Use the mapping as host pointer of the buffer</param>
+        /// <param name="event">The event of the upload, unset with useHostPtr</param>
+        cl::Buffer buffer(const cl::Context& context, cl::CommandQueue& queue, bool useHostPtr, cl::Event* event = NULL) const
+        {
+            if (useHostPtr)
+                return cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, header_.bytes, base_ + header_.offset);
+
+            cl::Buffer buffer(context, CL_MEM_READ_ONLY, header_.bytes);
+            queue.enqueueWriteBuffer(buffer, CL_TRUE, 0, header_.bytes, data(), NULL, event);
+            return buffer;
+        }
+
+    private:
+        // no copies, the mapping is owned
+        MappedMatrix(const MappedMatrix&);
+        MappedMatrix& operator=(const MappedMatrix&);
+
+        void close()
+        {
+#ifdef _WIN32
+            if (base_ != NULL)
+                UnmapViewOfFile(base_);
+            if (mapping_ != NULL)
+                CloseHandle(mapping_);
+            CloseHandle(file_);
+#else
+            if (base_ != NULL)
+                munmap(base_, size_);
+            ::close(file_);
+#endif
+            base_ = NULL;
+        }
+
+#ifdef _WIN32
+        HANDLE file_;
+        HANDLE mapping_;
+#else
+        int file_;
+#endif
+        char* base_;
+        ::size_t size_;
+        Header header_;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -19,7 +19,7 @@
 /// <param name="A">Matrix A</param>
 /// <param name="B">Matrix B</param>
 /// <param name="C">Matrix C</param>
-void mat_mul(int dim, std::vector<float>& A, std::vector<float>& B, std::vector<float>& C)
+void mat_mul(int dim, const float* A, const float* B, float* C)
 {
     int i, j, k;
     float tmp;
@@ -36,6 +36,19 @@ void mat_mul(int dim, std::vector<float>& A, std::vector<float>& B, std::vector<
     }
 }
 
+/// <summary>
+/// Multiplies the Matrix A with the Matrix B each of dimension N and writes the result to C.
+/// Serial CPU implementation
+/// </summary>
+/// <param name="dim">The dimension of the matrices</param>
+/// <param name="A">Matrix A</param>
+/// <param name="B">Matrix B</param>
+/// <param name="C">Matrix C</param>
+void mat_mul(int dim, std::vector<float>& A, std::vector<float>& B, std::vector<float>& C)
+{
+    mat_mul(dim, A.data(), B.data(), C.data());
+}
+
 /// <summary>
 /// Function to initialize the input matrix
 /// </summary>
@@ -0,0 +1,159 @@
+// --------------------------------------------------------------------------------------
+// Monte Carlo integration of 4/(1+x*x) from 0 to 1
+//
+// The random numbers are generated on the device with the counter-based
+// Philox4x32-10 generator (Salmon et al., "Parallel Random Numbers: As Easy
+// as 1, 2, 3"). Every work-item owns a disjoint range of counters, so no
+// random numbers have to be transferred and the result is reproducible
+// for a given seed independent of the work decomposition.
+//
+// This source is built together with numIntegration.cl and reuses its
+// reduce() function for the per work-group partial sums.
+//
+
+#define PHILOX_M0	0xD2511F53u		// multipliers
+#define PHILOX_M1	0xCD9E8D57u
+#define PHILOX_W0	0x9E3779B9u		// key schedule (golden ratio, sqrt(3)-1)
+#define PHILOX_W1	0xBB67AE85u
+
+#define PHILOX_ROUNDS 10
+
+void reduce(
+	__local float*,
+	__global float*);
+
+// --------------------------------------------------------------------------------------
+// function: philox4x32
+// Purpose: scramble a 128 bit counter with a 64 bit key, in place
+//
+// input: uint ctr[4] counter
+//        uint key[2] key (the seed)
+//
+// output: uint ctr[4] four independent uniformly distributed 32 bit values
+//
+
+void philox4x32(
+	uint ctr[4],
+	const uint key[2])
+{
+	uint k0 = key[0];
+	uint k1 = key[1];
+	uint hi0, lo0, hi1, lo1;
+	int r;
+
+	for (r = 0; r < PHILOX_ROUNDS; r++) {
+		hi0 = mul_hi(PHILOX_M0, ctr[0]);
+		lo0 = PHILOX_M0 * ctr[0];
+		hi1 = mul_hi(PHILOX_M1, ctr[2]);
+		lo1 = PHILOX_M1 * ctr[2];
+
+		ctr[0] = hi1 ^ ctr[1] ^ k0;
+		ctr[1] = lo1;
+		ctr[2] = hi0 ^ ctr[3] ^ k1;
+		ctr[3] = lo0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+}
+
+// --------------------------------------------------------------------------------------
+// function: uniform
+// Purpose: map 32 random bits onto the open interval (0, 1)
+//
+
+float uniform(uint bits)
+{
+	// keep the 24 bits a float mantissa can hold and center them in their cell
+	return ((float)(bits >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+// --------------------------------------------------------------------------------------
+// function: integrand
+// Purpose: the function integrated over the unit interval
+//
+
+float integrand(float x)
+{
+	return 4.0f / (1.0f + x * x);
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: mc_pi
+// Purpose: accumulate partial sums of f(x) and f(x)^2 at random points x,
+//          four samples per Philox call. A work item adds up to 4 * niters
+//          samples, so the sums are compensated (Kahan): the rounding error
+//          of a plain float sum grows with the number of terms, and it stops
+//          growing at all after about 2^24 of them.
+//          Do not build with -cl-fast-relaxed-math, which may drop the
+//          compensation.
+//
+// input: uint  niters Philox calls per work item (each call draws 4 samples)
+//        ulong nsamples total number of samples (work items past the end do less)
+//        uint  seed_lo, seed_hi the 64 bit Philox key
+//        local float* arrays to hold the sums from each work item
+//
+// output: partial_sums    float vector of partial sums of f(x)
+//         partial_sqsums  float vector of partial sums of f(x)^2
+//
+
+__kernel void mc_pi(
+	const uint		niters,
+	const ulong		nsamples,
+	const uint		seed_lo,
+	const uint		seed_hi,
+	__local float*	local_sums,
+	__local float*	local_sqsums,
+	__global float* partial_sums,
+	__global float* partial_sqsums)
+{
+	int local_id = get_local_id(0);
+	ulong first_block = (ulong)get_global_id(0) * niters;
+
+	const uint key[2] = { seed_lo, seed_hi };
+	uint ctr[4];
+	ulong block, remaining;
+	float f, accum = 0.0f, sqaccum = 0.0f;
+	float comp = 0.0f, sqcomp = 0.0f;	// lost low-order parts of the sums
+	float y, t;
+	uint i, j, count;
+
+	for (i = 0; i < niters; i++) {
+		block = first_block + i;
+		if (block * 4 >= nsamples)
+			break;
+
+		// the counter is the global block index, so the samples do not
+		// depend on the work decomposition
+		ctr[0] = (uint)block;
+		ctr[1] = (uint)(block >> 32);
+		ctr[2] = 0;
+		ctr[3] = 0;
+
+		philox4x32(ctr, key);
+
+		remaining = nsamples - block * 4;
+		count = (remaining < 4) ? (uint)remaining : 4;
+
+		for (j = 0; j < count; j++) {
+			f = integrand(uniform(ctr[j]));
+
+			y = f - comp;
+			t = accum + y;
+			comp = (t - accum) - y;
+			accum = t;
+
+			y = f * f - sqcomp;
+			t = sqaccum + y;
+			sqcomp = (t - sqaccum) - y;
+			sqaccum = t;
+		}
+	}
+
+	local_sums[local_id] = accum;
+	local_sqsums[local_id] = sqaccum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	reduce(local_sums, partial_sums);
+	reduce(local_sqsums, partial_sqsums);
+}
\ No newline at end of file
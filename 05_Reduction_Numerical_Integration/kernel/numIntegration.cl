@@ -2,8 +2,9 @@
 // kernel: pi
 // Purpose: accumulate partial sums of pi comp
 //
-// input: float step_size
-//        int   niters per work item
+// input: int   niters per work item
+//        uint  nsteps total number of steps (work items past the end do less)
+//        float step_size
 //        local float* an array to hold sums form each work item
 // 
 // output: partial_sums  float vector of partial sums
@@ -15,6 +16,7 @@ void reduce(
 
 __kernel void pi(
 	const int		niters,
+	const uint		nsteps,
 	const float		step_size,
 	__local float*	local_sums,
 	__global float* partial_sums)
@@ -24,10 +26,14 @@ __kernel void pi(
 	int group_id = get_group_id(0);
 
 	float x, accum = 0.0f;
-	int i, istart, iend;
+	uint i, istart, iend;
 
-	istart = (group_id * num_wrk_items + local_id) * niters;
-	iend = istart + niters;
+	istart = (uint)(group_id * num_wrk_items + local_id) * (uint)niters;
+	iend = istart;
+
+	// the last work items may get less (or no) steps
+	if (istart < nsteps)
+		iend = (nsteps - istart > (uint)niters) ? istart + niters : nsteps;
 
 	for (i = istart; i < iend; i++) {
 		x = (i + 0.5f) * step_size;
@@ -0,0 +1,37 @@
+// --------------------------------------------------------------------------------------
+// kernel: sum
+// Purpose: sum of a vector of any element type T, built for a type by
+//          ocl::typedProgram (common/src/typed_program.hpp). Every work item
+//          accumulates a strided share in ACC (float for half), the work
+//          group combines them with a tree reduction in local memory.
+//
+// input: x T vector of length n
+//        local ACC* one element per work item, the work group size is a power of two
+//
+// output: partial_sums ACC vector of one sum per work group
+//
+
+__kernel void sum(
+	__global const T*	x,
+	const uint			n,
+	__local ACC*		local_sums,
+	__global ACC*		partial_sums)
+{
+	uint local_id = get_local_id(0);
+	ACC accum = 0;
+
+	for (uint i = get_global_id(0); i < n; i += get_global_size(0))
+		accum += LOAD(x, i);
+
+	local_sums[local_id] = accum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (uint offset = get_local_size(0) / 2; offset > 0; offset /= 2) {
+		if (local_id < offset)
+			local_sums[local_id] += local_sums[local_id + offset];
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (local_id == 0)
+		partial_sums[get_group_id(0)] = local_sums[0];
+}
\ No newline at end of file
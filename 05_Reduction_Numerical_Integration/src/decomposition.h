@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+//
+//  Work decomposition for the integration kernels
+//
+//  A fixed number of work-groups per compute unit is launched and every
+//  work-item loops over a contiguous range of steps. The kernels check the
+//  total number of steps, so any count is honored exactly.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __DECOMPOSITION_HDR
+#define __DECOMPOSITION_HDR
+
+#include "CL/cl.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+/// <summary>
+/// Launch geometry of an integration kernel.
+/// </summary>
+struct Decomposition
+{
+    ::size_t work_group_size;   // work-items per work-group
+    ::size_t nwork_groups;      // number of work-groups
+    cl_ulong niters;            // steps per work-item (the last ones may do less)
+
+    ::size_t global_size() const { return work_group_size * nwork_groups; }
+};
+
+/// <summary>
+/// Splits nsteps across groups_per_cu work-groups per compute unit.
+/// With fewer steps than work-items the number of work-groups shrinks
+/// so that no work-group is idle.
+/// </summary>
+/// <param name="nsteps">The number of steps (work units) to distribute</param>
+/// <param name="work_group_size">The work-group size</param>
+/// <param name="compute_units">CL_DEVICE_MAX_COMPUTE_UNITS</param>
+/// <param name="groups_per_cu">Work-groups per compute unit</param>
+/// <returns>The decomposition</returns>
+inline Decomposition decompose(cl_ulong nsteps, ::size_t work_group_size, cl_uint compute_units, unsigned groups_per_cu)
+{
+    Decomposition d;
+    d.work_group_size = work_group_size;
+    d.nwork_groups = static_cast<::size_t>(compute_units) * groups_per_cu;
+
+    if (d.nwork_groups < 1)
+        d.nwork_groups = 1;
+
+    // not enough steps to give every work-item one
+    cl_ulong max_groups = (nsteps + work_group_size - 1) / work_group_size;
+    if (max_groups < d.nwork_groups)
+        d.nwork_groups = static_cast<::size_t>(max_groups > 0 ? max_groups : 1);
+
+    d.niters = (nsteps + d.global_size() - 1) / d.global_size();
+
+    return d;
+}
+
+/// <summary>
+/// The work-items of a launch with groups_per_cu work-groups per compute
+/// unit, at most one per step: the count to choose the work-group size of
+/// the kernel for (ocl::workGroupSize), the steps are looped over.
+/// </summary>
+/// <param name="kernel">The kernel</param>
+/// <param name="device">The device</param>
+/// <param name="nsteps">The number of steps (work units) to distribute</param>
+/// <param name="groups_per_cu">Work-groups per compute unit</param>
+inline ::size_t decompositionItems(const cl::Kernel& kernel, const cl::Device& device, cl_ulong nsteps, unsigned groups_per_cu)
+{
+    cl_ulong items = static_cast<cl_ulong>(device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()) * groups_per_cu
+        * kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    return static_cast<::size_t>(nsteps < items ? nsteps : items);
+}
+
+/// <summary>
+/// Measures which number of work-groups per compute unit gives the highest
+/// throughput for a kernel. The launch callback runs the kernel with the given
+/// decomposition for probe_steps steps and blocks until it has finished.
+/// </summary>
+/// <param name="probe_steps">Number of steps of every probe run</param>
+/// <param name="work_group_size">The work-group size</param>
+/// <param name="compute_units">CL_DEVICE_MAX_COMPUTE_UNITS</param>
+/// <param name="launch">Runs the kernel for a decomposition</param>
+/// <returns>The fastest number of work-groups per compute unit</returns>
+inline unsigned measure_groups_per_cu(cl_ulong probe_steps, ::size_t work_group_size, cl_uint compute_units,
+    const std::function<void(const Decomposition&)>& launch)
+{
+    const unsigned candidates[] = { 1, 2, 4, 8, 16, 32 };
+
+    unsigned best = candidates[0];
+    long long best_time = -1;
+
+    for (unsigned c = 0; c < sizeof(candidates) / sizeof(candidates[0]); c++) {
+        Decomposition d = decompose(probe_steps, work_group_size, compute_units, candidates[c]);
+
+        // first run warms up, the second one is measured
+        launch(d);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        launch(d);
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        long long duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+
+        if (best_time < 0 || duration < best_time) {
+            best_time = duration;
+            best = candidates[c];
+        }
+    }
+
+    return best;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+//
+//  Host reference for the numerical integration of 4/(1+x*x) from 0 to 1
+//
+//  The range of steps is split across all hardware threads, every thread
+//  evaluates several x values at once with SIMD intrinsics and keeps a
+//  Kahan compensated sum per lane.
+//
+//------------------------------------------------------------------------------
+
+#ifndef __HOST_INTEGRATION_HDR
+#define __HOST_INTEGRATION_HDR
+
+#include <thread>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HOST_SIMD_WIDTH 4
+#define HOST_SIMD_NAME "AVX"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HOST_SIMD_WIDTH 2
+#define HOST_SIMD_NAME "SSE2"
+#else
+#define HOST_SIMD_WIDTH 1
+#define HOST_SIMD_NAME "scalar"
+#endif
+
+/// <summary>
+/// Kahan compensated accumulation of a single value.
+/// </summary>
+/// <param name="sum">The running sum</param>
+/// <param name="comp">The running compensation</param>
+/// <param name="value">The value to add</param>
+inline void kahan_add(double& sum, double& comp, double value)
+{
+    double y = value - comp;
+    double t = sum + y;
+    comp = (t - sum) - y;
+    sum = t;
+}
+
+/// <summary>
+/// Sums the midpoint rule terms 4/(1+x*x) of the steps [begin, end).
+/// </summary>
+/// <param name="begin">The first step</param>
+/// <param name="end">One past the last step</param>
+/// <param name="step">The step size</param>
+/// <returns>The (unscaled) sum of the function values</returns>
+inline double pi_host_range(long begin, long end, double step)
+{
+    double sum = 0.0, comp = 0.0;
+    long i = begin;
+
+#if HOST_SIMD_WIDTH == 4
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d vstep = _mm256_set1_pd(step);
+    const __m256d inc = _mm256_set1_pd(4.0);
+    __m256d idx = _mm256_set_pd(i + 3.5, i + 2.5, i + 1.5, i + 0.5);
+    __m256d vsum = _mm256_setzero_pd();
+    __m256d vcomp = _mm256_setzero_pd();
+
+    for (; i + 4 <= end; i += 4) {
+        __m256d x = _mm256_mul_pd(idx, vstep);
+        __m256d f = _mm256_div_pd(four, _mm256_add_pd(one, _mm256_mul_pd(x, x)));
+
+        // Kahan step on every lane
+        __m256d y = _mm256_sub_pd(f, vcomp);
+        __m256d t = _mm256_add_pd(vsum, y);
+        vcomp = _mm256_sub_pd(_mm256_sub_pd(t, vsum), y);
+        vsum = t;
+
+        idx = _mm256_add_pd(idx, inc);
+    }
+
+    double lanes[4], comps[4];
+    _mm256_storeu_pd(lanes, vsum);
+    _mm256_storeu_pd(comps, vcomp);
+    for (int l = 0; l < 4; l++) {
+        kahan_add(sum, comp, lanes[l]);
+        kahan_add(sum, comp, -comps[l]);
+    }
+#elif HOST_SIMD_WIDTH == 2
+    const __m128d four = _mm_set1_pd(4.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d vstep = _mm_set1_pd(step);
+    const __m128d inc = _mm_set1_pd(2.0);
+    __m128d idx = _mm_set_pd(i + 1.5, i + 0.5);
+    __m128d vsum = _mm_setzero_pd();
+    __m128d vcomp = _mm_setzero_pd();
+
+    for (; i + 2 <= end; i += 2) {
+        __m128d x = _mm_mul_pd(idx, vstep);
+        __m128d f = _mm_div_pd(four, _mm_add_pd(one, _mm_mul_pd(x, x)));
+
+        // Kahan step on every lane
+        __m128d y = _mm_sub_pd(f, vcomp);
+        __m128d t = _mm_add_pd(vsum, y);
+        vcomp = _mm_sub_pd(_mm_sub_pd(t, vsum), y);
+        vsum = t;
+
+        idx = _mm_add_pd(idx, inc);
+    }
+
+    double lanes[2], comps[2];
+    _mm_storeu_pd(lanes, vsum);
+    _mm_storeu_pd(comps, vcomp);
+    for (int l = 0; l < 2; l++) {
+        kahan_add(sum, comp, lanes[l]);
+        kahan_add(sum, comp, -comps[l]);
+    }
+#endif
+
+    // remainder (or everything without SIMD support)
+    for (; i < end; i++) {
+        double x = (i + 0.5) * step;
+        kahan_add(sum, comp, 4.0 / (1.0 + x * x));
+    }
+
+    return sum;
+}
+
+/// <summary>
+/// Integrates 4/(1+x*x) from 0 to 1 with the midpoint rule on the host,
+/// splitting the steps evenly across the given number of threads.
+/// </summary>
+/// <param name="num_steps">The number of integration steps</param>
+/// <param name="num_threads">The number of threads, 0 uses all hardware threads</param>
+/// <returns>The value of the integral (pi)</returns>
+inline double pi_host(long num_steps, unsigned num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+        num_threads = 1;
+
+    double step = 1.0 / (double)num_steps;
+
+    std::vector<double> partial(num_threads, 0.0);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < num_threads; t++) {
+        long begin = static_cast<long>(num_steps * (double)t / num_threads);
+        long end = static_cast<long>(num_steps * (double)(t + 1) / num_threads);
+
+        threads.push_back(std::thread([&partial, t, begin, end, step]() {
+            partial[t] = pi_host_range(begin, end, step);
+        }));
+    }
+
+    for (unsigned t = 0; t < num_threads; t++)
+        threads[t].join();
+
+    // combine the per thread sums, again compensated
+    double sum = 0.0, comp = 0.0;
+    for (unsigned t = 0; t < num_threads; t++)
+        kahan_add(sum, comp, partial[t]);
+
+    return step * sum;
+}
+
+#endif
\ No newline at end of file
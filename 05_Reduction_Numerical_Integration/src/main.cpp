@@ -21,97 +21,151 @@
 
 #include "filesystem.h"
 #include "util.hpp"
+#include "runtime.hpp"
+#include "il_program.hpp"
+#include "typed_program.hpp"
+#include "launch.hpp"
+#include "device_selector.hpp"
+#include "host_integration.h"
+#include "decomposition.h"
 
 #include <iostream>
 #include <fstream>
 
 #include "config.h"
 
-// device index
-#define DEVICE_INDEX 0
-
 // flag if CPU Matrix multiplication shall be run
 #define RUN_CPU 1
 
+// flag if the Monte Carlo integration shall be run
+#define RUN_MONTE_CARLO 1
+
 //------------------------------------------------------------------------------
 
-#define INSTEPS (512*512*512)
-#define ITERS (262144)
+#define INSTEPS (512*512*512)           // number of integration steps on the device
+#define PROBE_STEPS (INSTEPS / 16)      // steps of the runs measuring the work-groups per compute unit
+
+#define MC_SAMPLES  (1 << 30)           // number of Monte Carlo samples
+#define MC_SEED     (0x5EED5EED5EEDull) // 64 bit key of the counter-based generator
+
+#define SUM_LENGTH  (1 << 24)           // length of the vectors of the type-generic sum
 
 static long num_steps = 100000000;
-double step;
 
 // --------------------------------------------------------------------------------------
 
 /// <summary>
-/// Gets the device list.
+/// Sums a vector of the element type T with the type-generic reduction and
+/// prints the time, the bandwidth and the check.
 /// </summary>
-/// <param name="devices">The devices.</param>
-/// <returns></returns>
-unsigned getDeviceList(std::vector<cl::Device>& devices)
+/// <param name="device">The device</param>
+/// <param name="queue">The queue</param>
+/// <param name="n">The length of the vector</param>
+template<typename T>
+void typedSum(const cl::Device& device, cl::CommandQueue& queue, cl_uint n)
 {
-    cl_int err;
+    typedef ocl::ElementType<T> Type;
+    typedef typename Type::acc_type Acc;
+
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+
+    // multiples of 1/4, exact in every floating point type
+    bool integral = Type::epsilon() == 0.0;
+    std::vector<T> h_x(n);
+    double expected = 0.0;
+    for (cl_uint i = 0; i < n; i++) {
+        double v = integral ? (double)(i % 8) : (i % 8) * 0.25;
+        h_x[i] = Type::fromDouble(v);
+        expected += v;
+    }
 
-    // Get list of platforms
-    std::vector<cl::Platform> platforms;
-    cl::Platform::get(&platforms);
+    cl::Buffer d_x(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * n, h_x.data());
 
-    // Enumerate devices
-    for (int i = 0; i < platforms.size(); i++)
-    {
-        cl_uint num = 0;
-        std::vector<cl::Device> plat_devices;
-        platforms[i].getDevices(CL_DEVICE_TYPE_ALL, &plat_devices);
-        devices.insert(devices.end(), plat_devices.begin(), plat_devices.end());
-    }
+    // one program per type, cached by the runtime
+    cl::Program& program = ocl::typedProgram<T>(device, FileSystem::getPath("kernel/sum.cl"));
+    cl::Kernel& sum = runtime.kernel(program, "sum");
+
+    // the tree needs a power of two work group size, a few groups per compute unit
+    // whose work items loop over the vector
+    ::size_t limit = ocl::workGroupSize(sum, device, decompositionItems(sum, device, n, 4), sizeof(Acc));
+    ::size_t work_group_size = 1;
+    while (work_group_size * 2 <= limit)
+        work_group_size *= 2;
+    ::size_t work_groups = 4 * device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+
+    cl::Buffer d_partial_sums(context, CL_MEM_WRITE_ONLY, sizeof(Acc) * work_groups);
+
+    sum.setArg(0, d_x);
+    sum.setArg(1, n);
+    sum.setArg(2, cl::Local(sizeof(Acc) * work_group_size));
+    sum.setArg(3, d_partial_sums);
+
+    // warm up, then the timed run
+    queue.enqueueNDRangeKernel(sum, cl::NullRange, cl::NDRange(work_groups * work_group_size), cl::NDRange(work_group_size));
+    queue.finish();
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    queue.enqueueNDRangeKernel(sum, cl::NullRange, cl::NDRange(work_groups * work_group_size), cl::NDRange(work_group_size));
+    queue.finish();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+
+    std::vector<Acc> h_psum(work_groups);
+    queue.enqueueReadBuffer(d_partial_sums, CL_TRUE, 0, sizeof(Acc) * work_groups, h_psum.data());
+
+    double result = 0.0;
+    for (::size_t g = 0; g < work_groups; g++)
+        result += h_psum[g];
 
-    return devices.size();
+    printf("%8s %10.3f ms %10.2f GB/s  sum %.1f, expected %.1f\n", Type::name(), seconds * 1000.0,
+        sizeof(T) * n / seconds / 1.0e9, result, expected);
 }
 
 
-int main(void)
+
+int main(int argc, char* argv[])
 {
 
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
     // Print Programm Infos
     std::cout << "OpenCL integral of pi - Version " << 
        VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
 
     // declare variables
-    int i;
-    double x, pi, sum = 0.0;
+    double pi;
 
-    step = 1.0 / (double)num_steps;
-
-    // Run sequential mat mult on CPU
+    // Run threaded, vectorized integration on CPU
 #if RUN_CPU
     {
+        unsigned num_threads = std::thread::hardware_concurrency();
+        if (num_threads == 0)
+            num_threads = 1;
 
         // start timepoint
         auto start = std::chrono::high_resolution_clock::now();
 
-        for (i = 1; i <= num_steps; i++) {
-            x = (i - 0.5) * step;
-            sum = sum + 4.0 / (1.0 + x * x);
-        }
-        pi = step * sum;
+        pi = pi_host(num_steps, num_threads);
 
         // end time stopping
         auto stop = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
 
-        std::cout << " pi with " << num_steps << " steps is " << pi << " in " << duration.count() / 1000 << " milliseconds" << std::endl;
+        std::cout << " pi with " << num_steps << " steps is " << pi << " in " << duration.count() / 1000 << " milliseconds";
+        std::cout << " (" << num_threads << " threads, " << HOST_SIMD_NAME << ")" << std::endl;
 
         auto error = pi - CL_M_PI;
     }
 #endif
 
-    float* h_psum;                  // vector to hold partial sum
-    int in_nsteps = INSTEPS;        // default number of steps (updated later to device preferable)
-    int niters = ITERS;             // number of iterations
-    int nsteps;
+    cl_uint nsteps = INSTEPS;       // number of steps, honored exactly
     float step_size;
-    ::size_t nwork_groups;
-    ::size_t max_size, work_group_size = 8;
+    Decomposition decomposition;    // work-group size, number of work-groups and steps per work-item
+    unsigned groups_per_cu;         // work-groups per compute unit, measured
     float pi_res;
 
     cl::Buffer d_partial_sums;
@@ -120,86 +174,101 @@ int main(void)
     {        
         // Get list of devices
         std::vector<cl::Device> devices;
-        unsigned numDevices = getDeviceList(devices);
+        unsigned numDevices = ocl::getDeviceList(devices);
 
-        // check if device indes is in range
-        if (DEVICE_INDEX >= numDevices)
+        // without any OpenCL device the host integrator is the fast path
+        if (numDevices == 0)
         {
-            std::cout << "Invalid device index \n" << std::endl;
-            return EXIT_FAILURE;
+            std::cout << "\nNo OpenCL device found, integrating on the host" << std::endl;
+
+            pi = pi_host(num_steps);
+            std::cout << " pi = " << pi << " for " << num_steps << " steps.";
+            std::cout << " Error: " << pi - CL_M_PI << std::endl;
+
+            return 0;
         }
 
-        cl::Device device = devices[DEVICE_INDEX];
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
         
         // print device name of the chosen device 
         std::string name = device.getInfo<CL_DEVICE_NAME>();
         std::cout << "\nUsing OpenCL Device " << name << std::endl;
 
-        // chosen device needs to be pushed in as an array
-        std::vector<cl::Device> chosen_device;
-        chosen_device.push_back(device);
-
-        // create a context
-        cl::Context context(chosen_device);
+        // context and queue of the device from the shared runtime
+        ocl::Runtime& runtime = ocl::Runtime::instance();
+        cl::Context context = runtime.context(device);
         // Get the command queue
-        cl::CommandQueue queue(context, device);
+        cl::CommandQueue queue = runtime.queue(device);
 
  
         // Load in kernel source, creating a program object for the context
 
-        // the 3rd parameter specifis that the programm should be build
-        // if build flags needs to be specified use program.build()
-        cl::Program program(context, util::loadProgram(FileSystem::getPath("kernel/numIntegration.cl")), true);
+        // the runtime loads and builds the program once and caches it,
+        // build flags are the optional 3rd parameter
+        cl::Program program = runtime.program(device, FileSystem::getPath("kernel/numIntegration.cl"));
        
         // create the kernel functor
         cl::Kernel ko_pi(program, "pi");
 
-        // get work group size
-        work_group_size = ko_pi.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
-
-        std::cout << "wgroup_size = " << work_group_size << std::endl;
-              
-        cl::make_kernel<int, float, cl::LocalSpaceArg, cl::Buffer> pi(program, "pi");
-
-        // set the number of work groups, the actual number of steps and step size
-        nwork_groups = in_nsteps / (work_group_size * niters);
+        cl::make_kernel<int, cl_uint, float, cl::LocalSpaceArg, cl::Buffer> pi(ko_pi);
+
+        // work group size: a multiple of the preferred work group size multiple
+        // that leaves local memory for one partial sum per work item, for the
+        // work items of at least one work group per compute unit
+        ::size_t work_group_size = ocl::workGroupSize(ko_pi, device, decompositionItems(ko_pi, device, nsteps, 1), sizeof(float));
+        cl_uint compute_units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+
+        std::cout << "wgroup_size = " << work_group_size << ", compute units = " << compute_units << std::endl;
+
+        // runs the kernel for a decomposition and waits for it
+        auto run_pi = [&](const Decomposition& d, cl_uint steps, const cl::Buffer& partial_sums) {
+            pi(
+                cl::EnqueueArgs(
+                    queue,
+                    cl::NDRange(d.global_size()),
+                    cl::NDRange(d.work_group_size)),
+                static_cast<int>(d.niters),
+                steps,
+                1.0f / static_cast<float>(steps),
+                cl::Local(sizeof(float) * d.work_group_size),
+                partial_sums);
+            queue.finish();
+        };
+
+        // measure the number of work groups per compute unit that keeps the device busiest
+        {
+            Decomposition largest = decompose(PROBE_STEPS, work_group_size, compute_units, 32);
+            cl::Buffer d_probe_sums(context, CL_MEM_WRITE_ONLY, sizeof(float) * largest.nwork_groups);
 
-        if (nwork_groups < 1) {
-            nwork_groups = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
-            std::cout << " MAX COMPUTE UNITS " << nwork_groups << std::endl;
-            work_group_size = in_nsteps / (nwork_groups * niters);
+            groups_per_cu = measure_groups_per_cu(PROBE_STEPS, work_group_size, compute_units,
+                [&](const Decomposition& d) { run_pi(d, PROBE_STEPS, d_probe_sums); });
         }
 
-        nsteps = work_group_size * niters * nwork_groups;
+        // set the number of work groups and steps per work item, the number of steps stays as requested
+        decomposition = decompose(nsteps, work_group_size, compute_units, groups_per_cu);
         step_size = 1.0f / static_cast<float>(nsteps);
-        std::vector<float> h_psum(nwork_groups);
+        std::vector<float> h_psum(decomposition.nwork_groups);
 
-        std::cout << (int)nwork_groups << " work groups of size " << (int)work_group_size << ". " << nsteps << " Integration steps" << std::endl;
+        std::cout << (int)decomposition.nwork_groups << " work groups (" << groups_per_cu << " per compute unit) of size "
+                  << (int)decomposition.work_group_size << ", " << decomposition.niters << " steps per work item. "
+                  << nsteps << " Integration steps" << std::endl;
 
         // initialize buffer
-        d_partial_sums = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * nwork_groups);
+        d_partial_sums = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * decomposition.nwork_groups);
 
         // start timepoint
         auto start = std::chrono::high_resolution_clock::now();
 
         // execute the kernel over the entire range of our 1d input data set
-        // using the max number of work group items for this device
-        pi(
-            cl::EnqueueArgs(
-                queue,
-                cl::NDRange(nsteps / niters),
-                cl::NDRange(work_group_size)),
-            niters,
-            step_size,
-            cl::Local(sizeof(float)* work_group_size),
-            d_partial_sums);
+        run_pi(decomposition, nsteps, d_partial_sums);
 
         // copy partial sum back to cpu
         cl::copy(queue, d_partial_sums, h_psum.begin(), h_psum.end());
 
         // complete the sum and compute final integral value
         pi_res = 0.0f;
-        for (unsigned int i = 0; i < nwork_groups; i++)
+        for (unsigned int i = 0; i < decomposition.nwork_groups; i++)
         {   
             pi_res += h_psum[i];
         }
@@ -216,6 +285,126 @@ int main(void)
         std::cout << " pi = " << pi_res << " for " << nsteps << " steps.";
         std::cout << " Error: " << error << std::endl;
 
+#if RUN_MONTE_CARLO
+        //--------------------------------------------------------------------------------
+        // Monte Carlo integration ... random numbers generated on the device
+        //--------------------------------------------------------------------------------
+
+        std::cout << "\n===== Monte Carlo integration, Philox4x32-10 on device ======\n" << std::endl;
+
+        // the Monte Carlo kernel reuses reduce() of the quadrature kernel,
+        // so both sources are built into one program
+        std::vector<std::string> mc_sources;
+        mc_sources.push_back(FileSystem::getPath("kernel/numIntegration.cl"));
+        mc_sources.push_back(FileSystem::getPath("kernel/monteCarlo.cl"));
+
+        cl::Program mc_program = runtime.program(device, mc_sources);
+
+        cl::Kernel ko_mc(mc_program, "mc_pi");
+        cl::make_kernel<cl_uint, cl_ulong, cl_uint, cl_uint, cl::LocalSpaceArg, cl::LocalSpaceArg, cl::Buffer, cl::Buffer> mc_pi(ko_mc);
+
+        // every Philox call draws 4 samples, so the work units are blocks of 4 samples
+        cl_ulong mc_nsamples = MC_SAMPLES;
+        cl_ulong mc_nblocks = (mc_nsamples + 3) / 4;
+        ::size_t mc_work_group_size = ocl::workGroupSize(ko_mc, device,
+            decompositionItems(ko_mc, device, mc_nblocks, groups_per_cu), 2 * sizeof(float));
+
+        Decomposition mc_decomposition = decompose(mc_nblocks, mc_work_group_size, compute_units, groups_per_cu);
+        ::size_t mc_work_groups = mc_decomposition.nwork_groups;
+
+        std::cout << (int)mc_work_groups << " work groups of size " << (int)mc_work_group_size << ", "
+                  << 4 * mc_decomposition.niters << " samples per work item. " << mc_nsamples << " samples" << std::endl;
+
+        std::vector<float> h_mc_sums(mc_work_groups);
+        std::vector<float> h_mc_sqsums(mc_work_groups);
+
+        cl::Buffer d_mc_sums(context, CL_MEM_WRITE_ONLY, sizeof(float) * mc_work_groups);
+        cl::Buffer d_mc_sqsums(context, CL_MEM_WRITE_ONLY, sizeof(float) * mc_work_groups);
+
+        // start timepoint
+        start = std::chrono::high_resolution_clock::now();
+
+        mc_pi(
+            cl::EnqueueArgs(
+                queue,
+                cl::NDRange(mc_decomposition.global_size()),
+                cl::NDRange(mc_work_group_size)),
+            static_cast<cl_uint>(mc_decomposition.niters),
+            mc_nsamples,
+            static_cast<cl_uint>(MC_SEED & 0xFFFFFFFFu),
+            static_cast<cl_uint>(MC_SEED >> 32),
+            cl::Local(sizeof(float) * mc_work_group_size),
+            cl::Local(sizeof(float) * mc_work_group_size),
+            d_mc_sums,
+            d_mc_sqsums);
+
+        // copy partial sums back to cpu
+        cl::copy(queue, d_mc_sums, h_mc_sums.begin(), h_mc_sums.end());
+        cl::copy(queue, d_mc_sqsums, h_mc_sqsums.begin(), h_mc_sqsums.end());
+
+        // complete the sums in double precision
+        double mc_sum = 0.0, mc_sqsum = 0.0;
+        for (unsigned int i = 0; i < mc_work_groups; i++)
+        {
+            mc_sum += h_mc_sums[i];
+            mc_sqsum += h_mc_sqsums[i];
+        }
+
+        // end time stopping
+        stop = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+        // sample mean is the estimate, the unbiased sample variance gives its standard error
+        double mc_n = static_cast<double>(mc_nsamples);
+        double mc_mean = mc_sum / mc_n;
+        double mc_variance = (mc_sqsum / mc_n - mc_mean * mc_mean) * mc_n / (mc_n - 1.0);
+        double mc_std_error = std::sqrt(mc_variance / mc_n);
+        double mc_rate = mc_n / (duration.count() / 1000000.0);
+
+        std::cout << "The calculation ran in " << duration.count() / 1000 << " milliseconds";
+        std::cout << " pi = " << mc_mean << " +/- " << mc_std_error << " (variance " << mc_variance << ").";
+        std::cout << " Error: " << mc_mean - CL_M_PI << std::endl;
+        std::cout << mc_rate / 1.0e9 << " billion samples per second" << std::endl;
+#endif
+
+        //--------------------------------------------------------------------------------
+        // Type-generic reduction ... sum of int32, float, double and half vectors
+        //--------------------------------------------------------------------------------
+
+        // the reduction written once for an element type T and built per type
+        // through build options, half is read as 16 bits and summed in float
+        std::cout << "\n===== Type-generic sum, " << SUM_LENGTH << " elements ======\n" << std::endl;
+
+        typedSum<cl_int>(device, queue, SUM_LENGTH);
+        typedSum<cl_float>(device, queue, SUM_LENGTH);
+        if (ocl::ElementType<cl_double>::supported(device))
+            typedSum<cl_double>(device, queue, SUM_LENGTH);
+        else
+            std::cout << "  double not supported by the device" << std::endl;
+        typedSum<ocl::half>(device, queue, SUM_LENGTH);
+
+        //--------------------------------------------------------------------------------
+        // Program build latency ... OpenCL C source against SPIR-V
+        //--------------------------------------------------------------------------------
+
+        // the SPIR-V modules embedded at build time skip the front end of the driver
+        std::cout << "\n===== Program build latency, SPIR-V " << (ocl::supportsIL(device) ? "supported" : "not supported")
+                  << " by the device ======\n" << std::endl;
+        printf("%-28s %14s %14s %14s %14s\n", "kernel file", "source first", "source avg", "SPIR-V first", "SPIR-V avg");
+
+        const char* kernel_files[] = { "kernel/numIntegration.cl" };
+
+        for (const char* file : kernel_files)
+        {
+            ocl::BuildLatency latency = ocl::measureBuildLatency(device, FileSystem::getPath(file));
+
+            if (latency.il_first < 0.0)
+                printf("%-28s %11.2f ms %11.2f ms %14s %14s\n", file, latency.source_first, latency.source_average, "-", "-");
+            else
+                printf("%-28s %11.2f ms %11.2f ms %11.2f ms %11.2f ms\n", file, latency.source_first, latency.source_average,
+                    latency.il_first, latency.il_average);
+        }
+
     }
     // catch opencl error
     catch (cl::Error err) {
@@ -0,0 +1,151 @@
+// --------------------------------------------------------------------------------------
+// Device-wide prefix scan (reduce-then-scan)
+//
+// The input is split into tiles of ELEMS * local_size elements, one tile per
+// work-group.
+//
+//   1. scan_reduce    each work-group reduces its tile to a single block sum
+//   2. (host)         the block sums are scanned exclusively, recursively with
+//                     the same two kernels until they fit into one tile
+//   3. scan_downsweep each work-group scans its tile in local memory and adds
+//                     the scanned block sum of its tile as carry-in
+//
+// The element type and the number of elements per work-item are set with
+// build options, e.g. "-DT=float -DELEMS=8". The local size must be a power
+// of two.
+//
+
+#ifndef T
+#define T int
+#endif
+
+#ifndef ELEMS
+#define ELEMS 8
+#endif
+
+// --------------------------------------------------------------------------------------
+// kernel: scan_reduce
+// Purpose: reduce every tile of the input to its sum
+//
+// input: T* in           the input vector
+//        uint n          number of elements of the input
+//        local T*        an array to hold the sums from each work item
+//
+// output: T* block_sums  one sum per work-group
+//
+
+__kernel void scan_reduce(
+	__global const T*	in,
+	__global T*			block_sums,
+	const uint			n,
+	__local T*			local_sums)
+{
+	int num_wrk_items = get_local_size(0);
+	int local_id = get_local_id(0);
+	int group_id = get_group_id(0);
+
+	uint tile_start = group_id * num_wrk_items * ELEMS;
+	uint idx;
+	T sum = 0;
+	int k, s;
+
+	// coalesced loads: consecutive work-items read consecutive elements
+	for (k = 0; k < ELEMS; k++) {
+		idx = tile_start + k * num_wrk_items + local_id;
+		if (idx < n)
+			sum += in[idx];
+	}
+
+	local_sums[local_id] = sum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// tree reduction across the work-group
+	for (s = num_wrk_items / 2; s > 0; s >>= 1) {
+		if (local_id < s)
+			local_sums[local_id] += local_sums[local_id + s];
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (local_id == 0)
+		block_sums[group_id] = local_sums[0];
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: scan_downsweep
+// Purpose: scan every tile in local memory and add the carry-in of the tile
+//
+// input: T* in             the input vector
+//        T* block_offsets  exclusive scan of the block sums (carry-in per tile)
+//        uint n            number of elements
+//        int inclusive     1 for an inclusive, 0 for an exclusive scan
+//        local T* tile     ELEMS * local_size elements
+//        local T* local_sums  an array to hold the sums from each work item
+//
+// output: T* out           the scanned vector (may alias in)
+//
+
+__kernel void scan_downsweep(
+	__global const T*	in,
+	__global T*			out,
+	__global const T*	block_offsets,
+	const uint			n,
+	const int			inclusive,
+	__local T*			tile,
+	__local T*			local_sums)
+{
+	int num_wrk_items = get_local_size(0);
+	int local_id = get_local_id(0);
+	int group_id = get_group_id(0);
+
+	uint tile_start = group_id * num_wrk_items * ELEMS;
+	uint idx;
+	T vals[ELEMS];
+	T thread_sum = 0, prefix, t;
+	int k, offset;
+
+	// coalesced load of the tile into local memory, padded with zeros
+	for (k = 0; k < ELEMS; k++) {
+		idx = tile_start + k * num_wrk_items + local_id;
+		tile[k * num_wrk_items + local_id] = (idx < n) ? in[idx] : 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// every work-item owns ELEMS consecutive elements of the tile
+	for (k = 0; k < ELEMS; k++) {
+		vals[k] = tile[local_id * ELEMS + k];
+		thread_sum += vals[k];
+	}
+
+	local_sums[local_id] = thread_sum;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// inclusive scan of the per work-item sums (Hillis-Steele)
+	for (offset = 1; offset < num_wrk_items; offset <<= 1) {
+		t = (local_id >= offset) ? local_sums[local_id - offset] : 0;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		local_sums[local_id] += t;
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	// carry-in of this work-item: tile offset plus everything left of it
+	prefix = block_offsets[group_id] + local_sums[local_id] - thread_sum;
+
+	for (k = 0; k < ELEMS; k++) {
+		if (inclusive) {
+			prefix += vals[k];
+			tile[local_id * ELEMS + k] = prefix;
+		}
+		else {
+			tile[local_id * ELEMS + k] = prefix;
+			prefix += vals[k];
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// coalesced store of the scanned tile
+	for (k = 0; k < ELEMS; k++) {
+		idx = tile_start + k * num_wrk_items + local_id;
+		if (idx < n)
+			out[idx] = tile[k * num_wrk_items + local_id];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+/**
+ * Prefix scan in OpenCL
+ * Inclusive and exclusive scan of int and float buffers of arbitrary length,
+ * checked against std::inclusive_scan / std::exclusive_scan
+ *
+ * Cpp code style
+ */
+
+// enable opencl exceptions
+#define __CL_ENABLE_EXCEPTIONS
+
+#include "CL/cl.hpp"    // Khronos C++ Wrapper API
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "filesystem.h"
+#include "util.hpp"
+#include "runtime.hpp"
+#include "device_selector.hpp"
+#include "scan.hpp"
+
+#include <iostream>
+#include <fstream>
+
+#include "config.h"
+
+//------------------------------------------------------------------------------
+
+#define TOL     (0.0001)    // relative tolerance used in floating point comparisons
+#define COUNT   10          // number of times to run each benchmark scan
+
+// --------------------------------------------------------------------------------------
+
+/// <summary>
+/// Fills the vector with random values, small integers for int so the sums stay in range.
+/// </summary>
+template<typename T>
+void fillRandom(std::vector<T>& v)
+{
+    for (::size_t i = 0; i < v.size(); i++)
+        v[i] = static_cast<T>(rand() % 201 - 100);
+}
+
+template<>
+void fillRandom<cl_float>(std::vector<cl_float>& v)
+{
+    for (::size_t i = 0; i < v.size(); i++)
+        v[i] = rand() / (float)RAND_MAX;
+}
+
+/// <summary>
+/// Compares the device result with the host reference.
+/// Integers have to match exactly, floats within a tolerance relative to the running sum.
+/// </summary>
+/// <returns>The number of correct elements</returns>
+template<typename T>
+::size_t countCorrect(const std::vector<T>& result, const std::vector<double>& reference)
+{
+    ::size_t correct = 0;
+
+    for (::size_t i = 0; i < result.size(); i++) {
+        if ((double)result[i] == reference[i])
+            correct++;
+    }
+
+    return correct;
+}
+
+template<>
+::size_t countCorrect<cl_float>(const std::vector<cl_float>& result, const std::vector<double>& reference)
+{
+    ::size_t correct = 0;
+
+    for (::size_t i = 0; i < result.size(); i++) {
+        double err = std::fabs((double)result[i] - reference[i]);
+        if (err <= TOL * std::fabs(reference[i]) + TOL)
+            correct++;
+    }
+
+    return correct;
+}
+
+/// <summary>
+/// Runs inclusive and exclusive scans of different lengths and checks them on the host.
+/// </summary>
+/// <returns>true if all results were correct</returns>
+template<typename T>
+bool testScan(const cl::Context& context, cl::CommandQueue& queue, scan::Scanner<T>& scanner)
+{
+    ::size_t tile = scanner.tileSize();
+
+    // lengths around the tile boundaries and ones that need several recursion levels
+    std::vector<::size_t> lengths = { 1, 7, tile - 1, tile, tile + 1, tile * tile + 3, 1000003, (1 << 22) + 13 };
+
+    bool all_correct = true;
+
+    for (::size_t l = 0; l < lengths.size(); l++) {
+        ::size_t n = lengths[l];
+
+        std::vector<T> h_in(n), h_out(n);
+        std::vector<double> h_ref(n);       // reference accumulated in double
+        fillRandom(h_in);
+
+        cl::Buffer d_in(context, h_in.begin(), h_in.end(), true);
+        cl::Buffer d_out(context, CL_MEM_READ_WRITE, sizeof(T) * n);
+
+        // inclusive scan
+        scanner.inclusive(d_in, d_out, static_cast<cl_uint>(n));
+        cl::copy(queue, d_out, h_out.begin(), h_out.end());
+
+        std::inclusive_scan(h_in.begin(), h_in.end(), h_ref.begin(), std::plus<double>(), 0.0);
+        ::size_t correct_inc = countCorrect(h_out, h_ref);
+
+        // exclusive scan
+        scanner.exclusive(d_in, d_out, static_cast<cl_uint>(n));
+        cl::copy(queue, d_out, h_out.begin(), h_out.end());
+
+        std::exclusive_scan(h_in.begin(), h_in.end(), h_ref.begin(), 0.0);
+        ::size_t correct_exc = countCorrect(h_out, h_ref);
+
+        std::cout << scan::type_name<T>::get() << " scan of " << n << " elements: inclusive "
+                  << correct_inc << ", exclusive " << correct_exc << " out of " << n << " results were correct" << std::endl;
+
+        all_correct = all_correct && correct_inc == n && correct_exc == n;
+    }
+
+    return all_correct;
+}
+
+/// <summary>
+/// Measures the scan bandwidth for different lengths.
+/// The effective bandwidth counts one read and one write per element.
+/// </summary>
+template<typename T>
+void benchmarkScan(const cl::Context& context, cl::CommandQueue& queue, scan::Scanner<T>& scanner)
+{
+    std::vector<::size_t> lengths = { 1 << 16, 1 << 20, 1 << 24, 1 << 26 };
+
+    for (::size_t l = 0; l < lengths.size(); l++) {
+        ::size_t n = lengths[l];
+
+        std::vector<T> h_in(n);
+        fillRandom(h_in);
+
+        cl::Buffer d_in(context, h_in.begin(), h_in.end(), true);
+        cl::Buffer d_out(context, CL_MEM_READ_WRITE, sizeof(T) * n);
+
+        // warm up (allocates the block sum buffers)
+        scanner.inclusive(d_in, d_out, static_cast<cl_uint>(n));
+        queue.finish();
+
+        double best = 1.0e30;
+
+        for (int i = 0; i < COUNT; i++) {
+            // start timepoint
+            auto start = std::chrono::high_resolution_clock::now();
+
+            scanner.inclusive(d_in, d_out, static_cast<cl_uint>(n));
+            queue.finish();
+
+            // end time stopping
+            auto stop = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+            best = std::min(best, (double)duration.count());
+        }
+
+        double gbs = 2.0 * n * sizeof(T) / (best * 1000.0);
+
+        std::cout << scan::type_name<T>::get() << " inclusive scan of " << n << " elements in "
+                  << best << " microseconds at " << gbs << " GB/s" << std::endl;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
+    // Print Programm Infos
+    std::cout << "OpenCL prefix scan - Version " <<
+       VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
+
+    try
+    {
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
+
+        // print device name of the chosen device
+        std::string name = device.getInfo<CL_DEVICE_NAME>();
+        std::cout << "\nUsing OpenCL Device " << name << std::endl;
+
+        // context and queue of the device from the shared runtime
+        ocl::Runtime& runtime = ocl::Runtime::instance();
+        cl::Context context = runtime.context(device);
+        // Get the command queue
+        cl::CommandQueue queue = runtime.queue(device);
+
+        scan::Scanner<cl_int> int_scanner(context, device, queue);
+        scan::Scanner<cl_float> float_scanner(context, device, queue);
+
+        //--------------------------------------------------------------------------------
+        // check the scans against std::inclusive_scan and std::exclusive_scan
+        //--------------------------------------------------------------------------------
+
+        std::cout << "\n===== Prefix scan, tile of " << int_scanner.tileSize() << " elements, check ======\n" << std::endl;
+
+        bool correct = testScan(context, queue, int_scanner);
+        correct = testScan(context, queue, float_scanner) && correct;
+
+        //--------------------------------------------------------------------------------
+        // bandwidth
+        //--------------------------------------------------------------------------------
+
+        std::cout << "\n===== Prefix scan, bandwidth ======\n" << std::endl;
+
+        benchmarkScan(context, queue, int_scanner);
+        benchmarkScan(context, queue, float_scanner);
+
+        if (!correct) {
+            std::cout << "\nErrors in prefix scan" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    // catch opencl error
+    catch (cl::Error err) {
+        // catch errors and print error data
+        std::cout << "OpenCL Error:" << err.what() << " returned " << std::endl;
+        std::cout << "Check cl.h for error codes." << std::endl;
+
+        exit(-1);
+    }
+
+    return 0;
+
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+//------------------------------------------------------------------------------
+//
+//  Device-wide prefix scan for OpenCL buffers
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CL/cl.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "runtime.hpp"
+
+namespace scan {
+
+    // elements scanned by one work-item, the tile of a work-group is
+    // SCAN_ELEMS * local size
+    const int SCAN_ELEMS = 8;
+
+    // upper bound for the local size (it is also limited by the kernel)
+    const ::size_t SCAN_MAX_LOCAL_SIZE = 256;
+
+    /// <summary>
+    /// The OpenCL C name of the scanned element type.
+    /// </summary>
+    template<typename T> struct type_name;
+    template<> struct type_name<cl_int> { static const char* get() { return "int"; } };
+    template<> struct type_name<cl_uint> { static const char* get() { return "uint"; } };
+    template<> struct type_name<cl_float> { static const char* get() { return "float"; } };
+
+    /// <summary>
+    /// Inclusive and exclusive prefix sums of device buffers of arbitrary length.
+    ///
+    /// The scan is a reduce-then-scan: every tile is reduced to a block sum,
+    /// the block sums are scanned recursively and then every tile is scanned
+    /// with its block offset as carry-in. Temporary buffers for the block sums
+    /// are kept between calls.
+    /// </summary>
+    template<typename T>
+    class Scanner
+    {
+    public:
+        /// <summary>
+        /// Builds the scan program for the element type T.
+        /// </summary>
+        /// <param name="context">The context of the device in the runtime</param>
+        /// <param name="device">The device to build for</param>
+        /// <param name="queue">The queue the scans are enqueued on</param>
+        Scanner(const cl::Context& context, const cl::Device& device, const cl::CommandQueue& queue)
+            : context_(context), queue_(queue)
+        {
+            std::string options = std::string("-DT=") + type_name<T>::get() + " -DELEMS=" + std::to_string(SCAN_ELEMS);
+
+            // built once per element type by the shared runtime
+            program_ = ocl::Runtime::instance().program(device, FileSystem::getPath("kernel/scan.cl"), options);
+
+            reduce_ = cl::Kernel(program_, "scan_reduce");
+            downsweep_ = cl::Kernel(program_, "scan_downsweep");
+
+            // the tree reduction needs a power of two local size
+            ::size_t max_size = std::min(reduce_.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device),
+                                         downsweep_.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+            max_size = std::min(max_size, SCAN_MAX_LOCAL_SIZE);
+
+            local_size_ = 1;
+            while (local_size_ * 2 <= max_size)
+                local_size_ *= 2;
+
+            zero_ = cl::Buffer(context_, CL_MEM_READ_ONLY, sizeof(T));
+            T zero = 0;
+            queue_.enqueueWriteBuffer(zero_, CL_TRUE, 0, sizeof(T), &zero);
+        }
+
+        /// <summary>
+        /// out[i] = in[0] + ... + in[i]
+        /// </summary>
+        void inclusive(const cl::Buffer& in, const cl::Buffer& out, cl_uint n)
+        {
+            scan(in, out, n, 1, 0);
+        }
+
+        /// <summary>
+        /// out[i] = in[0] + ... + in[i-1], out[0] = 0
+        /// </summary>
+        void exclusive(const cl::Buffer& in, const cl::Buffer& out, cl_uint n)
+        {
+            scan(in, out, n, 0, 0);
+        }
+
+        /// <summary>
+        /// Number of elements scanned by one work-group.
+        /// </summary>
+        ::size_t tileSize() const
+        {
+            return local_size_ * SCAN_ELEMS;
+        }
+
+    private:
+        /// <summary>
+        /// Scans n elements of in into out (which may alias in).
+        /// </summary>
+        /// <param name="level">The recursion depth, selects the block sum buffer</param>
+        void scan(const cl::Buffer& in, const cl::Buffer& out, cl_uint n, int inclusive, unsigned level)
+        {
+            if (n == 0)
+                return;
+
+            ::size_t tile = tileSize();
+            ::size_t num_groups = (n + tile - 1) / tile;
+            cl::Buffer offsets = zero_;
+
+            if (num_groups > 1) {
+                // block sums of this level, grown on demand
+                if (block_sums_.size() <= level) {
+                    block_sums_.resize(level + 1);
+                    block_capacity_.resize(level + 1, 0);
+                }
+                if (block_capacity_[level] < num_groups) {
+                    block_sums_[level] = cl::Buffer(context_, CL_MEM_READ_WRITE, sizeof(T) * num_groups);
+                    block_capacity_[level] = num_groups;
+                }
+                offsets = block_sums_[level];
+
+                reduce_.setArg(0, in);
+                reduce_.setArg(1, offsets);
+                reduce_.setArg(2, n);
+                reduce_.setArg(3, cl::Local(sizeof(T) * local_size_));
+                queue_.enqueueNDRangeKernel(reduce_, cl::NullRange,
+                    cl::NDRange(num_groups * local_size_), cl::NDRange(local_size_));
+
+                // the block sums become the carry-in of every tile
+                scan(offsets, offsets, static_cast<cl_uint>(num_groups), 0, level + 1);
+            }
+
+            downsweep_.setArg(0, in);
+            downsweep_.setArg(1, out);
+            downsweep_.setArg(2, offsets);
+            downsweep_.setArg(3, n);
+            downsweep_.setArg(4, inclusive);
+            downsweep_.setArg(5, cl::Local(sizeof(T) * tile));
+            downsweep_.setArg(6, cl::Local(sizeof(T) * local_size_));
+            queue_.enqueueNDRangeKernel(downsweep_, cl::NullRange,
+                cl::NDRange(num_groups * local_size_), cl::NDRange(local_size_));
+        }
+
+        cl::Context context_;
+        cl::CommandQueue queue_;
+        cl::Program program_;
+        cl::Kernel reduce_;
+        cl::Kernel downsweep_;
+        ::size_t local_size_;
+
+        cl::Buffer zero_;                           // carry-in for a single tile
+        std::vector<cl::Buffer> block_sums_;        // block sums per recursion level
+        std::vector<::size_t> block_capacity_;
+    };
+}
\ No newline at end of file
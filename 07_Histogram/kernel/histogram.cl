@@ -0,0 +1,105 @@
+// --------------------------------------------------------------------------------------
+// Histogram of float values in the range [lo, hi)
+//
+// Values outside the range are counted in the first and last bin. Both
+// kernels walk the input with a grid-stride loop, so any number of
+// work-groups can cover any number of elements.
+//
+
+// --------------------------------------------------------------------------------------
+// function: bin_index
+// Purpose: the bin of a value, clamped into [0, nbins)
+//
+
+uint bin_index(
+	const float x,
+	const float lo,
+	const float scale,
+	const uint	nbins)
+{
+	float f = (x - lo) * scale;
+
+	if (f < 0.0f)
+		return 0;
+	if (f >= (float)nbins)
+		return nbins - 1;
+
+	return (uint)f;
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: histogram_local
+// Purpose: count values per bin, every work-group keeps a private copy of
+//          the bins in local memory and merges it into the global result
+//
+// input: float* data     the values
+//        uint   n        number of values
+//        float  lo       lower bound of the first bin
+//        float  scale    nbins / (hi - lo)
+//        uint   nbins    number of bins
+//        local uint*     nbins counters of the work-group
+//
+// output: uint* bins     the histogram (has to be zeroed before)
+//
+
+__kernel void histogram_local(
+	__global const float*	data,
+	const uint				n,
+	const float				lo,
+	const float				scale,
+	const uint				nbins,
+	__global uint*			bins,
+	__local uint*			local_bins)
+{
+	int num_wrk_items = get_local_size(0);
+	int local_id = get_local_id(0);
+
+	uint stride = get_global_size(0);
+	uint i, b, count;
+
+	// clear the private bins of the work-group
+	for (b = local_id; b < nbins; b += num_wrk_items)
+		local_bins[b] = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// count with local atomics
+	for (i = get_global_id(0); i < n; i += stride)
+		atomic_inc(&local_bins[bin_index(data[i], lo, scale, nbins)]);
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// merge into the global result, one global atomic per non-empty bin
+	for (b = local_id; b < nbins; b += num_wrk_items) {
+		count = local_bins[b];
+		if (count > 0)
+			atomic_add(&bins[b], count);
+	}
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: histogram_global
+// Purpose: count values per bin with global atomics, for bin counts whose
+//          private copy does not fit into local memory
+//
+// input: float* data     the values
+//        uint   n        number of values
+//        float  lo       lower bound of the first bin
+//        float  scale    nbins / (hi - lo)
+//        uint   nbins    number of bins
+//
+// output: uint* bins     the histogram (has to be zeroed before)
+//
+
+__kernel void histogram_global(
+	__global const float*	data,
+	const uint				n,
+	const float				lo,
+	const float				scale,
+	const uint				nbins,
+	__global uint*			bins)
+{
+	uint stride = get_global_size(0);
+	uint i;
+
+	for (i = get_global_id(0); i < n; i += stride)
+		atomic_inc(&bins[bin_index(data[i], lo, scale, nbins)]);
+}
\ No newline at end of file
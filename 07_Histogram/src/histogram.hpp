@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+//
+//  Histogram of float buffers
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CL/cl.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "filesystem.h"
+#include "runtime.hpp"
+
+namespace histogram {
+
+    // work-groups launched per compute unit, the kernels loop over the input
+    const unsigned GROUPS_PER_CU = 8;
+
+    // upper bound for the local size (it is also limited by the kernel)
+    const ::size_t MAX_LOCAL_SIZE = 256;
+
+    /// <summary>
+    /// Counts float values into nbins equally wide bins over [lo, hi).
+    ///
+    /// As long as the bins of a work-group fit into local memory every
+    /// work-group counts into a private copy with local atomics and merges it
+    /// into the result. Larger bin counts fall back to global atomics.
+    /// </summary>
+    class Histogram
+    {
+    public:
+        /// <summary>
+        /// Builds the histogram program.
+        /// </summary>
+        /// <param name="device">The device to build for</param>
+        /// <param name="queue">The queue the histograms are enqueued on</param>
+        Histogram(const cl::Device& device, const cl::CommandQueue& queue)
+            : queue_(queue)
+        {
+            program_ = ocl::Runtime::instance().program(device, FileSystem::getPath("kernel/histogram.cl"));
+
+            local_ = cl::Kernel(program_, "histogram_local");
+            global_ = cl::Kernel(program_, "histogram_global");
+
+            local_size_ = std::min(local_.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device), MAX_LOCAL_SIZE);
+            global_size_ = std::min(global_.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device), MAX_LOCAL_SIZE);
+            num_groups_ = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * GROUPS_PER_CU;
+
+            // local memory left for the bins after what the kernel itself uses
+            cl_ulong local_mem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+            cl_ulong kernel_mem = local_.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE>(device);
+            max_local_bins_ = static_cast<cl_uint>((local_mem - std::min(local_mem, kernel_mem)) / sizeof(cl_uint));
+        }
+
+        /// <summary>
+        /// True if nbins are counted in local memory.
+        /// </summary>
+        bool usesLocalMemory(cl_uint nbins) const
+        {
+            return nbins <= max_local_bins_;
+        }
+
+        /// <summary>
+        /// Counts the n values of data into bins (nbins counters).
+        /// </summary>
+        /// <param name="data">The values</param>
+        /// <param name="n">Number of values</param>
+        /// <param name="lo">Lower bound of the first bin</param>
+        /// <param name="hi">Upper bound of the last bin</param>
+        /// <param name="nbins">Number of bins</param>
+        /// <param name="bins">The histogram</param>
+        void operator()(const cl::Buffer& data, cl_uint n, float lo, float hi, cl_uint nbins, const cl::Buffer& bins)
+        {
+            float scale = nbins / (hi - lo);
+
+            queue_.enqueueFillBuffer(bins, cl_uint(0), 0, sizeof(cl_uint) * nbins);
+
+            if (usesLocalMemory(nbins)) {
+                local_.setArg(0, data);
+                local_.setArg(1, n);
+                local_.setArg(2, lo);
+                local_.setArg(3, scale);
+                local_.setArg(4, nbins);
+                local_.setArg(5, bins);
+                local_.setArg(6, cl::Local(sizeof(cl_uint) * nbins));
+                queue_.enqueueNDRangeKernel(local_, cl::NullRange,
+                    cl::NDRange(num_groups_ * local_size_), cl::NDRange(local_size_));
+            }
+            else {
+                global_.setArg(0, data);
+                global_.setArg(1, n);
+                global_.setArg(2, lo);
+                global_.setArg(3, scale);
+                global_.setArg(4, nbins);
+                global_.setArg(5, bins);
+                queue_.enqueueNDRangeKernel(global_, cl::NullRange,
+                    cl::NDRange(num_groups_ * global_size_), cl::NDRange(global_size_));
+            }
+        }
+
+    private:
+        cl::CommandQueue queue_;
+        cl::Program program_;
+        cl::Kernel local_;
+        cl::Kernel global_;
+
+        ::size_t local_size_;       // work-group size of histogram_local
+        ::size_t global_size_;      // work-group size of histogram_global
+        ::size_t num_groups_;       // number of work-groups of both kernels
+        cl_uint max_local_bins_;    // largest bin count that fits into local memory
+    };
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+/**
+ * Histogram in OpenCL
+ * Privatized local memory histogram with a global atomic fallback,
+ * for 16 to 64K bins
+ *
+ * Cpp code style
+ */
+
+// enable opencl exceptions
+#define __CL_ENABLE_EXCEPTIONS
+
+#include "CL/cl.hpp"    // Khronos C++ Wrapper API
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "filesystem.h"
+#include "util.hpp"
+#include "runtime.hpp"
+#include "device_selector.hpp"
+#include "histogram.hpp"
+
+#include <iostream>
+#include <fstream>
+
+#include "config.h"
+
+//------------------------------------------------------------------------------
+
+#define LENGTH  (1 << 25)   // number of values
+#define COUNT   10          // number of times to compute each histogram
+
+#define LO      0.0f        // range of the bins
+#define HI      1.0f
+
+// --------------------------------------------------------------------------------------
+
+/// <summary>
+/// Serial histogram on the host, using the same arithmetic as the kernels.
+/// </summary>
+/// <param name="data">The values</param>
+/// <param name="lo">Lower bound of the first bin</param>
+/// <param name="hi">Upper bound of the last bin</param>
+/// <param name="bins">The histogram, its size is the number of bins</param>
+void histogram_host(const std::vector<float>& data, float lo, float hi, std::vector<cl_uint>& bins)
+{
+    cl_uint nbins = static_cast<cl_uint>(bins.size());
+    float scale = nbins / (hi - lo);
+
+    std::fill(bins.begin(), bins.end(), 0);
+
+    for (::size_t i = 0; i < data.size(); i++) {
+        float f = (data[i] - lo) * scale;
+        cl_uint b;
+
+        if (f < 0.0f)
+            b = 0;
+        else if (f >= (float)nbins)
+            b = nbins - 1;
+        else
+            b = (cl_uint)f;
+
+        bins[b]++;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
+    // Print Programm Infos
+    std::cout << "OpenCL histogram - Version " <<
+       VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
+
+    // declare variables
+    std::vector<float> h_data(LENGTH);          // the values
+    std::vector<cl_uint> h_bins, h_ref;         // histograms of the device and the host
+
+    // uniform values in the range of the bins and a few outside of it
+    for (int i = 0; i < LENGTH; i++)
+        h_data[i] = rand() / ((float)RAND_MAX + 1.0f);
+    for (int i = 0; i < LENGTH; i += 1000)
+        h_data[i] = (i % 2000 == 0) ? LO - 1.0f : HI + 1.0f;
+
+    // bin counts from 16 to 64K
+    const cl_uint bin_counts[] = { 16, 64, 256, 1024, 4096, 16384, 65536 };
+
+    // any wrong bin fails the run
+    bool all_correct = true;
+
+    try
+    {
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
+
+        // print device name of the chosen device
+        std::string name = device.getInfo<CL_DEVICE_NAME>();
+        std::cout << "\nUsing OpenCL Device " << name << std::endl;
+
+        // context and queue of the device from the shared runtime
+        ocl::Runtime& runtime = ocl::Runtime::instance();
+        cl::Context context = runtime.context(device);
+        // Get the command queue
+        cl::CommandQueue queue = runtime.queue(device);
+
+        histogram::Histogram histogram(device, queue);
+
+        cl::Buffer d_data(context, h_data.begin(), h_data.end(), true);
+
+        std::cout << "\n===== Histogram of " << LENGTH << " values ======\n" << std::endl;
+
+        for (unsigned c = 0; c < sizeof(bin_counts) / sizeof(bin_counts[0]); c++)
+        {
+            cl_uint nbins = bin_counts[c];
+
+            h_bins = std::vector<cl_uint>(nbins);
+            h_ref = std::vector<cl_uint>(nbins);
+
+            cl::Buffer d_bins(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * nbins);
+
+            // warm up
+            histogram(d_data, LENGTH, LO, HI, nbins, d_bins);
+            queue.finish();
+
+            double best = 1.0e30;
+
+            for (int i = 0; i < COUNT; i++)
+            {
+                // start timepoint
+                auto start = std::chrono::high_resolution_clock::now();
+
+                histogram(d_data, LENGTH, LO, HI, nbins, d_bins);
+                queue.finish();
+
+                // end time stopping
+                auto stop = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+                best = std::min(best, (double)duration.count());
+            }
+
+            // copy data back from device
+            cl::copy(queue, d_bins, h_bins.begin(), h_bins.end());
+
+            // test the results
+            histogram_host(h_data, LO, HI, h_ref);
+
+            int correct = 0;
+            for (cl_uint b = 0; b < nbins; b++) {
+                if (h_bins[b] == h_ref[b])
+                    correct++;
+            }
+
+            double rate = LENGTH / (best / 1000000.0);
+
+            std::cout << nbins << " bins (" << (histogram.usesLocalMemory(nbins) ? "local" : "global") << " atomics) in "
+                      << best << " microseconds at " << rate / 1.0e9 << " billion elements per second. "
+                      << correct << " out of " << nbins << " bins were correct" << std::endl;
+
+            if (correct != (int)nbins)
+                all_correct = false;
+        }
+    }
+    // catch opencl error
+    catch (cl::Error err) {
+        // catch errors and print error data
+        std::cout << "OpenCL Error:" << err.what() << " returned " << std::endl;
+        std::cout << "Check cl.h for error codes." << std::endl;
+
+        exit(-1);
+    }
+
+    return all_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
\ No newline at end of file
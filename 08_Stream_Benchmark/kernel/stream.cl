@@ -0,0 +1,79 @@
+// --------------------------------------------------------------------------------------
+// STREAM kernels
+//
+// TYPE is the element type set when building: float for the scalar
+// variant, float4 (or any floatN) for the vector variant. count is the
+// number of TYPE elements. stream_add is vadd.
+//
+
+// --------------------------------------------------------------------------------------
+// kernel: stream_copy
+// Purpose: c = a
+// input: a vector of length count
+// output: c vector of length count
+//
+
+__kernel void stream_copy(
+	__global const TYPE* a,
+	__global TYPE* c,
+	const unsigned int count)
+{
+	int i = get_global_id(0);
+	if (i < count)
+		c[i] = a[i];
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: stream_scale
+// Purpose: b = q * c
+// input: c vector of length count, scalar q
+// output: b vector of length count
+//
+
+__kernel void stream_scale(
+	__global TYPE* b,
+	__global const TYPE* c,
+	const float q,
+	const unsigned int count)
+{
+	int i = get_global_id(0);
+	if (i < count)
+		b[i] = q * c[i];
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: stream_add
+// Purpose: c = a + b
+// input: a and b vectors of length count
+// output: c vector of length count
+//
+
+__kernel void stream_add(
+	__global const TYPE* a,
+	__global const TYPE* b,
+	__global TYPE* c,
+	const unsigned int count)
+{
+	int i = get_global_id(0);
+	if (i < count)
+		c[i] = a[i] + b[i];
+}
+
+// --------------------------------------------------------------------------------------
+// kernel: stream_triad
+// Purpose: a = b + q * c
+// input: b and c vectors of length count, scalar q
+// output: a vector of length count
+//
+
+__kernel void stream_triad(
+	__global TYPE* a,
+	__global const TYPE* b,
+	__global const TYPE* c,
+	const float q,
+	const unsigned int count)
+{
+	int i = get_global_id(0);
+	if (i < count)
+		a[i] = b[i] + q * c[i];
+}
\ No newline at end of file
@@ -0,0 +1,327 @@
+/**
+ * STREAM memory bandwidth benchmark in OpenCL
+ * Copy, Scale, Add (vadd) and Triad over arrays from cache resident sizes
+ * to hundreds of MB, in a scalar (float) and a vector (float4) variant
+ *
+ *     StreamBenchmark [--device=...] [--peak=GB/s] [--profile=file] [--min-efficiency=fraction]
+ *
+ * Without --peak the results are compared to the device copy bandwidth
+ * measured by PlatformInformation. With --min-efficiency the benchmark
+ * fails if the best bandwidth at the largest size stays below that
+ * fraction of the peak, for regression checks.
+ *
+ * Cpp code style
+ */
+
+// enable opencl exceptions
+#define __CL_ENABLE_EXCEPTIONS
+
+#include "CL/cl.hpp"    // Khronos C++ Wrapper API
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "runtime.hpp"
+#include "device_selector.hpp"
+#include "device_profile.hpp"
+
+#include <iostream>
+
+#include "config.h"
+
+//------------------------------------------------------------------------------
+
+#define NTIMES      10          // runs of every kernel, the first one is not counted
+#define MIN_LENGTH  (1 << 10)   // floats per array of the smallest size (4 KB)
+#define MAX_LENGTH  (1 << 26)   // floats per array of the largest size (256 MB)
+#define SIZE_STEP   4           // factor between sizes
+#define SCALAR      3.0f        // q of Scale and Triad
+#define TOL         1.0e-6      // relative tolerance of the validation
+
+// --------------------------------------------------------------------------------------
+
+/// <summary>
+/// A STREAM kernel and the number of arrays it reads and writes per element.
+/// </summary>
+struct StreamKernel
+{
+    const char* label;
+    const char* name;
+    int arrays;
+};
+
+const StreamKernel KERNELS[] = {
+    { "Copy",  "stream_copy",  2 },
+    { "Scale", "stream_scale", 2 },
+    { "Add",   "stream_add",   3 },
+    { "Triad", "stream_triad", 3 },
+};
+const int NKERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+/// <summary>
+/// A variant of the kernels: the element type and its width in floats.
+/// </summary>
+struct Variant
+{
+    const char* type;
+    unsigned width;
+};
+
+const Variant VARIANTS[] = {
+    { "float",  1 },
+    { "float4", 4 },
+};
+const int NVARIANTS = sizeof(VARIANTS) / sizeof(VARIANTS[0]);
+
+/// <summary>
+/// Duration of a profiled command in seconds.
+/// </summary>
+double eventSeconds(const cl::Event& event)
+{
+    cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+    return (end - start) * 1.0e-9;
+}
+
+/// <summary>
+/// Average relative error of the array against the expected value.
+/// </summary>
+double relativeError(const std::vector<float>& x, double expected)
+{
+    double sum = 0.0;
+    for (::size_t i = 0; i < x.size(); i++)
+        sum += std::fabs(x[i] - expected);
+    return sum / x.size() / std::fabs(expected);
+}
+
+/// <summary>
+/// Runs the four kernels NTIMES in the STREAM order on arrays of length floats.
+/// </summary>
+/// <param name="best">Best GB/s of each kernel</param>
+/// <param name="avg">Average GB/s of each kernel</param>
+/// <returns>True if the arrays hold the expected values afterwards</returns>
+bool runStream(const cl::Context& context, cl::CommandQueue& queue, const cl::Program& program,
+    const Variant& variant, cl_uint length, double best[], double avg[])
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    ::size_t bytes = sizeof(float) * length;
+    cl_uint count = length / variant.width;
+
+    cl::Buffer d_a(context, CL_MEM_READ_WRITE, bytes);
+    cl::Buffer d_b(context, CL_MEM_READ_WRITE, bytes);
+    cl::Buffer d_c(context, CL_MEM_READ_WRITE, bytes);
+
+    queue.enqueueFillBuffer(d_a, 1.0f, 0, bytes);
+    queue.enqueueFillBuffer(d_b, 2.0f, 0, bytes);
+    queue.enqueueFillBuffer(d_c, 0.0f, 0, bytes);
+
+    cl::Kernel& copy = runtime.kernel(program, "stream_copy");
+    copy.setArg(0, d_a);
+    copy.setArg(1, d_c);
+    copy.setArg(2, count);
+
+    cl::Kernel& scale = runtime.kernel(program, "stream_scale");
+    scale.setArg(0, d_b);
+    scale.setArg(1, d_c);
+    scale.setArg(2, SCALAR);
+    scale.setArg(3, count);
+
+    cl::Kernel& add = runtime.kernel(program, "stream_add");
+    add.setArg(0, d_a);
+    add.setArg(1, d_b);
+    add.setArg(2, d_c);
+    add.setArg(3, count);
+
+    cl::Kernel& triad = runtime.kernel(program, "stream_triad");
+    triad.setArg(0, d_a);
+    triad.setArg(1, d_b);
+    triad.setArg(2, d_c);
+    triad.setArg(3, SCALAR);
+    triad.setArg(4, count);
+
+    cl::Kernel* kernels[NKERNELS] = { &copy, &scale, &add, &triad };
+
+    // the same recurrence on the host, for the validation
+    double a = 1.0, b = 2.0, c = 0.0;
+
+    for (int j = 0; j < NKERNELS; j++) {
+        best[j] = 0.0;
+        avg[j] = 0.0;
+    }
+
+    for (int k = 0; k < NTIMES; k++) {
+        cl::Event events[NKERNELS];
+
+        for (int j = 0; j < NKERNELS; j++)
+            queue.enqueueNDRangeKernel(*kernels[j], cl::NullRange, cl::NDRange(count), cl::NullRange, NULL, &events[j]);
+        queue.finish();
+
+        c = a;
+        b = SCALAR * c;
+        c = a + b;
+        a = b + SCALAR * c;
+
+        // the first iteration is the warm up
+        if (k == 0)
+            continue;
+
+        for (int j = 0; j < NKERNELS; j++) {
+            double gbs = (double)KERNELS[j].arrays * bytes / eventSeconds(events[j]) / 1.0e9;
+            best[j] = std::max(best[j], gbs);
+            avg[j] += gbs / (NTIMES - 1);
+        }
+    }
+
+    // copy data back from device
+    std::vector<float> h_a(length), h_b(length), h_c(length);
+    queue.enqueueReadBuffer(d_a, CL_TRUE, 0, bytes, h_a.data());
+    queue.enqueueReadBuffer(d_b, CL_TRUE, 0, bytes, h_b.data());
+    queue.enqueueReadBuffer(d_c, CL_TRUE, 0, bytes, h_c.data());
+
+    return relativeError(h_a, a) < TOL && relativeError(h_b, b) < TOL && relativeError(h_c, c) < TOL;
+}
+
+
+int main(int argc, char* argv[])
+{
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
+    // Print Programm Infos
+    std::cout << "OpenCL STREAM benchmark - Version " <<
+       VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
+
+    double peak = -1.0;                                     // GB/s the results are compared to
+    std::string profile_path = ocl::DeviceProfile::defaultPath();
+    double min_efficiency = -1.0;                           // fraction of the peak required
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, 7, "--peak=") == 0)
+            peak = std::atof(arg.c_str() + 7);
+        else if (arg.compare(0, 10, "--profile=") == 0)
+            profile_path = arg.substr(10);
+        else if (arg.compare(0, 17, "--min-efficiency=") == 0)
+            min_efficiency = std::atof(arg.c_str() + 17);
+        else {
+            std::cout << "Unknown argument " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool valid = true;
+    bool efficient = true;
+
+    try
+    {
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
+
+        // print device name of the chosen device
+        std::string name = device.getInfo<CL_DEVICE_NAME>();
+        std::cout << "\nUsing OpenCL Device " << name << std::endl;
+
+        // context of the device and a profiling queue from the shared runtime
+        ocl::Runtime& runtime = ocl::Runtime::instance();
+        cl::Context context = runtime.context(device);
+        cl::CommandQueue queue = runtime.queue(device, CL_QUEUE_PROFILING_ENABLE);
+
+        // the reference bandwidth
+        std::string peak_source = "given";
+        if (peak <= 0.0) {
+            ocl::DeviceProfile profile;
+            if (profile.load(profile_path, device)) {
+                peak = profile.value("d2d_copy_gbs");
+                peak_source = "device copy measured by PlatformInformation";
+            }
+        }
+
+        if (peak > 0.0)
+            std::cout << "Reference bandwidth " << peak << " GB/s (" << peak_source << ")" << std::endl;
+        else
+            std::cout << "No reference bandwidth, pass --peak=GB/s or a PlatformInformation profile" << std::endl;
+
+        // three arrays have to fit into the device memory
+        cl_ulong max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+        cl_ulong global_mem = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+        cl_ulong max_bytes = std::min(max_alloc, global_mem / 4);
+
+        std::vector<cl_uint> lengths;
+        for (cl_ulong length = MIN_LENGTH; length <= MAX_LENGTH && sizeof(float) * length <= max_bytes; length *= SIZE_STEP)
+            lengths.push_back((cl_uint)length);
+
+        // best GB/s of every kernel at the largest size over both variants
+        double largest[NKERNELS] = { 0.0 };
+
+        for (int v = 0; v < NVARIANTS; v++)
+        {
+            const Variant& variant = VARIANTS[v];
+            cl::Program program = runtime.program(device, FileSystem::getPath("kernel/stream.cl"),
+                std::string("-DTYPE=") + variant.type);
+
+            std::cout << "\n===== STREAM, " << variant.type << " elements, best of " << NTIMES - 1 << " runs ======\n" << std::endl;
+            printf("%12s %8s %12s %12s %10s\n", "array size", "kernel", "best GB/s", "avg GB/s", "of peak");
+
+            for (::size_t s = 0; s < lengths.size(); s++)
+            {
+                double best[NKERNELS], avg[NKERNELS];
+                bool correct = runStream(context, queue, program, variant, lengths[s], best, avg);
+                valid = valid && correct;
+
+                double kb = sizeof(float) * lengths[s] / 1024.0;
+
+                for (int j = 0; j < NKERNELS; j++) {
+                    char size[32], fraction[32];
+                    if (kb < 1024.0)
+                        snprintf(size, sizeof(size), "%.0f KB", kb);
+                    else
+                        snprintf(size, sizeof(size), "%.0f MB", kb / 1024.0);
+
+                    if (peak > 0.0)
+                        snprintf(fraction, sizeof(fraction), "%.1f%%", 100.0 * best[j] / peak);
+                    else
+                        snprintf(fraction, sizeof(fraction), "-");
+
+                    printf("%12s %8s %12.2f %12.2f %10s\n", size, KERNELS[j].label, best[j], avg[j], fraction);
+
+                    if (s + 1 == lengths.size())
+                        largest[j] = std::max(largest[j], best[j]);
+                }
+
+                if (!correct)
+                    std::cout << "Validation failed for arrays of " << lengths[s] << " floats" << std::endl;
+            }
+        }
+
+        // regression check against the reference
+        if (min_efficiency > 0.0 && peak > 0.0) {
+            std::cout << std::endl;
+            for (int j = 0; j < NKERNELS; j++) {
+                bool ok = largest[j] >= min_efficiency * peak;
+                efficient = efficient && ok;
+
+                std::cout << KERNELS[j].label << ": " << largest[j] << " GB/s, "
+                          << (ok ? "at least " : "REGRESSION, below ") << min_efficiency * 100.0 << "% of peak" << std::endl;
+            }
+        }
+
+        std::cout << "\nResults " << (valid ? "validated" : "FAILED validation") << std::endl;
+    }
+    // catch opencl error
+    catch (cl::Error err) {
+        // catch errors and print error data
+        std::cout << "OpenCL Error:" << err.what() << " returned " << std::endl;
+        std::cout << "Check cl.h for error codes." << std::endl;
+
+        exit(-1);
+    }
+
+    return valid && efficient ? 0 : EXIT_FAILURE;
+
+}
\ No newline at end of file
@@ -0,0 +1,225 @@
+/**
+ * Concurrent submission benchmark
+ * Independent requests (a vadd or a matrix multiplication each, with their
+ * transfers) are submitted by a pool of worker threads, each with its own
+ * command queue, and the request throughput is measured for growing numbers
+ * of workers.
+ *
+ *     ConcurrentSubmission [--device=...]
+ *
+ * Cpp code style
+ */
+
+// enable opencl exceptions
+#define __CL_ENABLE_EXCEPTIONS
+
+#include "CL/cl.hpp"    // Khronos C++ Wrapper API
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "runtime.hpp"
+#include "device_selector.hpp"
+#include "submitter.hpp"
+#include "typed_program.hpp"
+#include "launch.hpp"
+
+#include <iostream>
+
+#include "config.h"
+
+//------------------------------------------------------------------------------
+
+#define TOL         (0.001)     // tolerance used in floating point comparisons
+#define LENGTH      (1 << 16)   // length of the vectors of a vadd request
+#define ORDER       128         // order of the matrices of a matmul request
+#define AVAL        3.0f        // A elements are constant and equal to AVAL
+#define BVAL        5.0f        // B elements are constant and equal to BVAL
+#define REQUESTS    512         // requests per run, half vadd, half matmul
+#define MAX_WORKERS 8           // the largest pool
+
+// --------------------------------------------------------------------------------------
+
+/// <summary>
+/// The device buffers and the result of one worker, requests of a worker run
+/// one after the other and reuse them.
+/// </summary>
+struct WorkerBuffers
+{
+    cl::Buffer a, b, c;         // vadd
+    cl::Buffer A, B, C;         // matmul
+    std::vector<float> h_c, h_C;
+};
+
+
+int main(int argc, char* argv[])
+{
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+
+    // Print Programm Infos
+    std::cout << "OpenCL Concurrent Submission - Version " <<
+       VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
+
+    // request inputs, shared by all requests
+    std::vector<float> h_a(LENGTH), h_b(LENGTH);
+    for (int i = 0; i < LENGTH; i++) {
+        h_a[i] = rand() / (float)RAND_MAX;
+        h_b[i] = rand() / (float)RAND_MAX;
+    }
+
+    std::vector<float> h_A(ORDER * ORDER, AVAL), h_B(ORDER * ORDER, BVAL);
+
+    // any wrong request fails the run
+    bool all_correct = true;
+
+    try
+    {
+        // the fastest suitable device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
+
+        // print device name of the chosen device
+        std::string name = device.getInfo<CL_DEVICE_NAME>();
+        std::cout << "\nUsing OpenCL Device " << name << std::endl;
+
+        ocl::Runtime& runtime = ocl::Runtime::instance();
+        cl::Context context = runtime.context(device);
+
+        // the programs are shared by all workers, the kernels are per worker
+        cl::Program vadd_program = ocl::typedProgram<cl_float>(device, FileSystem::getPath("../03_Vadd Kernel_cpp/kernel/vadd.cl"));
+        cl::Program matmul_program = runtime.program(device, FileSystem::getPath("../04_MatrixMult_cpp/kernel/matMul.cl"));
+
+        // the launches of every request, padded to whole work-groups
+        ocl::LaunchConfig vadd_launch = ocl::launchConfig(cl::Kernel(vadd_program, "vadd"), device, LENGTH);
+        ocl::LaunchConfig matmul_launch = ocl::launchConfig2D(cl::Kernel(matmul_program, "mat_mul"), device, ORDER, ORDER);
+
+        std::vector<WorkerBuffers> buffers(MAX_WORKERS);
+        for (int w = 0; w < MAX_WORKERS; w++) {
+            buffers[w].a = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * LENGTH);
+            buffers[w].b = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * LENGTH);
+            buffers[w].c = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * LENGTH);
+            buffers[w].A = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * ORDER * ORDER);
+            buffers[w].B = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * ORDER * ORDER);
+            buffers[w].C = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * ORDER * ORDER);
+            buffers[w].h_c.resize(LENGTH);
+            buffers[w].h_C.resize(ORDER * ORDER);
+        }
+
+        // a vadd request: upload, c = a + b, download, check
+        auto vadd_request = [&](ocl::Submitter::Worker& worker) {
+            WorkerBuffers& buf = buffers[worker.index()];
+            cl::CommandQueue& queue = worker.queue();
+
+            queue.enqueueWriteBuffer(buf.a, CL_FALSE, 0, sizeof(float) * LENGTH, h_a.data());
+            queue.enqueueWriteBuffer(buf.b, CL_FALSE, 0, sizeof(float) * LENGTH, h_b.data());
+
+            cl::Kernel& vadd = worker.kernel(vadd_program, "vadd");
+            vadd.setArg(0, buf.a);
+            vadd.setArg(1, buf.b);
+            vadd.setArg(2, buf.c);
+            vadd.setArg(3, (cl_uint)LENGTH);
+            queue.enqueueNDRangeKernel(vadd, cl::NullRange, vadd_launch.global, vadd_launch.local);
+
+            queue.enqueueReadBuffer(buf.c, CL_TRUE, 0, sizeof(float) * LENGTH, buf.h_c.data());
+
+            int correct = 0;
+            for (int i = 0; i < LENGTH; i++) {
+                float tmp = h_a[i] + h_b[i] - buf.h_c[i];
+                if (tmp * tmp < TOL * TOL)
+                    correct++;
+            }
+            return correct == LENGTH;
+        };
+
+        // a matmul request: upload, C = A * B, download, check
+        auto matmul_request = [&](ocl::Submitter::Worker& worker) {
+            WorkerBuffers& buf = buffers[worker.index()];
+            cl::CommandQueue& queue = worker.queue();
+
+            queue.enqueueWriteBuffer(buf.A, CL_FALSE, 0, sizeof(float) * ORDER * ORDER, h_A.data());
+            queue.enqueueWriteBuffer(buf.B, CL_FALSE, 0, sizeof(float) * ORDER * ORDER, h_B.data());
+
+            cl::Kernel& mat_mul = worker.kernel(matmul_program, "mat_mul");
+            mat_mul.setArg(0, ORDER);
+            mat_mul.setArg(1, buf.A);
+            mat_mul.setArg(2, buf.B);
+            mat_mul.setArg(3, buf.C);
+            queue.enqueueNDRangeKernel(mat_mul, cl::NullRange, matmul_launch.global, matmul_launch.local);
+
+            queue.enqueueReadBuffer(buf.C, CL_TRUE, 0, sizeof(float) * ORDER * ORDER, buf.h_C.data());
+
+            // every element of C is ORDER * AVAL * BVAL
+            float expected = ORDER * AVAL * BVAL;
+            for (int i = 0; i < ORDER * ORDER; i++) {
+                if (std::fabs(buf.h_C[i] - expected) > TOL * expected)
+                    return false;
+            }
+            return true;
+        };
+
+        std::cout << "\n===== " << REQUESTS << " requests (" << LENGTH << " element vadd, "
+                  << ORDER << "x" << ORDER << " matmul) ======\n" << std::endl;
+        printf("%8s %12s %14s %10s %10s\n", "workers", "time (ms)", "requests/s", "speedup", "correct");
+
+        double single = 0.0;
+
+        for (unsigned workers = 1; workers <= MAX_WORKERS; workers *= 2)
+        {
+            ocl::Submitter submitter(device, workers);
+
+            // warm up: the kernels of every worker are created on first use
+            for (unsigned w = 0; w < workers; w++) {
+                submitter.submit(vadd_request);
+                submitter.submit(matmul_request);
+            }
+            submitter.wait();
+
+            std::vector<ocl::Future<bool>> results;
+            results.reserve(REQUESTS);
+
+            // start timepoint
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (int r = 0; r < REQUESTS; r++) {
+                if (r % 2 == 0)
+                    results.push_back(submitter.submit(vadd_request));
+                else
+                    results.push_back(submitter.submit(matmul_request));
+            }
+            submitter.wait();
+
+            // end time stopping
+            auto stop = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+            int correct = 0;
+            for (int r = 0; r < REQUESTS; r++)
+                correct += results[r].get() ? 1 : 0;
+
+            double rate = REQUESTS / (duration.count() * 1.0e-6);
+            if (workers == 1)
+                single = rate;
+
+            printf("%8u %12.2f %14.1f %9.2fx %6d/%d\n", workers, duration.count() / 1000.0, rate, rate / single, correct, REQUESTS);
+
+            if (correct != REQUESTS)
+                all_correct = false;
+        }
+    }
+    // catch opencl error
+    catch (cl::Error err) {
+        // catch errors and print error data
+        std::cout << "OpenCL Error:" << err.what() << " returned " << std::endl;
+        std::cout << "Check cl.h for error codes." << std::endl;
+
+        exit(-1);
+    }
+
+    return all_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
\ No newline at end of file
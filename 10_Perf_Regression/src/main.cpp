@@ -0,0 +1,649 @@
+/**
+ * Performance regression suite
+ * Runs every variant of the vadd, matrix multiplication and numerical
+ * integration kernels of the other samples at fixed sizes, checks the
+ * results against host references and compares the throughput to a stored
+ * baseline of the device. A variant fails if its result is wrong or its
+ * throughput drops below the baseline by more than the tolerance.
+ * Every variant declares its flops and bytes, a roofline table shows
+ * whether it is bound by the memory bandwidth or the compute peak and how
+ * close it gets to that bound.
+ *
+ *     PerfRegression [--device=...] [--baseline=file] [--tolerance=fraction] [--write-baseline=file]
+ *                    [--profile=file] [--only=variant] [--require-measured-baseline]
+ *
+ * The suite runs on a CPU device (PoCL, the Intel or AMD CPU runtimes)
+ * unless --device or OCL_DEVICE picks another one. The exit status is 0 if
+ * all variants pass, so CI can run it as is. Devices without a baseline
+ * entry (of their own, or of their platform) are only checked for
+ * correctness; --write-baseline writes the entry of the device from the
+ * current run into the file, keeping the entries of the other devices.
+ * Entries marked "placeholder" hold floors rather than measurements and
+ * only catch a variant that collapses: the suite warns when it compares
+ * against one, --require-measured-baseline fails the run instead, as it
+ * does without any baseline. The peaks of the roofline come
+ * from the PlatformInformation profile, or are measured. A last table
+ * compares launches with the work-group size left to the driver against
+ * the ones ocl::launchConfig chooses, also on ranges of odd length.
+ * --only runs a single variant (its key in the baseline), ctest runs the
+ * suite and every variant as a test of its own.
+ *
+ * Cpp code style
+ */
+
+// enable opencl exceptions
+#define __CL_ENABLE_EXCEPTIONS
+
+#define _USE_MATH_DEFINES // for C++
+
+#include "CL/cl.hpp"    // Khronos C++ Wrapper API
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "runtime.hpp"
+#include "device_selector.hpp"
+#include "device_profile.hpp"
+#include "roofline.hpp"
+#include "launch.hpp"
+#include "typed_program.hpp"
+
+#include <iostream>
+
+#include "config.h"
+
+//------------------------------------------------------------------------------
+
+#define REPEATS     5           // timed runs of every variant, the best one counts
+#define TOLERANCE   0.15        // default allowed throughput loss against the baseline
+#define LENGTH      (1 << 22)   // length of the vadd vectors
+#define ORDER       256         // order of the square matrices, a multiple of 16 up to 1024
+#define BLOCK       16          // block size of matMulBlocForm.cl
+#define NSTEPS      (1 << 24)   // integration steps of pi
+#define NITERS      256         // integration steps per work item
+#define TOL         (0.001)     // relative tolerance of the result checks
+
+// --------------------------------------------------------------------------------------
+
+/// <summary>
+/// The outcome of one variant.
+/// </summary>
+struct Measurement
+{
+    std::string key;            // name in the baseline file
+    std::string label;
+    std::string size;
+    double rate;                // throughput, in unit
+    const char* unit;
+    bool correct;
+    ocl::KernelCost cost;       // work of one launch
+    double seconds;             // best launch
+};
+
+/// <summary>
+/// How a matrix multiplication kernel is launched.
+/// </summary>
+enum MatMulLaunch
+{
+    ELEMENT,                    // one work item per element of C
+    ROW,                        // one work item per row of C
+    ROW_LOCAL,                  // one work item per row, a column of B in local memory
+    BLOCKED                     // BLOCK x BLOCK work groups, blocks of A and B in local memory
+};
+
+/// <summary>
+/// A matrix multiplication kernel of 04_MatrixMult_cpp. Its global memory
+/// traffic is cubic * N^3 + quadratic * N^2 floats.
+/// </summary>
+struct MatMulVariant
+{
+    const char* key;
+    const char* label;
+    const char* file;
+    MatMulLaunch launch;
+    double cubic;
+    double quadratic;
+    bool typed;                 // type-generic source, built for float by ocl::typedProgram
+};
+
+// naive and C row read a row of A and a column of B per element of C,
+// A row private reads each row of A once, B row local reads A once and
+// every column of B once per work group (16 groups), blocked reads a
+// BLOCK wide strip of A and B per block of C
+const MatMulVariant MATMUL_VARIANTS[] = {
+    { "mat_mul_naive_gflops",       "mat_mul naive",            "matMul.cl",            ELEMENT,    2.0,            1.0,    false },
+    { "mat_mul_row_gflops",         "mat_mul C row",            "matMulRow.cl",         ROW,        2.0,            1.0,    false },
+    { "mat_mul_row_private_gflops", "mat_mul A row private",    "matMulRowPriv.cl",     ROW,        1.0,            2.0,    false },
+    { "mat_mul_row_local_gflops",   "mat_mul B row local",      "matMulRowPrivBloc.cl", ROW_LOCAL,  0.0,            18.0,   false },
+    { "mat_mul_blocked_gflops",     "mat_mul blocked",          "matMulBlocForm.cl",    BLOCKED,    2.0 / BLOCK,    1.0,    true },
+};
+const int NMATMUL_VARIANTS = sizeof(MATMUL_VARIANTS) / sizeof(MATMUL_VARIANTS[0]);
+
+/// <summary>
+/// The program of a matrix multiplication kernel, built on first use.
+/// </summary>
+cl::Program& matMulProgram(const cl::Device& device, const MatMulVariant& variant)
+{
+    std::string path = FileSystem::getPath(std::string("../04_MatrixMult_cpp/kernel/") + variant.file);
+    if (variant.typed)
+        return ocl::typedProgram<cl_float>(device, path);
+    return ocl::Runtime::instance().program(device, path);
+}
+
+/// <summary>
+/// Runs the kernel once to warm up and REPEATS times timed.
+/// </summary>
+/// <returns>The shortest run in seconds</returns>
+double bestSeconds(cl::CommandQueue& queue, const cl::Kernel& kernel, const cl::NDRange& global, const cl::NDRange& local)
+{
+    double best = 0.0;
+
+    for (int r = 0; r <= REPEATS; r++) {
+        cl::Event event;
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, NULL, &event);
+        event.wait();
+
+        cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        double seconds = (end - start) * 1.0e-9;
+
+        if (r == 1 || (r > 1 && seconds < best))
+            best = seconds;
+    }
+
+    return best;
+}
+
+/// <summary>
+/// c = a + b on random vectors (03_Vadd Kernel_cpp).
+/// </summary>
+Measurement runVadd(const cl::Device& device, cl::CommandQueue& queue)
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+
+    std::vector<float> h_a(LENGTH), h_b(LENGTH), h_c(LENGTH);
+    for (int i = 0; i < LENGTH; i++) {
+        h_a[i] = rand() / (float)RAND_MAX;
+        h_b[i] = rand() / (float)RAND_MAX;
+    }
+
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * LENGTH, h_a.data());
+    cl::Buffer d_b(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * LENGTH, h_b.data());
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(float) * LENGTH);
+
+    cl::Program& program = ocl::typedProgram<cl_float>(device, FileSystem::getPath("../03_Vadd Kernel_cpp/kernel/vadd.cl"));
+    cl::Kernel& vadd = runtime.kernel(program, "vadd");
+    vadd.setArg(0, d_a);
+    vadd.setArg(1, d_b);
+    vadd.setArg(2, d_c);
+    vadd.setArg(3, (cl_uint)LENGTH);
+
+    ocl::LaunchConfig launch = ocl::launchConfig(vadd, device, LENGTH);
+    double seconds = bestSeconds(queue, vadd, launch.global, launch.local);
+
+    queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * LENGTH, h_c.data());
+
+    int correct = 0;
+    for (int i = 0; i < LENGTH; i++) {
+        float tmp = h_a[i] + h_b[i] - h_c[i];
+        if (tmp * tmp < TOL * TOL)
+            correct++;
+    }
+
+    Measurement m;
+    m.key = "vadd_gbs";
+    m.label = "vadd";
+    m.size = std::to_string(LENGTH) + " floats";
+    m.rate = 3.0 * sizeof(float) * LENGTH / seconds / 1.0e9;
+    m.unit = "GB/s";
+    m.correct = correct == LENGTH;
+    m.cost.flops = LENGTH;
+    m.cost.bytes = 3.0 * sizeof(float) * LENGTH;
+    m.seconds = seconds;
+    return m;
+}
+
+/// <summary>
+/// C = A * B on random matrices with a kernel of 04_MatrixMult_cpp.
+/// </summary>
+Measurement runMatMul(const cl::Device& device, cl::CommandQueue& queue, const MatMulVariant& variant,
+    const std::vector<float>& h_A, const std::vector<float>& h_B, const std::vector<float>& reference)
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+    const int N = ORDER;
+
+    cl::Buffer d_a(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * N * N, (void*)h_A.data());
+    cl::Buffer d_b(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * N * N, (void*)h_B.data());
+    cl::Buffer d_c(context, CL_MEM_WRITE_ONLY, sizeof(float) * N * N);
+
+    cl::Program& program = matMulProgram(device, variant);
+    cl::Kernel& mat_mul = runtime.kernel(program, "mat_mul");
+    mat_mul.setArg(0, N);
+    mat_mul.setArg(1, d_a);
+    mat_mul.setArg(2, d_b);
+    mat_mul.setArg(3, d_c);
+
+    cl::NDRange global, local;
+    switch (variant.launch) {
+    case ELEMENT:
+        global = cl::NDRange(N, N);
+        break;
+    case ROW:
+        global = cl::NDRange(N);
+        break;
+    case ROW_LOCAL:
+        global = cl::NDRange(N);
+        local = cl::NDRange(N / 16);
+        mat_mul.setArg(4, cl::Local(sizeof(float) * N));
+        break;
+    case BLOCKED:
+        global = cl::NDRange(N, N);
+        local = cl::NDRange(BLOCK, BLOCK);
+        mat_mul.setArg(4, cl::Local(sizeof(float) * BLOCK * BLOCK));
+        mat_mul.setArg(5, cl::Local(sizeof(float) * BLOCK * BLOCK));
+        break;
+    }
+
+    double seconds = bestSeconds(queue, mat_mul, global, local);
+
+    std::vector<float> h_C(N * N);
+    queue.enqueueReadBuffer(d_c, CL_TRUE, 0, sizeof(float) * N * N, h_C.data());
+
+    bool correct = true;
+    for (int i = 0; i < N * N && correct; i++)
+        correct = std::fabs(h_C[i] - reference[i]) <= TOL * std::fabs(reference[i]) + TOL;
+
+    Measurement m;
+    m.key = variant.key;
+    m.label = variant.label;
+    m.size = std::to_string(N) + "x" + std::to_string(N);
+    m.rate = 2.0 * N * N * N / seconds / 1.0e9;
+    m.unit = "GFLOP/s";
+    m.correct = correct;
+    m.cost.flops = 2.0 * N * N * N;
+    m.cost.bytes = sizeof(float) * (variant.cubic * N * N * N + variant.quadratic * N * N);
+    m.seconds = seconds;
+    return m;
+}
+
+/// <summary>
+/// pi by the midpoint rule (05_Reduction_Numerical_Integration).
+/// </summary>
+Measurement runPi(const cl::Device& device, cl::CommandQueue& queue)
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+
+    cl::Program& program = runtime.program(device, FileSystem::getPath("../05_Reduction_Numerical_Integration/kernel/numIntegration.cl"));
+    cl::Kernel& pi = runtime.kernel(program, "pi");
+
+    ::size_t work_group_size = std::min<::size_t>(64, pi.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+    ::size_t work_groups = (NSTEPS + NITERS * work_group_size - 1) / (NITERS * work_group_size);
+    float step_size = 1.0f / NSTEPS;
+
+    cl::Buffer d_partial_sums(context, CL_MEM_WRITE_ONLY, sizeof(float) * work_groups);
+
+    pi.setArg(0, (int)NITERS);
+    pi.setArg(1, (cl_uint)NSTEPS);
+    pi.setArg(2, step_size);
+    pi.setArg(3, cl::Local(sizeof(float) * work_group_size));
+    pi.setArg(4, d_partial_sums);
+
+    double seconds = bestSeconds(queue, pi, cl::NDRange(work_groups * work_group_size), cl::NDRange(work_group_size));
+
+    std::vector<float> h_psum(work_groups);
+    queue.enqueueReadBuffer(d_partial_sums, CL_TRUE, 0, sizeof(float) * work_groups, h_psum.data());
+
+    double sum = 0.0;
+    for (::size_t g = 0; g < work_groups; g++)
+        sum += h_psum[g];
+
+    Measurement m;
+    m.key = "pi_gsteps";
+    m.label = "pi";
+    m.size = std::to_string(NSTEPS) + " steps";
+    m.rate = NSTEPS / seconds / 1.0e9;
+    m.unit = "Gsteps/s";
+    m.correct = std::fabs(sum * step_size - M_PI) < TOL * M_PI;
+    m.cost.flops = 5.0 * NSTEPS;                    // x = (i + 0.5) * step, 4 / (1 + x * x)
+    m.cost.bytes = sizeof(float) * work_groups;
+    m.seconds = seconds;
+    return m;
+}
+
+/// <summary>
+/// Times a kernel with the work-group size left to the driver and with the
+/// one chosen by ocl::launchConfig and prints both.
+/// </summary>
+/// <param name="label">The variant</param>
+/// <param name="size">The range, as printed</param>
+/// <param name="range">The range of the driver launch</param>
+/// <param name="chosen">The chosen launch, padded to whole work-groups</param>
+void compareLaunch(cl::CommandQueue& queue, const cl::Kernel& kernel, const char* label, const std::string& size,
+    const cl::NDRange& range, const ocl::LaunchConfig& chosen)
+{
+    double driver = bestSeconds(queue, kernel, range, cl::NullRange);
+    double tuned = bestSeconds(queue, kernel, chosen.global, chosen.local);
+
+    printf("%-24s %14s %12.3f %12.3f %8.2fx  %d x %d\n", label, size.c_str(), driver * 1000.0, tuned * 1000.0,
+        driver / tuned, (int)chosen.groups, (int)chosen.group_size);
+}
+
+/// <summary>
+/// The work-group size comparison of vadd and the matrix multiplications
+/// without local memory tiles, at the sizes of the suite and one less.
+/// </summary>
+void runLaunchComparison(const cl::Device& device, cl::CommandQueue& queue)
+{
+    ocl::Runtime& runtime = ocl::Runtime::instance();
+    cl::Context& context = runtime.context(device);
+    const int N = ORDER;
+
+    // the values do not matter, only that they are no denormals
+    cl::Buffer d_a(context, CL_MEM_READ_WRITE, sizeof(float) * LENGTH);
+    cl::Buffer d_b(context, CL_MEM_READ_WRITE, sizeof(float) * LENGTH);
+    cl::Buffer d_c(context, CL_MEM_READ_WRITE, sizeof(float) * LENGTH);
+    queue.enqueueFillBuffer(d_a, 1.0f, 0, sizeof(float) * LENGTH);
+    queue.enqueueFillBuffer(d_b, 1.0f, 0, sizeof(float) * LENGTH);
+    queue.finish();
+
+    printf("%-24s %14s %12s %12s %9s  %s\n", "variant", "size", "driver ms", "chosen ms", "speedup", "groups x size");
+
+    // own kernel objects, the work-group sizes are chosen before any __local argument is set
+    cl::Program& vadd_program = ocl::typedProgram<cl_float>(device, FileSystem::getPath("../03_Vadd Kernel_cpp/kernel/vadd.cl"));
+    cl::Kernel vadd(vadd_program, "vadd");
+    vadd.setArg(0, d_a);
+    vadd.setArg(1, d_b);
+    vadd.setArg(2, d_c);
+
+    const int lengths[] = { LENGTH, LENGTH - 1 };
+    for (int l = 0; l < 2; l++) {
+        vadd.setArg(3, (cl_uint)lengths[l]);
+        compareLaunch(queue, vadd, "vadd", std::to_string(lengths[l]), cl::NDRange(lengths[l]),
+            ocl::launchConfig(vadd, device, lengths[l]));
+    }
+
+    const int orders[] = { N, N - 1 };
+    for (int v = 0; v < NMATMUL_VARIANTS; v++) {
+        const MatMulVariant& variant = MATMUL_VARIANTS[v];
+        if (variant.launch == BLOCKED)
+            continue;   // the block size is fixed in the kernel
+
+        cl::Program& program = matMulProgram(device, variant);
+
+        for (int o = 0; o < 2; o++) {
+            int n = orders[o];
+            cl::Kernel mat_mul(program, "mat_mul");
+            ocl::LaunchConfig chosen;
+            cl::NDRange range(n);
+
+            if (variant.launch == ELEMENT) {
+                chosen = ocl::launchConfig2D(mat_mul, device, n, n);
+                range = cl::NDRange(n, n);
+            }
+            else if (variant.launch == ROW_LOCAL) {
+                chosen = ocl::launchConfig(mat_mul, device, n, 0, sizeof(float) * n);
+                mat_mul.setArg(4, cl::Local(sizeof(float) * n));
+            }
+            else {
+                chosen = ocl::launchConfig(mat_mul, device, n);
+            }
+
+            mat_mul.setArg(0, n);
+            mat_mul.setArg(1, d_a);
+            mat_mul.setArg(2, d_b);
+            mat_mul.setArg(3, d_c);
+
+            compareLaunch(queue, mat_mul, variant.label, std::to_string(n) + "x" + std::to_string(n), range, chosen);
+        }
+    }
+}
+
+/// <summary>
+/// Writes the measurements into the baseline entry of the device (same name
+/// and driver) in the format of the PlatformInformation profile. The other
+/// devices and values of the file are kept, the entry is added if the
+/// device has none.
+/// </summary>
+bool writeBaseline(const std::string& path, const cl::Device& device, const std::vector<Measurement>& results)
+{
+    std::vector<ocl::ProfileEntry> entries;
+
+    // a file that exists but cannot be parsed is not overwritten
+    if (!ocl::DeviceProfile::readEntries(path, entries) && std::ifstream(path.c_str()).is_open())
+        return false;
+
+    std::string name = device.getInfo<CL_DEVICE_NAME>();
+    std::string driver = device.getInfo<CL_DRIVER_VERSION>();
+
+    ocl::ProfileEntry* entry = nullptr;
+    for (::size_t d = 0; d < entries.size() && entry == nullptr; d++) {
+        const ocl::ProfileValue* entry_name = ocl::DeviceProfile::find(entries[d], "name");
+        const ocl::ProfileValue* entry_driver = ocl::DeviceProfile::find(entries[d], "driver");
+
+        if (entry_name != nullptr && entry_name->text == name && entry_driver != nullptr && entry_driver->text == driver)
+            entry = &entries[d];
+    }
+
+    if (entry == nullptr) {
+        ocl::ProfileValue name_value = { name, true };
+        ocl::ProfileValue driver_value = { driver, true };
+
+        entries.push_back(ocl::ProfileEntry());
+        entry = &entries.back();
+        ocl::DeviceProfile::set(*entry, "name", name_value);
+        ocl::DeviceProfile::set(*entry, "driver", driver_value);
+    }
+
+    for (::size_t i = 0; i < results.size(); i++) {
+        std::ostringstream rate;
+        rate << results[i].rate;
+        ocl::ProfileValue value = { rate.str(), false };
+        ocl::DeviceProfile::set(*entry, results[i].key, value);
+    }
+
+    return ocl::DeviceProfile::writeEntries(path, entries);
+}
+
+int main(int argc, char* argv[])
+{
+    // device selection options are removed from the arguments
+    ocl::DeviceSelector selector(argc, argv);
+    selector.type(CL_DEVICE_TYPE_CPU);
+
+    // Print Programm Infos
+    std::cout << "OpenCL Performance Regression Suite - Version " <<
+       VERSION_MAJOR << "." << VERSION_MINOR << std::endl;
+
+    std::string baseline_path = FileSystem::getPath("perf_baseline.json");
+    std::string write_path;
+    std::string profile_path = ocl::DeviceProfile::defaultPath();
+    std::string only;
+    double tolerance = TOLERANCE;
+    bool require_measured = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, 11, "--baseline=") == 0)
+            baseline_path = arg.substr(11);
+        else if (arg.compare(0, 12, "--tolerance=") == 0)
+            tolerance = std::atof(arg.c_str() + 12);
+        else if (arg.compare(0, 17, "--write-baseline=") == 0)
+            write_path = arg.substr(17);
+        else if (arg.compare(0, 10, "--profile=") == 0)
+            profile_path = arg.substr(10);
+        else if (arg.compare(0, 7, "--only=") == 0)
+            only = arg.substr(7);
+        else if (arg == "--require-measured-baseline")
+            require_measured = true;
+        else {
+            std::cout << "Unknown argument " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // the variant keys, --only picks one of them
+    std::vector<std::string> keys;
+    keys.push_back("vadd_gbs");
+    for (int v = 0; v < NMATMUL_VARIANTS; v++)
+        keys.push_back(MATMUL_VARIANTS[v].key);
+    keys.push_back("pi_gsteps");
+
+    if (!only.empty() && std::find(keys.begin(), keys.end(), only) == keys.end()) {
+        std::cout << "Unknown variant " << only << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto selected = [&only](const std::string& key) { return only.empty() || only == key; };
+
+    int failures = 0;
+
+    try
+    {
+        // a CPU device, unless --device=... or OCL_DEVICE picks one
+        cl::Device device = selector.select();
+
+        // print device name of the chosen device
+        std::string name = device.getInfo<CL_DEVICE_NAME>();
+        std::cout << "\nUsing OpenCL Device " << name << " (" << device.getInfo<CL_DRIVER_VERSION>() << ")" << std::endl;
+
+        ocl::DeviceProfile baseline;
+        bool has_baseline = baseline.load(baseline_path, device);
+        if (has_baseline)
+            std::cout << "Baseline " << baseline_path << ", tolerance " << tolerance * 100.0 << "%" << std::endl;
+        else
+            std::cout << "No baseline of the device in " << baseline_path << ", checking results only" << std::endl;
+
+        // floors instead of measurements catch a collapse, not a regression
+        bool placeholder = has_baseline && baseline.text("placeholder") == "true";
+        if (placeholder) {
+            std::cout << "\n*****************************************************************************" << std::endl;
+            std::cout << "WARNING: the baseline entry of the device holds placeholder floors, not" << std::endl;
+            std::cout << "measurements. Regressions within the floors go unnoticed; add a measured entry" << std::endl;
+            std::cout << "with --write-baseline=" << baseline_path << " on this machine." << std::endl;
+            std::cout << "*****************************************************************************" << std::endl;
+        }
+
+        cl::CommandQueue& queue = ocl::Runtime::instance().queue(device, CL_QUEUE_PROFILING_ENABLE);
+
+        // fixed inputs, the same in every run
+        srand(1);
+
+        std::vector<Measurement> results;
+        if (selected("vadd_gbs"))
+            results.push_back(runVadd(device, queue));
+
+        // the matrices and their product on the host, shared by all variants
+        std::vector<float> h_A(ORDER * ORDER), h_B(ORDER * ORDER), reference(ORDER * ORDER);
+        for (int i = 0; i < ORDER * ORDER; i++) {
+            h_A[i] = rand() / (float)RAND_MAX;
+            h_B[i] = rand() / (float)RAND_MAX;
+        }
+
+        for (int i = 0; i < ORDER; i++) {
+            for (int j = 0; j < ORDER; j++) {
+                double tmp = 0.0;
+                for (int k = 0; k < ORDER; k++)
+                    tmp += (double)h_A[i * ORDER + k] * h_B[k * ORDER + j];
+                reference[i * ORDER + j] = (float)tmp;
+            }
+        }
+
+        for (int v = 0; v < NMATMUL_VARIANTS; v++) {
+            if (selected(MATMUL_VARIANTS[v].key))
+                results.push_back(runMatMul(device, queue, MATMUL_VARIANTS[v], h_A, h_B, reference));
+        }
+
+        if (selected("pi_gsteps"))
+            results.push_back(runPi(device, queue));
+
+        std::cout << "\n===== best of " << REPEATS << " runs ======\n" << std::endl;
+        printf("%-24s %14s %12s %12s %10s  %s\n", "variant", "size", "throughput", "baseline", "change", "status");
+
+        for (::size_t i = 0; i < results.size(); i++) {
+            const Measurement& m = results[i];
+            double expected = has_baseline ? baseline.value(m.key) : -1.0;
+
+            char rate[32], base[32], change[32];
+            snprintf(rate, sizeof(rate), "%.2f", m.rate);
+            if (expected > 0.0) {
+                snprintf(base, sizeof(base), "%.2f", expected);
+                snprintf(change, sizeof(change), "%+.1f%%", 100.0 * (m.rate / expected - 1.0));
+            }
+            else {
+                snprintf(base, sizeof(base), "-");
+                snprintf(change, sizeof(change), "-");
+            }
+
+            const char* status = "ok";
+            if (!m.correct)
+                status = "FAILED, wrong result";
+            else if (expected > 0.0 && m.rate < (1.0 - tolerance) * expected)
+                status = "FAILED, regression";
+            else if (expected > 0.0 && placeholder)
+                status = "ok, above the placeholder floor";
+            else if (expected > 0.0 && m.rate > (1.0 + tolerance) * expected)
+                status = "ok, faster than the baseline";
+            else if (expected <= 0.0)
+                status = "ok, no baseline";
+
+            if (status[0] == 'F')
+                failures++;
+
+            printf("%-24s %14s %12s %12s %10s  %s (%s)\n", m.label.c_str(), m.size.c_str(), rate, base, change, status, m.unit);
+        }
+
+        // where tuning pays off: memory bound variants gain from reuse, compute
+        // bound ones from vectorization and fewer instructions
+        std::cout << "\n===== roofline ======\n" << std::endl;
+
+        ocl::Roofline roofline = ocl::Roofline::forDevice(device, profile_path);
+        roofline.printHeader();
+
+        for (::size_t i = 0; i < results.size(); i++)
+            roofline.print(results[i].label, results[i].cost, results[i].seconds);
+
+        // no local size leaves the work-group size to the driver, which for
+        // odd ranges may fall back to very small work-groups
+        if (only.empty()) {
+            std::cout << "\n===== work-group size, driver default against chosen, best of " << REPEATS << " runs ======\n" << std::endl;
+
+            runLaunchComparison(device, queue);
+        }
+
+        if (!write_path.empty()) {
+            if (writeBaseline(write_path, device, results))
+                std::cout << "\nBaseline of the device written to " << write_path << std::endl;
+            else
+                std::cout << "\nCannot write " << write_path << std::endl;
+        }
+
+        std::cout << "\n" << failures << " of " << results.size() << " variants failed" << std::endl;
+
+        if (require_measured && (!has_baseline || placeholder)) {
+            std::cout << "No measured baseline of the device, failing (--require-measured-baseline)" << std::endl;
+            failures++;
+        }
+    }
+    // catch opencl error
+    catch (cl::Error err) {
+        // catch errors and print error data
+        std::cout << "OpenCL Error:" << err.what() << " returned " << std::endl;
+        std::cout << "Check cl.h for error codes." << std::endl;
+
+        exit(-1);
+    }
+
+    return failures == 0 ? 0 : EXIT_FAILURE;
+
+}
\ No newline at end of file
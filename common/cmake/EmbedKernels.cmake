@@ -0,0 +1,90 @@
+# Kernel embedding
+# ############
+# embed_kernels(<target> <kernel files>... [SOURCE_ONLY <kernel files>...])
+#
+# Compiles the kernel sources into the target as constants, registered with
+# the runtime (ocl::embedKernel) before main. Runtime::program() then takes
+# them from memory instead of reading the files, matched by the path relative
+# to the project (kernel/<name>.cl).
+#
+# Where clang and llvm-spirv are found the kernels are also compiled to
+# SPIR-V at build time and the modules embedded next to the sources, the
+# runtime builds them instead of the sources on devices taking SPIR-V.
+# OCL_OFFLINE_COMPILE=OFF disables that, OCL_CLANG and OCL_LLVM_SPIRV
+# point to the tools. Kernels listed after SOURCE_ONLY are embedded without
+# SPIR-V: sources that only compile with build options, like the
+# type-generic kernels (-DT=... -DACC=..., typed_program.hpp), which the
+# runtime builds from source anyway.
+
+option(OCL_OFFLINE_COMPILE "Compile the embedded kernels to SPIR-V with clang and llvm-spirv" ON)
+
+find_program(OCL_CLANG NAMES clang)
+find_program(OCL_LLVM_SPIRV NAMES llvm-spirv)
+
+set(EMBED_KERNELS_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/EmbedKernelsGenerate.cmake)
+
+function(embed_kernels target)
+	set(generated ${CMAKE_CURRENT_BINARY_DIR}/embedded_kernels.cpp)
+	set(list_file ${CMAKE_CURRENT_BINARY_DIR}/embedded_kernels.txt)
+
+	cmake_parse_arguments(EMBED "" "" "SOURCE_ONLY" ${ARGN})
+
+	set(source_only "")
+	foreach(kernel IN LISTS EMBED_SOURCE_ONLY)
+		get_filename_component(kernel ${kernel} ABSOLUTE)
+		list(APPEND source_only ${kernel})
+	endforeach()
+
+	# every kernel once, the source only ones may be in both lists
+	set(kernels ${EMBED_UNPARSED_ARGUMENTS} ${EMBED_SOURCE_ONLY})
+	set(all "")
+	foreach(kernel IN LISTS kernels)
+		get_filename_component(kernel ${kernel} ABSOLUTE)
+		list(APPEND all ${kernel})
+	endforeach()
+	list(REMOVE_DUPLICATES all)
+
+	set(offline OFF)
+	if(OCL_OFFLINE_COMPILE AND OCL_CLANG AND OCL_LLVM_SPIRV)
+		set(offline ON)
+	endif()
+
+	# one line per kernel: name|source|spir-v module
+	set(entries "")
+	set(depends ${EMBED_KERNELS_SCRIPT})
+
+	foreach(kernel IN LISTS all)
+		file(RELATIVE_PATH name ${CMAKE_CURRENT_SOURCE_DIR} ${kernel})
+		set(il "")
+
+		list(FIND source_only ${kernel} only)
+		if(offline AND only EQUAL -1)
+			set(il ${CMAKE_CURRENT_BINARY_DIR}/spirv/${name}.spv)
+			get_filename_component(il_dir ${il} DIRECTORY)
+
+			add_custom_command(OUTPUT ${il}
+				COMMAND ${CMAKE_COMMAND} -E make_directory ${il_dir}
+				COMMAND ${OCL_CLANG} -c -target spir64 -cl-std=CL1.2 -O2 -emit-llvm
+					-Xclang -finclude-default-header -o ${il}.bc ${kernel}
+				COMMAND ${OCL_LLVM_SPIRV} ${il}.bc -o ${il}
+				DEPENDS ${kernel}
+				COMMENT "Compiling ${name} to SPIR-V"
+				VERBATIM)
+
+			list(APPEND depends ${il})
+		endif()
+
+		list(APPEND depends ${kernel})
+		string(APPEND entries "${name}|${kernel}|${il}\n")
+	endforeach()
+
+	file(WRITE ${list_file} "${entries}")
+
+	add_custom_command(OUTPUT ${generated}
+		COMMAND ${CMAKE_COMMAND} -DLIST=${list_file} -DOUTPUT=${generated} -P ${EMBED_KERNELS_SCRIPT}
+		DEPENDS ${depends} ${list_file}
+		COMMENT "Embedding the kernels of ${target}"
+		VERBATIM)
+
+	target_sources(${target} PRIVATE ${generated})
+endfunction()
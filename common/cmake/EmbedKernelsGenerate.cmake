@@ -0,0 +1,75 @@
+# Kernel embedding, build step (see EmbedKernels.cmake)
+# ############
+# cmake -DLIST=<kernel list> -DOUTPUT=<cpp file> -P EmbedKernelsGenerate.cmake
+#
+# Writes the sources and SPIR-V modules of the list as byte arrays and the
+# registration with the runtime.
+
+cmake_minimum_required(VERSION 3.10)
+
+# bytes of a file as a C initializer list
+function(hex_array file out)
+	file(READ ${file} hex HEX)
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+	# 16 bytes per line
+	set(line "")
+	foreach(i RANGE 15)
+		string(APPEND line "0x..,")
+	endforeach()
+	string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${bytes}")
+	set(${out} "${bytes}" PARENT_SCOPE)
+endfunction()
+
+file(STRINGS ${LIST} entries)
+
+set(arrays "")
+set(registrations "")
+set(index 0)
+
+foreach(entry IN LISTS entries)
+	string(REPLACE "|" ";" fields "${entry}")
+	list(GET fields 0 name)
+	list(GET fields 1 source)
+	list(LENGTH fields count)
+
+	hex_array(${source} source_bytes)
+	# the source is terminated, its size does not count the 0
+	string(APPEND arrays "    // ${name}\n    const unsigned char source_${index}[] = {\n    ${source_bytes}0x00 };\n")
+
+	set(il "")
+	if(count GREATER 2)
+		list(GET fields 2 il)
+	endif()
+
+	if(il)
+		hex_array(${il} il_bytes)
+		string(APPEND arrays "    const unsigned char il_${index}[] = {\n    ${il_bytes} };\n")
+		string(APPEND registrations "            ocl::embedKernel(\"${name}\", (const char*)source_${index}, sizeof(source_${index}) - 1, il_${index}, sizeof(il_${index}));\n")
+	else()
+		string(APPEND registrations "            ocl::embedKernel(\"${name}\", (const char*)source_${index}, sizeof(source_${index}) - 1, nullptr, 0);\n")
+	endif()
+
+	string(APPEND arrays "\n")
+	math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// generated by embed_kernels(), do not edit
+
+#include \"embedded.hpp\"
+
+namespace {
+
+${arrays}    // registers the kernels before main
+    struct Registration
+    {
+        Registration()
+        {
+${registrations}        }
+    } registration;
+}
+")
+
+# only touch the output if it changed
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+//
+//  Asynchronous host API
+//
+//------------------------------------------------------------------------------
+
+#include "async.hpp"
+
+#include <deque>
+#include <thread>
+
+namespace ocl {
+
+    namespace detail {
+
+        namespace {
+
+            /// <summary>
+            /// The worker thread running the continuations. It finishes the
+            /// posted tasks before the process exits.
+            /// </summary>
+            class Executor
+            {
+            public:
+                static Executor& instance()
+                {
+                    static Executor executor;
+                    return executor;
+                }
+
+                void post(std::function<void()> task)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        tasks_.push_back(task);
+                    }
+                    pending_.notify_one();
+                }
+
+                bool onWorker() const
+                {
+                    return std::this_thread::get_id() == worker_.get_id();
+                }
+
+                // runs the next queued task on the calling thread, false if there is none
+                bool runOne()
+                {
+                    std::function<void()> task;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        if (tasks_.empty())
+                            return false;
+
+                        task = tasks_.front();
+                        tasks_.pop_front();
+                    }
+                    task();
+                    return true;
+                }
+
+            private:
+                Executor() : stop_(false), worker_(&Executor::run, this) {}
+
+                ~Executor()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        stop_ = true;
+                    }
+                    pending_.notify_one();
+                    worker_.join();
+                }
+
+                void run()
+                {
+                    for (;;) {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex_);
+                            pending_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                            if (tasks_.empty())
+                                return;
+
+                            task = tasks_.front();
+                            tasks_.pop_front();
+                        }
+                        task();
+                    }
+                }
+
+                std::mutex mutex_;
+                std::condition_variable pending_;
+                std::deque<std::function<void()>> tasks_;
+                bool stop_;
+                std::thread worker_;
+            };
+
+            // the event callback, owns the handler
+            void CL_CALLBACK complete(cl_event, cl_int status, void* user_data)
+            {
+                std::unique_ptr<std::function<void(cl_int)>> done(static_cast<std::function<void(cl_int)>*>(user_data));
+                (*done)(status);
+            }
+        }
+
+        void post(std::function<void()> task)
+        {
+            Executor::instance().post(task);
+        }
+
+        bool onWorker()
+        {
+            return Executor::instance().onWorker();
+        }
+
+        bool runQueued()
+        {
+            return Executor::instance().runOne();
+        }
+
+        void onComplete(cl::Event& event, std::function<void(cl_int)> done)
+        {
+            // the executor has to outlive every callback
+            Executor::instance();
+
+            std::unique_ptr<std::function<void(cl_int)>> handler(new std::function<void(cl_int)>(done));
+            event.setCallback(CL_COMPLETE, &complete, handler.get());
+            handler.release();
+        }
+    }
+
+    Future<void> whenComplete(const cl::Event& event)
+    {
+        std::shared_ptr<detail::State<detail::Unit>> state = std::make_shared<detail::State<detail::Unit>>();
+        cl::Event target = event;
+
+        detail::onComplete(target, [state](cl_int status) {
+            if (status < 0)
+                state->fail(std::make_exception_ptr(cl::Error(status, "whenComplete")));
+            else
+                state->set(detail::Unit());
+        });
+
+        return Future<void>(state, event);
+    }
+
+    Future<void> launchAsync(cl::CommandQueue& queue, const cl::Kernel& kernel, const cl::NDRange& global,
+        const cl::NDRange& local, const std::vector<cl::Event>* wait)
+    {
+        cl::Event event;
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, wait, &event);
+        queue.flush();
+
+        return whenComplete(event);
+    }
+
+    Future<void> whenAll(const std::vector<Future<void>>& futures)
+    {
+        struct Gather
+        {
+            std::mutex mutex;
+            ::size_t remaining;
+            std::exception_ptr error;
+        };
+
+        std::shared_ptr<detail::State<detail::Unit>> state = std::make_shared<detail::State<detail::Unit>>();
+        std::shared_ptr<Gather> gather = std::make_shared<Gather>();
+        gather->remaining = futures.size();
+
+        if (futures.empty())
+            state->set(detail::Unit());
+
+        for (::size_t i = 0; i < futures.size(); i++) {
+            std::shared_ptr<Future<void>::state_type> source = futures[i].state();
+
+            source->onReady([source, gather, state]() {
+                std::exception_ptr error = source->error();
+                bool last;
+                {
+                    std::lock_guard<std::mutex> lock(gather->mutex);
+                    if (error && !gather->error)
+                        gather->error = error;
+                    last = --gather->remaining == 0;
+                }
+
+                if (last && gather->error)
+                    state->fail(gather->error);
+                else if (last)
+                    state->set(detail::Unit());
+            });
+        }
+
+        return Future<void>(state);
+    }
+}
\ No newline at end of file
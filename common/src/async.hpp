@@ -0,0 +1,395 @@
+//------------------------------------------------------------------------------
+//
+//  Asynchronous host API
+//
+//  Launches, writes and reads return a Future instead of blocking. A future
+//  is completed from the event callback (clSetEventCallback) of its command,
+//  so the host thread is free while the device works. Continuations added
+//  with then() and whenAll() run on a worker thread of the library, never on
+//  the driver thread calling back, so they may block and enqueue. A
+//  continuation may also wait for another future: while the worker waits it
+//  runs the queued continuations itself, so a future completed by one of
+//  them does not deadlock the worker.
+//
+//  The commands are flushed when they are enqueued, otherwise a callback
+//  might wait for a flush that never comes.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ocl {
+
+    namespace detail {
+
+        /// <summary>
+        /// Runs the continuations of the futures, one after the other.
+        /// </summary>
+        void post(std::function<void()> task);
+
+        /// <summary>
+        /// True on the worker thread running the continuations.
+        /// </summary>
+        bool onWorker();
+
+        /// <summary>
+        /// Runs the next queued continuation on the calling thread.
+        /// </summary>
+        /// <returns>False if none was queued</returns>
+        bool runQueued();
+
+        /// <summary>
+        /// Calls done with the execution status once the command of the event
+        /// completed (CL_COMPLETE) or failed (negative status).
+        /// </summary>
+        void onComplete(cl::Event& event, std::function<void(cl_int)> done);
+
+        // the value of a Future<void>
+        struct Unit {};
+
+        /// <summary>
+        /// The shared state of a future, S is default constructible.
+        /// </summary>
+        template<typename S>
+        class State
+        {
+        public:
+            State() : done_(false) {}
+
+            void set(S value)
+            {
+                std::vector<std::function<void()>> continuations;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    value_ = std::move(value);
+                    done_ = true;
+                    continuations.swap(continuations_);
+                }
+                ready_.notify_all();
+
+                for (::size_t i = 0; i < continuations.size(); i++)
+                    post(continuations[i]);
+            }
+
+            void fail(std::exception_ptr error)
+            {
+                std::vector<std::function<void()>> continuations;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    error_ = error;
+                    done_ = true;
+                    continuations.swap(continuations_);
+                }
+                ready_.notify_all();
+
+                for (::size_t i = 0; i < continuations.size(); i++)
+                    post(continuations[i]);
+            }
+
+            // runs the continuation once the state is done
+            void onReady(std::function<void()> continuation)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!done_) {
+                        continuations_.push_back(continuation);
+                        return;
+                    }
+                }
+                post(continuation);
+            }
+
+            bool done()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return done_;
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!onWorker()) {
+                    ready_.wait(lock, [this] { return done_; });
+                    return;
+                }
+
+                // a continuation waiting on the worker: the state may be set by a
+                // continuation queued behind it, so run those meanwhile
+                while (!done_) {
+                    lock.unlock();
+                    bool ran = runQueued();
+                    lock.lock();
+
+                    if (!ran && !done_)
+                        ready_.wait_for(lock, std::chrono::milliseconds(1));
+                }
+            }
+
+            // the value after wait(), rethrows the error
+            const S& value()
+            {
+                wait();
+                if (error_)
+                    std::rethrow_exception(error_);
+                return value_;
+            }
+
+            std::exception_ptr error()
+            {
+                wait();
+                return error_;
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable ready_;
+            bool done_;
+            S value_;
+            std::exception_ptr error_;
+            std::vector<std::function<void()>> continuations_;
+        };
+
+        // how a T is stored in the state and handed to continuations
+        template<typename T>
+        struct Stored
+        {
+            typedef T type;
+            typedef const T& result;
+
+            static const T& get(const T& value) { return value; }
+
+            template<typename F>
+            static auto apply(F& f, const T& value) -> decltype(f(value)) { return f(value); }
+        };
+
+        template<>
+        struct Stored<void>
+        {
+            typedef Unit type;
+            typedef void result;
+
+            static void get(const Unit&) {}
+
+            template<typename F>
+            static auto apply(F& f, const Unit&) -> decltype(f()) { return f(); }
+        };
+
+        // stores the result of compute, or its exception
+        template<typename R>
+        struct Complete
+        {
+            template<typename F>
+            static void run(State<R>& state, F& compute) { state.set(compute()); }
+        };
+
+        template<>
+        struct Complete<void>
+        {
+            template<typename F>
+            static void run(State<Unit>& state, F& compute) { compute(); state.set(Unit()); }
+        };
+    }
+
+    /// <summary>
+    /// The result of an asynchronous operation. Copies share the result.
+    /// </summary>
+    template<typename T>
+    class Future
+    {
+    public:
+        typedef typename detail::Stored<T>::type stored_type;
+        typedef detail::State<stored_type> state_type;
+
+        Future() {}
+
+        Future(std::shared_ptr<state_type> state, cl::Event event = cl::Event())
+            : state_(state), event_(event) {}
+
+        /// <summary>
+        /// False for a default constructed future.
+        /// </summary>
+        bool valid() const { return state_ != nullptr; }
+
+        /// <summary>
+        /// True once the result (or an error) is there, does not block.
+        /// </summary>
+        bool ready() const { return state_->done(); }
+
+        /// <summary>
+        /// Blocks until the result is there.
+        /// </summary>
+        void wait() const { state_->wait(); }
+
+        /// <summary>
+        /// Blocks until the result is there and returns it, a failed command
+        /// or continuation rethrows its error (cl::Error for commands).
+        /// </summary>
+        typename detail::Stored<T>::result get() const { return detail::Stored<T>::get(state_->value()); }
+
+        /// <summary>
+        /// The event of the command, for wait lists of further commands.
+        /// Null for continuations.
+        /// </summary>
+        const cl::Event& event() const { return event_; }
+
+        /// <summary>
+        /// The shared state, for combinators like whenAll().
+        /// </summary>
+        const std::shared_ptr<state_type>& state() const { return state_; }
+
+        /// <summary>
+        /// A future of f applied to the result, f takes the result (nothing
+        /// for Future&lt;void&gt;) and runs on the worker thread. An error
+        /// of this future skips f and is passed on.
+        /// </summary>
+        template<typename F>
+        auto then(F f) const -> Future<decltype(detail::Stored<T>::apply(f, std::declval<const stored_type&>()))>
+        {
+            typedef decltype(detail::Stored<T>::apply(f, std::declval<const stored_type&>())) R;
+            typedef typename Future<R>::state_type next_type;
+
+            std::shared_ptr<state_type> state = state_;
+            std::shared_ptr<next_type> next = std::make_shared<next_type>();
+
+            state->onReady([state, next, f]() mutable {
+                try {
+                    auto compute = [&]() { return detail::Stored<T>::apply(f, state->value()); };
+                    detail::Complete<R>::run(*next, compute);
+                }
+                catch (...) {
+                    next->fail(std::current_exception());
+                }
+            });
+
+            return Future<R>(next);
+        }
+
+    private:
+        std::shared_ptr<state_type> state_;
+        cl::Event event_;
+    };
+
+    /// <summary>
+    /// A future completed with the command of the event.
+    /// </summary>
+    Future<void> whenComplete(const cl::Event& event);
+
+    /// <summary>
+    /// Enqueues the kernel and flushes the queue.
+    /// </summary>
+    Future<void> launchAsync(cl::CommandQueue& queue, const cl::Kernel& kernel, const cl::NDRange& global,
+        const cl::NDRange& local = cl::NullRange, const std::vector<cl::Event>* wait = nullptr);
+
+    /// <summary>
+    /// Writes the data to the buffer, the future keeps the data alive until
+    /// the write completed.
+    /// </summary>
+    template<typename T>
+    Future<void> writeAsync(cl::CommandQueue& queue, const cl::Buffer& buffer, std::vector<T> data,
+        ::size_t offset = 0, const std::vector<cl::Event>* wait = nullptr)
+    {
+        std::shared_ptr<std::vector<T>> host = std::make_shared<std::vector<T>>(std::move(data));
+        std::shared_ptr<detail::State<detail::Unit>> state = std::make_shared<detail::State<detail::Unit>>();
+
+        cl::Event event;
+        queue.enqueueWriteBuffer(buffer, CL_FALSE, sizeof(T) * offset, sizeof(T) * host->size(), host->data(), wait, &event);
+        queue.flush();
+
+        detail::onComplete(event, [host, state](cl_int status) {
+            if (status < 0)
+                state->fail(std::make_exception_ptr(cl::Error(status, "writeAsync")));
+            else
+                state->set(detail::Unit());
+        });
+
+        return Future<void>(state, event);
+    }
+
+    /// <summary>
+    /// Reads count elements of the buffer, starting at element offset.
+    /// </summary>
+    template<typename T>
+    Future<std::vector<T>> readAsync(cl::CommandQueue& queue, const cl::Buffer& buffer, ::size_t count,
+        ::size_t offset = 0, const std::vector<cl::Event>* wait = nullptr)
+    {
+        std::shared_ptr<std::vector<T>> host = std::make_shared<std::vector<T>>(count);
+        std::shared_ptr<detail::State<std::vector<T>>> state = std::make_shared<detail::State<std::vector<T>>>();
+
+        cl::Event event;
+        queue.enqueueReadBuffer(buffer, CL_FALSE, sizeof(T) * offset, sizeof(T) * count, host->data(), wait, &event);
+        queue.flush();
+
+        detail::onComplete(event, [host, state](cl_int status) {
+            if (status < 0)
+                state->fail(std::make_exception_ptr(cl::Error(status, "readAsync")));
+            else
+                state->set(std::move(*host));
+        });
+
+        return Future<std::vector<T>>(state, event);
+    }
+
+    /// <summary>
+    /// A future of all results, in the order of the futures. The first
+    /// error of any of them is passed on.
+    /// </summary>
+    template<typename T>
+    Future<std::vector<T>> whenAll(const std::vector<Future<T>>& futures)
+    {
+        struct Gather
+        {
+            std::mutex mutex;
+            ::size_t remaining;
+            std::vector<T> values;
+            std::exception_ptr error;
+        };
+
+        std::shared_ptr<detail::State<std::vector<T>>> state = std::make_shared<detail::State<std::vector<T>>>();
+        std::shared_ptr<Gather> gather = std::make_shared<Gather>();
+        gather->remaining = futures.size();
+        gather->values.resize(futures.size());
+
+        if (futures.empty())
+            state->set(std::vector<T>());
+
+        for (::size_t i = 0; i < futures.size(); i++) {
+            std::shared_ptr<typename Future<T>::state_type> source = futures[i].state();
+
+            source->onReady([source, gather, state, i]() {
+                std::exception_ptr error = source->error();
+                bool last;
+                {
+                    std::lock_guard<std::mutex> lock(gather->mutex);
+                    if (error && !gather->error)
+                        gather->error = error;
+                    else if (!error)
+                        gather->values[i] = source->value();
+                    last = --gather->remaining == 0;
+                }
+
+                if (last && gather->error)
+                    state->fail(gather->error);
+                else if (last)
+                    state->set(std::move(gather->values));
+            });
+        }
+
+        return Future<std::vector<T>>(state);
+    }
+
+    /// <summary>
+    /// A future completed once all futures are, the first error is passed on.
+    /// </summary>
+    Future<void> whenAll(const std::vector<Future<void>>& futures);
+}
\ No newline at end of file
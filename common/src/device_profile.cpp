@@ -0,0 +1,305 @@
+//------------------------------------------------------------------------------
+//
+//  Device profiles
+//
+//------------------------------------------------------------------------------
+
+#include "device_profile.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace ocl {
+
+    namespace {
+
+        /// <summary>
+        /// The text as a JSON string.
+        /// </summary>
+        std::string quoted(const std::string& text)
+        {
+            std::string out = "\"";
+            for (::size_t i = 0; i < text.size(); i++) {
+                if (text[i] == '"' || text[i] == '\\')
+                    out += '\\';
+                out += text[i];
+            }
+            return out + "\"";
+        }
+
+        /// <summary>
+        /// Just enough JSON for the profile: an object with a "devices" array
+        /// of flat objects holding strings, numbers and nulls.
+        /// </summary>
+        class Parser
+        {
+        public:
+            explicit Parser(const std::string& text) : text_(text), pos_(0) {}
+
+            typedef ProfileValue Value;
+            typedef ProfileEntry Object;
+
+            bool parse(std::vector<Object>& devices)
+            {
+                if (!consume('{'))
+                    return false;
+
+                while (!peek('}')) {
+                    std::string key;
+                    if (!string(key) || !consume(':'))
+                        return false;
+
+                    if (key == "devices") {
+                        if (!array(devices))
+                            return false;
+                    }
+                    else {
+                        Value ignored;
+                        if (!value(ignored))
+                            return false;
+                    }
+
+                    if (!consume(','))
+                        break;
+                }
+
+                return consume('}');
+            }
+
+        private:
+            void skipSpace()
+            {
+                while (pos_ < text_.size() && std::isspace((unsigned char)text_[pos_]))
+                    pos_++;
+            }
+
+            bool peek(char c)
+            {
+                skipSpace();
+                return pos_ < text_.size() && text_[pos_] == c;
+            }
+
+            bool consume(char c)
+            {
+                if (!peek(c))
+                    return false;
+                pos_++;
+                return true;
+            }
+
+            bool string(std::string& out)
+            {
+                if (!consume('"'))
+                    return false;
+
+                out.clear();
+                while (pos_ < text_.size() && text_[pos_] != '"') {
+                    char c = text_[pos_++];
+                    if (c == '\\' && pos_ < text_.size()) {
+                        char e = text_[pos_++];
+                        if (e == 'u') {
+                            // only control characters are escaped this way
+                            out += (char)std::strtol(text_.substr(pos_, 4).c_str(), nullptr, 16);
+                            pos_ += 4;
+                        }
+                        else {
+                            out += e == 'n' ? '\n' : e == 't' ? '\t' : e;
+                        }
+                    }
+                    else {
+                        out += c;
+                    }
+                }
+
+                return consume('"');
+            }
+
+            // a scalar value (string, number, literal) as text
+            bool value(Value& out)
+            {
+                skipSpace();
+                out.quoted = peek('"');
+                if (out.quoted)
+                    return string(out.text);
+
+                ::size_t start = pos_;
+                while (pos_ < text_.size() && text_[pos_] != ',' && text_[pos_] != '}' && text_[pos_] != ']'
+                       && !std::isspace((unsigned char)text_[pos_]))
+                    pos_++;
+
+                out.text = text_.substr(start, pos_ - start);
+                return !out.text.empty();
+            }
+
+            bool object(Object& out)
+            {
+                if (!consume('{'))
+                    return false;
+
+                while (!peek('}')) {
+                    std::string key;
+                    Value text;
+                    if (!string(key) || !consume(':') || !value(text))
+                        return false;
+
+                    out.push_back(std::make_pair(key, text));
+
+                    if (!consume(','))
+                        break;
+                }
+
+                return consume('}');
+            }
+
+            bool array(std::vector<Object>& out)
+            {
+                if (!consume('['))
+                    return false;
+
+                while (!peek(']')) {
+                    out.push_back(Object());
+                    if (!object(out.back()))
+                        return false;
+
+                    if (!consume(','))
+                        break;
+                }
+
+                return consume(']');
+            }
+
+            const std::string& text_;
+            ::size_t pos_;
+        };
+    }
+
+    std::string DeviceProfile::defaultPath()
+    {
+        const char* path = getenv("OCL_DEVICE_PROFILE");
+        return path != nullptr ? path : "device_profile.json";
+    }
+
+    bool DeviceProfile::readEntries(const std::string& path, std::vector<ProfileEntry>& entries)
+    {
+        std::ifstream file(path.c_str());
+        if (!file.is_open())
+            return false;
+
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        entries.clear();
+        return Parser(text).parse(entries);
+    }
+
+    bool DeviceProfile::writeEntries(const std::string& path, const std::vector<ProfileEntry>& entries)
+    {
+        std::ofstream file(path.c_str());
+        if (!file.is_open())
+            return false;
+
+        file << "{\n  \"devices\": [";
+
+        for (::size_t d = 0; d < entries.size(); d++) {
+            file << (d > 0 ? ",\n    {" : "\n    {");
+
+            for (::size_t i = 0; i < entries[d].size(); i++) {
+                const ProfileValue& value = entries[d][i].second;
+
+                file << (i > 0 ? ",\n      " : "\n      ") << quoted(entries[d][i].first) << ": ";
+                file << (value.quoted ? quoted(value.text) : value.text);
+            }
+
+            file << "\n    }";
+        }
+
+        file << "\n  ]\n}\n";
+        return file.good();
+    }
+
+    const ProfileValue* DeviceProfile::find(const ProfileEntry& entry, const std::string& key)
+    {
+        for (::size_t i = 0; i < entry.size(); i++) {
+            if (entry[i].first == key)
+                return &entry[i].second;
+        }
+        return nullptr;
+    }
+
+    void DeviceProfile::set(ProfileEntry& entry, const std::string& key, const ProfileValue& value)
+    {
+        for (::size_t i = 0; i < entry.size(); i++) {
+            if (entry[i].first == key) {
+                entry[i].second = value;
+                return;
+            }
+        }
+        entry.push_back(std::make_pair(key, value));
+    }
+
+    void DeviceProfile::assign(const ProfileEntry& entry)
+    {
+        numbers_.clear();
+        strings_.clear();
+
+        // by token: strings stay text even if they look like numbers ("driver": "1.2")
+        for (ProfileEntry::const_iterator it = entry.begin(); it != entry.end(); ++it) {
+            const std::string& text = it->second.text;
+            char* end = nullptr;
+            double number = std::strtod(text.c_str(), &end);
+
+            if (!it->second.quoted && *end == '\0')
+                numbers_[it->first] = number;
+            else
+                strings_[it->first] = text;
+        }
+    }
+
+    bool DeviceProfile::load(const std::string& path, const cl::Device& device)
+    {
+        std::vector<ProfileEntry> devices;
+        if (!readEntries(path, devices))
+            return false;
+
+        std::string name = device.getInfo<CL_DEVICE_NAME>();
+        std::string driver = device.getInfo<CL_DRIVER_VERSION>();
+
+        for (::size_t d = 0; d < devices.size(); d++) {
+            const ProfileValue* entry_name = find(devices[d], "name");
+            const ProfileValue* entry_driver = find(devices[d], "driver");
+
+            if (entry_name != nullptr && entry_name->text == name && entry_driver != nullptr && entry_driver->text == driver) {
+                assign(devices[d]);
+                return true;
+            }
+        }
+
+        // no entry of the device itself: an entry of its platform without a name
+        std::string platform = cl::Platform(device.getInfo<CL_DEVICE_PLATFORM>()).getInfo<CL_PLATFORM_NAME>();
+
+        for (::size_t d = 0; d < devices.size(); d++) {
+            const ProfileValue* entry_platform = find(devices[d], "platform");
+
+            if (find(devices[d], "name") == nullptr && entry_platform != nullptr && entry_platform->text == platform) {
+                assign(devices[d]);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    double DeviceProfile::value(const std::string& key, double fallback) const
+    {
+        std::map<std::string, double>::const_iterator it = numbers_.find(key);
+        return it != numbers_.end() ? it->second : fallback;
+    }
+
+    std::string DeviceProfile::text(const std::string& key) const
+    {
+        std::map<std::string, std::string>::const_iterator it = strings_.find(key);
+        return it != strings_.end() ? it->second : std::string();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+//
+//  Device profiles
+//
+//  Reads the JSON profile written by PlatformInformation (one flat object
+//  per device with the measured bandwidths, FLOP rates and latencies), so
+//  benchmarks can relate their results to what the device achieves.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ocl {
+
+    /// <summary>
+    /// A value of a profile file as written, strings unquoted.
+    /// </summary>
+    struct ProfileValue
+    {
+        std::string text;
+        bool quoted;            // a JSON string, also if it looks like a number
+    };
+
+    /// <summary>
+    /// The values of one device of a profile file, in file order.
+    /// </summary>
+    typedef std::vector<std::pair<std::string, ProfileValue>> ProfileEntry;
+
+    class DeviceProfile
+    {
+    public:
+        /// <summary>
+        /// The profile file: OCL_DEVICE_PROFILE, or device_profile.json in
+        /// the working directory.
+        /// </summary>
+        static std::string defaultPath();
+
+        /// <summary>
+        /// Loads the profile of the device (same name and driver) from the file,
+        /// else the entry of its platform (same "platform", no "name"), which
+        /// covers every device of a runtime like PoCL.
+        /// </summary>
+        /// <returns>False if the file cannot be read or has no such device</returns>
+        bool load(const std::string& path, const cl::Device& device);
+
+        /// <summary>
+        /// A measured value, fallback if it is missing or was not measured.
+        /// </summary>
+        double value(const std::string& key, double fallback = -1.0) const;
+
+        /// <summary>
+        /// A text value, empty if it is missing.
+        /// </summary>
+        std::string text(const std::string& key) const;
+
+        /// <summary>
+        /// All device entries of a profile file.
+        /// </summary>
+        /// <returns>False if the file cannot be read or is no profile</returns>
+        static bool readEntries(const std::string& path, std::vector<ProfileEntry>& entries);
+
+        /// <summary>
+        /// Writes the device entries as a profile file.
+        /// </summary>
+        /// <returns>False if the file cannot be written</returns>
+        static bool writeEntries(const std::string& path, const std::vector<ProfileEntry>& entries);
+
+        /// <summary>
+        /// The value of a key in an entry, nullptr if it is missing.
+        /// </summary>
+        static const ProfileValue* find(const ProfileEntry& entry, const std::string& key);
+
+        /// <summary>
+        /// Replaces the value of a key in an entry, appends it if it is missing.
+        /// </summary>
+        static void set(ProfileEntry& entry, const std::string& key, const ProfileValue& value);
+
+    private:
+        void assign(const ProfileEntry& entry);
+
+        std::map<std::string, double> numbers_;
+        std::map<std::string, std::string> strings_;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,417 @@
+//------------------------------------------------------------------------------
+//
+//  Device selection
+//
+//------------------------------------------------------------------------------
+
+#include "device_selector.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace ocl {
+
+    namespace {
+
+        // the probe kernels: independent FMA chains and a float4 copy
+        const char* PROBE_SOURCE =
+            "__kernel void probe_fma(__global float* out, const float a, const float b)\n"
+            "{\n"
+            "\tfloat x0 = get_global_id(0) * 1.0e-9f, x1 = x0 + 1.0f, x2 = x0 + 2.0f, x3 = x0 + 3.0f;\n"
+            "\tfor (int i = 0; i < 256; i++) {\n"
+            "\t\tx0 = fma(x0, a, b); x1 = fma(x1, a, b); x2 = fma(x2, a, b); x3 = fma(x3, a, b);\n"
+            "\t}\n"
+            "\tout[get_global_id(0)] = x0 + x1 + x2 + x3;\n"
+            "}\n"
+            "__kernel void probe_copy(__global const float4* in, __global float4* out)\n"
+            "{\n"
+            "\tout[get_global_id(0)] = in[get_global_id(0)];\n"
+            "}\n";
+
+        const int PROBE_FLOPS_PER_ITEM = 4 * 256 * 2;  // chains * iterations * (mul + add)
+        const int PROBE_RUNS = 3;                       // best of
+
+        std::string lower(std::string s)
+        {
+            std::transform(s.begin(), s.end(), s.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+            return s;
+        }
+
+        bool is_index(const std::string& s)
+        {
+            return !s.empty() && s.find_first_not_of("0123456789") == std::string::npos;
+        }
+
+        /// <summary>
+        /// 64 bit FNV-1a, stable across runs and compilers.
+        /// </summary>
+        std::string fnv1a(const std::string& s)
+        {
+            unsigned long long h = 14695981039346656037ull;
+            for (::size_t i = 0; i < s.size(); i++) {
+                h ^= (unsigned char)s[i];
+                h *= 1099511628211ull;
+            }
+
+            std::ostringstream out;
+            out << std::hex << h;
+            return out.str();
+        }
+
+        std::string host_name()
+        {
+#ifdef _WIN32
+            const char* name = getenv("COMPUTERNAME");
+            return name != nullptr ? name : "host";
+#else
+            char name[256] = { 0 };
+            if (gethostname(name, sizeof(name) - 1) != 0)
+                return "host";
+            return name;
+#endif
+        }
+
+        /// <summary>
+        /// Best time of the kernel in seconds.
+        /// </summary>
+        double time_kernel(cl::CommandQueue& queue, cl::Kernel& kernel, ::size_t global)
+        {
+            // warm up
+            queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(global), cl::NullRange);
+            queue.finish();
+
+            double best = 1.0e30;
+            for (int r = 0; r < PROBE_RUNS; r++) {
+                auto start = std::chrono::high_resolution_clock::now();
+
+                queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(global), cl::NullRange);
+                queue.finish();
+
+                auto stop = std::chrono::high_resolution_clock::now();
+                best = std::min(best, std::chrono::duration<double>(stop - start).count());
+            }
+
+            return best;
+        }
+    }
+
+    DeviceSelector::DeviceSelector()
+        : benchmark_(false), list_(false), type_(CL_DEVICE_TYPE_ALL)
+    {
+        readEnvironment();
+    }
+
+    DeviceSelector::DeviceSelector(int& argc, char* argv[])
+        : benchmark_(false), list_(false), type_(CL_DEVICE_TYPE_ALL)
+    {
+        readEnvironment();
+
+        // the command line wins over the environment
+        int kept = 1;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+
+            if (arg.compare(0, 9, "--device=") == 0)
+                override_ = arg.substr(9);
+            else if (arg == "--device-benchmark")
+                benchmark_ = true;
+            else if (arg == "--device-list")
+                list_ = true;
+            else
+                argv[kept++] = argv[i];
+        }
+
+        argc = kept;
+        argv[argc] = nullptr;
+    }
+
+    void DeviceSelector::readEnvironment()
+    {
+        const char* device = getenv("OCL_DEVICE");
+        if (device != nullptr)
+            override_ = device;
+
+        const char* benchmark = getenv("OCL_DEVICE_BENCHMARK");
+        if (benchmark != nullptr)
+            benchmark_ = std::strcmp(benchmark, "0") != 0 && benchmark[0] != '\0';
+    }
+
+    DeviceSelector& DeviceSelector::type(cl_device_type type)
+    {
+        type_ = type;
+        return *this;
+    }
+
+    DeviceSelector& DeviceSelector::requireExtension(const std::string& extension)
+    {
+        extensions_.push_back(extension);
+        return *this;
+    }
+
+    DeviceSelector& DeviceSelector::benchmark(bool enable)
+    {
+        benchmark_ = enable;
+        return *this;
+    }
+
+    bool DeviceSelector::suitable(const cl::Device& device) const
+    {
+        if ((device.getInfo<CL_DEVICE_TYPE>() & type_) == 0)
+            return false;
+
+        if (!device.getInfo<CL_DEVICE_AVAILABLE>() || !device.getInfo<CL_DEVICE_COMPILER_AVAILABLE>())
+            return false;
+
+        // extensions are a space separated list
+        std::string extensions = " " + device.getInfo<CL_DEVICE_EXTENSIONS>() + " ";
+        for (::size_t e = 0; e < extensions_.size(); e++) {
+            if (extensions.find(" " + extensions_[e] + " ") == std::string::npos)
+                return false;
+        }
+
+        return true;
+    }
+
+    double DeviceSelector::capabilityScore(const cl::Device& device)
+    {
+        double units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+        double clock = device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+        cl_device_type type = device.getInfo<CL_DEVICE_TYPE>();
+
+        // some drivers report no clock
+        if (clock <= 0.0)
+            clock = 1000.0;
+
+        // lanes per compute unit: a CPU core has its SIMD width, a GPU compute
+        // unit runs (at least) a warp or wavefront worth of lanes
+        double lanes = std::max<cl_uint>(device.getInfo<CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT>(), 1);
+        if (type & CL_DEVICE_TYPE_GPU)
+            lanes = std::max(lanes, 32.0);
+        else if (type & CL_DEVICE_TYPE_ACCELERATOR)
+            lanes = std::max(lanes, 16.0);
+
+        // peak GFLOP/s with one FMA per lane and cycle
+        double score = units * clock * lanes * 2.0 / 1000.0;
+
+        // more memory fits larger problems, fp64 widens what runs at all
+        double memory_gb = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / (1024.0 * 1024.0 * 1024.0);
+        score *= 1.0 + 0.1 * std::log2(1.0 + memory_gb);
+
+        if (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos)
+            score *= 1.05;
+
+        return score;
+    }
+
+    bool DeviceSelector::probe(const cl::Device& device, double& gflops, double& gbs)
+    {
+        try {
+            Runtime& runtime = Runtime::instance();
+            cl::Context& context = runtime.context(device);
+            cl::CommandQueue& queue = runtime.queue(device);
+            cl::Program& program = runtime.programFromSource(device, PROBE_SOURCE);
+
+            // FMA throughput, enough work-items to fill every compute unit
+            ::size_t fma_items = std::max<::size_t>(device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * 4096, 1 << 16);
+            cl::Buffer fma_out(context, CL_MEM_WRITE_ONLY, sizeof(float) * fma_items);
+
+            cl::Kernel fma(program, "probe_fma");
+            fma.setArg(0, fma_out);
+            fma.setArg(1, 0.999f);
+            fma.setArg(2, 0.001f);
+            gflops = (double)PROBE_FLOPS_PER_ITEM * fma_items / time_kernel(queue, fma, fma_items) / 1.0e9;
+
+            // copy bandwidth, up to 64 MB per buffer
+            cl_ulong bytes = std::min<cl_ulong>(64 << 20, device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / 2);
+            bytes -= bytes % (4 * sizeof(float));
+            cl::Buffer in(context, CL_MEM_READ_ONLY, bytes);
+            cl::Buffer out(context, CL_MEM_WRITE_ONLY, bytes);
+
+            cl::Kernel copy(program, "probe_copy");
+            copy.setArg(0, in);
+            copy.setArg(1, out);
+            gbs = 2.0 * bytes / time_kernel(queue, copy, bytes / (4 * sizeof(float))) / 1.0e9;
+
+            return true;
+        }
+        catch (cl::Error err) {
+            std::cout << "Device probe failed on " << device.getInfo<CL_DEVICE_NAME>() << ": " << err.what() << std::endl;
+            return false;
+        }
+    }
+
+    double DeviceSelector::benchmarkScore(const cl::Device& device)
+    {
+        double gflops, gbs;
+        if (!probe(device, gflops, gbs))
+            return 0.0;
+
+        return std::sqrt(gflops * gbs);
+    }
+
+    std::vector<DeviceRank> DeviceSelector::rank()
+    {
+        const std::vector<cl::Device>& devices = Runtime::instance().devices();
+
+        std::vector<DeviceRank> ranks;
+        for (unsigned i = 0; i < devices.size(); i++) {
+            if (!suitable(devices[i]))
+                continue;
+
+            DeviceRank rank;
+            rank.device = devices[i];
+            rank.index = i;
+            rank.score = benchmark_ ? benchmarkScore(devices[i]) : capabilityScore(devices[i]);
+            ranks.push_back(rank);
+        }
+
+        std::stable_sort(ranks.begin(), ranks.end(), [](const DeviceRank& a, const DeviceRank& b) {
+            return a.score > b.score;
+        });
+
+        if (list_) {
+            std::cout << "\nDevices by " << (benchmark_ ? "measured" : "estimated") << " score:" << std::endl;
+            for (::size_t r = 0; r < ranks.size(); r++)
+                std::cout << "  [" << ranks[r].index << "] " << ranks[r].device.getInfo<CL_DEVICE_NAME>()
+                          << "  " << ranks[r].score << std::endl;
+        }
+
+        return ranks;
+    }
+
+    cl::Device DeviceSelector::select()
+    {
+        const std::vector<cl::Device>& devices = Runtime::instance().devices();
+
+        if (devices.empty())
+            throw cl::Error(CL_DEVICE_NOT_FOUND, "ocl::DeviceSelector no OpenCL device");
+
+        // explicit choices
+        if (!override_.empty()) {
+            std::string choice = lower(override_);
+
+            if (is_index(choice)) {
+                unsigned index = (unsigned)std::strtoul(choice.c_str(), nullptr, 10);
+                if (index >= devices.size())
+                    throw cl::Error(CL_DEVICE_NOT_FOUND, "ocl::DeviceSelector invalid device index");
+                return devices[index];
+            }
+
+            if (choice == "cpu" || choice == "gpu" || choice == "accelerator") {
+                type_ = choice == "cpu" ? CL_DEVICE_TYPE_CPU : choice == "gpu" ? CL_DEVICE_TYPE_GPU : CL_DEVICE_TYPE_ACCELERATOR;
+            }
+            else {
+                for (::size_t i = 0; i < devices.size(); i++) {
+                    if (lower(devices[i].getInfo<CL_DEVICE_NAME>()).find(choice) != std::string::npos)
+                        return devices[i];
+                }
+                throw cl::Error(CL_DEVICE_NOT_FOUND, "ocl::DeviceSelector no device matches the name");
+            }
+        }
+
+        // the choice of an earlier run on the same devices
+        std::string key = cacheKey(devices);
+        unsigned index;
+
+        if (!list_ && readCache(key, index) && index < devices.size() && suitable(devices[index]))
+            return devices[index];
+
+        std::vector<DeviceRank> ranks = rank();
+        if (ranks.empty())
+            throw cl::Error(CL_DEVICE_NOT_FOUND, "ocl::DeviceSelector no suitable device");
+
+        writeCache(key, ranks[0].index);
+
+        return ranks[0].device;
+    }
+
+    std::string DeviceSelector::cacheKey(const std::vector<cl::Device>& devices) const
+    {
+        // the devices, their drivers and what is asked for
+        std::ostringstream key;
+        for (::size_t i = 0; i < devices.size(); i++)
+            key << devices[i].getInfo<CL_DEVICE_NAME>() << "|" << devices[i].getInfo<CL_DRIVER_VERSION>() << "\n";
+        key << type_ << (benchmark_ ? " benchmark" : " capabilities");
+        for (::size_t e = 0; e < extensions_.size(); e++)
+            key << " " << extensions_[e];
+
+        return fnv1a(key.str());
+    }
+
+    std::string DeviceSelector::cachePath() const
+    {
+        const char* path = getenv("OCL_DEVICE_CACHE");
+        if (path != nullptr)
+            return path;
+
+        // the home directory may be shared between hosts
+#ifdef _WIN32
+        const char* dir = getenv("LOCALAPPDATA");
+        const char* separator = "\\";
+#else
+        const char* dir = getenv("HOME");
+        const char* separator = "/.";
+#endif
+        if (dir == nullptr)
+            return "";
+
+        return std::string(dir) + separator + "opencl_device_" + host_name();
+    }
+
+    bool DeviceSelector::readCache(const std::string& key, unsigned& index) const
+    {
+        std::string path = cachePath();
+        if (path.empty())
+            return false;
+
+        std::ifstream file(path.c_str());
+        std::string line_key;
+        unsigned line_index;
+
+        while (file >> line_key >> line_index) {
+            if (line_key == key) {
+                index = line_index;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void DeviceSelector::writeCache(const std::string& key, unsigned index) const
+    {
+        std::string path = cachePath();
+        if (path.empty())
+            return;
+
+        // keep the entries of other configurations
+        std::vector<std::pair<std::string, unsigned> > entries;
+        {
+            std::ifstream file(path.c_str());
+            std::string line_key;
+            unsigned line_index;
+
+            while (file >> line_key >> line_index) {
+                if (line_key != key)
+                    entries.push_back(std::make_pair(line_key, line_index));
+            }
+        }
+        entries.push_back(std::make_pair(key, index));
+
+        // a cache that cannot be written only costs the ranking next time
+        std::ofstream file(path.c_str());
+        for (::size_t e = 0; e < entries.size(); e++)
+            file << entries[e].first << " " << entries[e].second << "\n";
+    }
+}
\ No newline at end of file
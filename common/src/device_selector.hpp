@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+//
+//  Device selection
+//
+//  Ranks the suitable devices of all platforms and picks the best one.
+//  The rank is estimated from the queried capabilities (compute units,
+//  clock, SIMD width, memory, extensions) or, on request, measured by a
+//  short probe (FMA throughput and copy bandwidth). The choice is cached per
+//  host and device configuration, so only the first run pays for probing.
+//
+//  Overrides, in order of precedence:
+//      --device=<index|cpu|gpu|accelerator|name>   command line
+//      OCL_DEVICE=<index|cpu|gpu|accelerator|name> environment
+//  Further options: --device-benchmark (OCL_DEVICE_BENCHMARK=1) ranks by
+//  the probe, --device-list prints the ranking. OCL_DEVICE_CACHE sets the
+//  cache file, an empty value disables the cache.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ocl {
+
+    /// <summary>
+    /// A device and its score, higher is faster.
+    /// </summary>
+    struct DeviceRank
+    {
+        cl::Device device;
+        unsigned index;         // index in Runtime::devices()
+        double score;
+    };
+
+    class DeviceSelector
+    {
+    public:
+        /// <summary>
+        /// A selector configured by the environment only.
+        /// </summary>
+        DeviceSelector();
+
+        /// <summary>
+        /// A selector configured by the environment and the command line.
+        /// The --device options are removed from argv, so the program only
+        /// sees its own arguments.
+        /// </summary>
+        DeviceSelector(int& argc, char* argv[]);
+
+        /// <summary>
+        /// Only consider devices of the type (CL_DEVICE_TYPE_ALL by default).
+        /// </summary>
+        DeviceSelector& type(cl_device_type type);
+
+        /// <summary>
+        /// Only consider devices with the extension.
+        /// </summary>
+        DeviceSelector& requireExtension(const std::string& extension);
+
+        /// <summary>
+        /// Rank by the probe instead of the capabilities.
+        /// </summary>
+        DeviceSelector& benchmark(bool enable);
+
+        /// <summary>
+        /// The chosen device. Throws cl::Error(CL_DEVICE_NOT_FOUND) if there
+        /// is no suitable device or the override matches none.
+        /// </summary>
+        cl::Device select();
+
+        /// <summary>
+        /// The suitable devices, best first.
+        /// </summary>
+        std::vector<DeviceRank> rank();
+
+        /// <summary>
+        /// Estimated peak GFLOP/s from the queried capabilities, weighted by memory and extensions.
+        /// </summary>
+        static double capabilityScore(const cl::Device& device);
+
+        /// <summary>
+        /// Geometric mean of the measured GFLOP/s (FMA) and GB/s (copy), 0 if the probe fails.
+        /// </summary>
+        static double benchmarkScore(const cl::Device& device);
+
+        /// <summary>
+        /// Measures the FMA throughput (GFLOP/s) and copy bandwidth (GB/s)
+        /// of the device with the probe kernels.
+        /// </summary>
+        /// <returns>False if the probe fails</returns>
+        static bool probe(const cl::Device& device, double& gflops, double& gbs);
+
+    private:
+        void readEnvironment();
+        bool suitable(const cl::Device& device) const;
+        std::string cacheKey(const std::vector<cl::Device>& devices) const;
+        std::string cachePath() const;
+        bool readCache(const std::string& key, unsigned& index) const;
+        void writeCache(const std::string& key, unsigned index) const;
+
+        std::string override_;                  // --device or OCL_DEVICE
+        bool benchmark_;
+        bool list_;
+        cl_device_type type_;
+        std::vector<std::string> extensions_;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+//------------------------------------------------------------------------------
+//
+//  Embedded kernels
+//
+//------------------------------------------------------------------------------
+
+#include "embedded.hpp"
+
+#include <mutex>
+
+namespace ocl {
+
+    namespace {
+
+        // created on first use, the registrations run during static initialization
+        std::vector<EmbeddedKernel>& registry()
+        {
+            static std::vector<EmbeddedKernel> kernels;
+            return kernels;
+        }
+
+        std::mutex& registryMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+    }
+
+    void embedKernel(const char* name, const char* source, ::size_t source_size, const unsigned char* il, ::size_t il_size)
+    {
+        EmbeddedKernel kernel;
+        kernel.name = name;
+        kernel.source.assign(source, source_size);
+        if (il != nullptr)
+            kernel.il.assign(il, il + il_size);
+
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(kernel);
+    }
+
+    const EmbeddedKernel* embeddedKernel(const std::string& path)
+    {
+        // both separators, the path may come from Windows
+        std::string normalized = path;
+        for (::size_t i = 0; i < normalized.size(); i++) {
+            if (normalized[i] == '\\')
+                normalized[i] = '/';
+        }
+
+        std::lock_guard<std::mutex> lock(registryMutex());
+        const std::vector<EmbeddedKernel>& kernels = registry();
+
+        for (::size_t k = 0; k < kernels.size(); k++) {
+            const std::string& name = kernels[k].name;
+
+            if (normalized == name)
+                return &kernels[k];
+
+            if (normalized.size() > name.size()
+                && normalized[normalized.size() - name.size() - 1] == '/'
+                && normalized.compare(normalized.size() - name.size(), name.size(), name) == 0)
+                return &kernels[k];
+        }
+
+        return nullptr;
+    }
+}
@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------------
+//
+//  Embedded kernels
+//
+//  Kernel sources (and SPIR-V modules, if they were compiled offline)
+//  built into the executable by embed_kernels() in CMake, see
+//  common/cmake/EmbedKernels.cmake. Runtime::program() takes a kernel
+//  file from here if it was embedded and reads it from disk otherwise.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ocl {
+
+    /// <summary>
+    /// An embedded kernel file.
+    /// </summary>
+    struct EmbeddedKernel
+    {
+        std::string name;                   // path relative to the project, e.g. kernel/matMul.cl
+        std::string source;                 // OpenCL C source
+        std::vector<unsigned char> il;      // SPIR-V module, empty if not compiled offline
+    };
+
+    /// <summary>
+    /// Registers an embedded kernel file, called by the generated code.
+    /// </summary>
+    void embedKernel(const char* name, const char* source, ::size_t source_size, const unsigned char* il, ::size_t il_size);
+
+    /// <summary>
+    /// The embedded kernel of a file path: the name of the kernel is the
+    /// path or its end, so FileSystem::getPath("kernel/matMul.cl") finds
+    /// kernel/matMul.cl.
+    /// </summary>
+    /// <returns>nullptr if the file was not embedded</returns>
+    const EmbeddedKernel* embeddedKernel(const std::string& path);
+}
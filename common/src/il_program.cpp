@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+//
+//  SPIR-V programs
+//
+//------------------------------------------------------------------------------
+
+#include "il_program.hpp"
+#include "embedded.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+// the query is the same for OpenCL 2.1 and cl_khr_il_program
+#ifndef CL_DEVICE_IL_VERSION_KHR
+#define CL_DEVICE_IL_VERSION_KHR 0x105B
+#endif
+
+namespace ocl {
+
+    namespace {
+
+        typedef cl_program (CL_API_CALL *CreateProgramWithIL)(cl_context, const void*, ::size_t, cl_int*);
+
+        // the entry point taking SPIR-V for the device, nullptr if there is none
+        CreateProgramWithIL entryPoint(const cl::Device& device)
+        {
+#ifdef CL_VERSION_2_1
+            int major = 0, minor = 0;
+            std::string version = device.getInfo<CL_DEVICE_VERSION>();
+            if (sscanf(version.c_str(), "OpenCL %d.%d", &major, &minor) == 2 && (major > 2 || (major == 2 && minor >= 1)))
+                return &clCreateProgramWithIL;
+#endif
+
+            std::string extensions = device.getInfo<CL_DEVICE_EXTENSIONS>();
+            if (extensions.find("cl_khr_il_program") == std::string::npos)
+                return nullptr;
+
+            cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>();
+            return (CreateProgramWithIL)clGetExtensionFunctionAddressForPlatform(platform, "clCreateProgramWithILKHR");
+        }
+
+        double milliseconds(std::chrono::high_resolution_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+    }
+
+    bool supportsIL(const cl::Device& device)
+    {
+        ::size_t size = 0;
+        if (clGetDeviceInfo(device(), CL_DEVICE_IL_VERSION_KHR, 0, nullptr, &size) != CL_SUCCESS || size <= 1)
+            return false;
+
+        std::string versions(size, '\0');
+        if (clGetDeviceInfo(device(), CL_DEVICE_IL_VERSION_KHR, size, &versions[0], nullptr) != CL_SUCCESS)
+            return false;
+
+        return versions.find("SPIR-V") != std::string::npos && entryPoint(device) != nullptr;
+    }
+
+    bool ilCompatible(const std::string& options)
+    {
+        const char* enabled = getenv("OCL_PROGRAM_IL");
+        if (enabled != nullptr && std::string(enabled) == "0")
+            return false;
+
+        return options.find("-D") == std::string::npos;
+    }
+
+    cl::Program createProgramWithIL(const cl::Context& context, const cl::Device& device, const std::vector<unsigned char>& il)
+    {
+        CreateProgramWithIL create = entryPoint(device);
+        if (create == nullptr)
+            throw cl::Error(CL_INVALID_OPERATION, "createProgramWithIL");
+
+        cl_int err = CL_SUCCESS;
+        cl_program program = create(context(), il.data(), il.size(), &err);
+        if (err != CL_SUCCESS)
+            throw cl::Error(err, "clCreateProgramWithIL");
+
+        return cl::Program(program);
+    }
+
+    BuildLatency measureBuildLatency(const cl::Device& device, const std::string& path, const std::string& options, int builds)
+    {
+        BuildLatency latency = { -1.0, -1.0, -1.0, -1.0 };
+        cl::Context& context = Runtime::instance().context(device);
+        std::vector<cl::Device> devices(1, device);
+
+        const EmbeddedKernel* embedded = embeddedKernel(path);
+        std::string source = embedded != nullptr ? embedded->source : util::loadProgram(path);
+
+        // times create and build, the first build on its own
+        auto measure = [&](std::function<cl::Program()> create, double& first, double& average) {
+            double total = 0.0;
+            for (int b = 0; b < builds; b++) {
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+                cl::Program program = create();
+                program.build(devices, options.c_str());
+
+                double ms = milliseconds(start);
+                if (b == 0)
+                    first = ms;
+                else
+                    total += ms;
+            }
+            average = builds > 1 ? total / (builds - 1) : first;
+        };
+
+        measure([&]() {
+            cl::Program::Sources sources(1, std::make_pair(source.c_str(), source.size()));
+            return cl::Program(context, sources);
+        }, latency.source_first, latency.source_average);
+
+        if (embedded != nullptr && !embedded->il.empty() && ilCompatible(options) && supportsIL(device)) {
+            measure([&]() {
+                return createProgramWithIL(context, device, embedded->il);
+            }, latency.il_first, latency.il_average);
+        }
+
+        return latency;
+    }
+}
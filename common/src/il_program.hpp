@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------------
+//
+//  SPIR-V programs
+//
+//  Programs created from SPIR-V modules (clCreateProgramWithIL, OpenCL 2.1,
+//  or clCreateProgramWithILKHR of cl_khr_il_program) skip the OpenCL C front
+//  end of the driver. Runtime::program() uses the module of an embedded
+//  kernel file (embed_kernels in CMake) if the device takes SPIR-V, and falls
+//  back to the source if it does not or the module fails to build.
+//  OCL_PROGRAM_IL=0 always builds from source.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ocl {
+
+    /// <summary>
+    /// True if the device accepts SPIR-V modules.
+    /// </summary>
+    bool supportsIL(const cl::Device& device);
+
+    /// <summary>
+    /// True if a module compiled without options can stand in for the
+    /// source built with these options: definitions (-D) change the source.
+    /// </summary>
+    bool ilCompatible(const std::string& options);
+
+    /// <summary>
+    /// Creates (does not build) a program of the device from a SPIR-V module.
+    /// Throws cl::Error, CL_INVALID_OPERATION if the device takes no SPIR-V.
+    /// </summary>
+    cl::Program createProgramWithIL(const cl::Context& context, const cl::Device& device, const std::vector<unsigned char>& il);
+
+    /// <summary>
+    /// Build latency of a kernel file in milliseconds, the first (cold) build
+    /// and the average of the further ones. -1 where a format is not available.
+    /// </summary>
+    struct BuildLatency
+    {
+        double source_first;
+        double source_average;
+        double il_first;
+        double il_average;
+    };
+
+    /// <summary>
+    /// Measures creating and building the program of a kernel file from its
+    /// source and from its embedded SPIR-V module, bypassing the program cache.
+    /// </summary>
+    /// <param name="device">The device</param>
+    /// <param name="path">The kernel file</param>
+    /// <param name="options">The build options</param>
+    /// <param name="builds">Builds per format, at least 1</param>
+    BuildLatency measureBuildLatency(const cl::Device& device, const std::string& path, const std::string& options = "", int builds = 5);
+}
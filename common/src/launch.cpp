@@ -0,0 +1,87 @@
+//------------------------------------------------------------------------------
+//
+//  Launch geometry
+//
+//------------------------------------------------------------------------------
+
+#include "launch.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ocl {
+
+    namespace {
+
+        // CPU runtimes allow work-groups of 4096 or 8192 work-items, groups
+        // that large leave most cores idle on the ranges of the samples
+        const ::size_t MAX_GROUP_SIZE = 256;
+    }
+
+    ::size_t workGroupSize(const cl::Kernel& kernel, const cl::Device& device, ::size_t items,
+        ::size_t local_bytes_per_item, ::size_t local_bytes_per_group)
+    {
+        ::size_t limit = std::min(kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device), MAX_GROUP_SIZE);
+        ::size_t multiple = std::max<::size_t>(1, kernel.getWorkGroupInfo<CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE>(device));
+
+        // local memory left after what the kernel itself uses
+        cl_ulong local_mem = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+        cl_ulong used = kernel.getWorkGroupInfo<CL_KERNEL_LOCAL_MEM_SIZE>(device) + local_bytes_per_group;
+        if (used > local_mem)
+            throw cl::Error(CL_OUT_OF_RESOURCES, "ocl::workGroupSize not enough local memory");
+
+        if (local_bytes_per_item > 0)
+            limit = std::min<::size_t>(limit, static_cast<::size_t>((local_mem - used) / local_bytes_per_item));
+        if (limit == 0)
+            throw cl::Error(CL_OUT_OF_RESOURCES, "ocl::workGroupSize not enough local memory");
+
+        // the largest multiple of the preferred multiple, the limit itself if it is below
+        if (multiple > limit)
+            multiple = limit;
+        ::size_t size = limit / multiple * multiple;
+
+        // no larger than the range needs
+        size = std::min(size, roundUp(std::max<::size_t>(items, 1), multiple));
+
+        // smaller groups until every compute unit gets one
+        ::size_t compute_units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+        while (size > multiple && (items + size - 1) / size < compute_units)
+            size = std::max(multiple, size / 2 / multiple * multiple);
+
+        return size;
+    }
+
+    LaunchConfig launchConfig(const cl::Kernel& kernel, const cl::Device& device, ::size_t n,
+        ::size_t local_bytes_per_item, ::size_t local_bytes_per_group)
+    {
+        ::size_t size = workGroupSize(kernel, device, n, local_bytes_per_item, local_bytes_per_group);
+        size = std::min(size, device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>()[0]);
+
+        LaunchConfig config;
+        config.group_size = size;
+        config.groups = (n + size - 1) / size;
+        config.global = cl::NDRange(config.groups * size);
+        config.local = cl::NDRange(size);
+        return config;
+    }
+
+    LaunchConfig launchConfig2D(const cl::Kernel& kernel, const cl::Device& device, ::size_t nx, ::size_t ny,
+        ::size_t local_bytes_per_item, ::size_t local_bytes_per_group)
+    {
+        ::size_t size = workGroupSize(kernel, device, nx * ny, local_bytes_per_item, local_bytes_per_group);
+        std::vector<::size_t> max_sizes = device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
+
+        // the largest power of two dividing the size up to its square root goes to y
+        ::size_t ly = 1;
+        while (4 * ly * ly <= size && size % (2 * ly) == 0 && 2 * ly <= max_sizes[1])
+            ly *= 2;
+        ::size_t lx = std::min(size / ly, max_sizes[0]);
+
+        LaunchConfig config;
+        config.group_size = lx * ly;
+        config.groups = ((nx + lx - 1) / lx) * ((ny + ly - 1) / ly);
+        config.global = cl::NDRange(roundUp(nx, lx), roundUp(ny, ly));
+        config.local = cl::NDRange(lx, ly);
+        return config;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//
+//  Launch geometry
+//
+//  Chooses the global and local size of a kernel launch from what the
+//  kernel and the device report: the work-group size is a multiple of
+//  CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, fits the kernel's limit
+//  and the local memory left next to its static __local arrays, and is
+//  shrunk until every compute unit gets a work-group. The global size is
+//  padded to whole work-groups, so the kernels check their range
+//  (if (i < count)) and keep every work-item at their barriers.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+namespace ocl {
+
+    /// <summary>
+    /// The sizes of a kernel launch.
+    /// </summary>
+    struct LaunchConfig
+    {
+        cl::NDRange global;         // padded to whole work-groups
+        cl::NDRange local;
+        ::size_t group_size;        // work-items per work-group
+        ::size_t groups;            // number of work-groups
+    };
+
+    /// <summary>
+    /// n rounded up to a multiple.
+    /// </summary>
+    inline ::size_t roundUp(::size_t n, ::size_t multiple)
+    {
+        return (n + multiple - 1) / multiple * multiple;
+    }
+
+    /// <summary>
+    /// The work-group size of a kernel for a range of items. Choose it
+    /// before setting the __local arguments, the kernel counts those set
+    /// earlier as its own local memory.
+    /// </summary>
+    /// <param name="kernel">The kernel</param>
+    /// <param name="device">The device</param>
+    /// <param name="items">Work-items of the launch, unpadded</param>
+    /// <param name="local_bytes_per_item">__local argument bytes per work-item, like a reduction scratch</param>
+    /// <param name="local_bytes_per_group">__local argument bytes per work-group, like a shared column</param>
+    ::size_t workGroupSize(const cl::Kernel& kernel, const cl::Device& device, ::size_t items,
+        ::size_t local_bytes_per_item = 0, ::size_t local_bytes_per_group = 0);
+
+    /// <summary>
+    /// The launch of a kernel over n work-items.
+    /// </summary>
+    LaunchConfig launchConfig(const cl::Kernel& kernel, const cl::Device& device, ::size_t n,
+        ::size_t local_bytes_per_item = 0, ::size_t local_bytes_per_group = 0);
+
+    /// <summary>
+    /// The launch of a kernel over nx x ny work-items, in work-groups as
+    /// square as the work-group size allows.
+    /// </summary>
+    LaunchConfig launchConfig2D(const cl::Kernel& kernel, const cl::Device& device, ::size_t nx, ::size_t ny,
+        ::size_t local_bytes_per_item = 0, ::size_t local_bytes_per_group = 0);
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+//------------------------------------------------------------------------------
+//
+//  Roofline
+//
+//------------------------------------------------------------------------------
+
+#include "roofline.hpp"
+#include "device_selector.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace ocl {
+
+    Roofline::Roofline(double peak_gflops, double peak_gbs, const std::string& source)
+        : peak_gflops_(peak_gflops), peak_gbs_(peak_gbs), source_(source)
+    {
+    }
+
+    Roofline Roofline::forDevice(const cl::Device& device, const std::string& profile_path)
+    {
+        DeviceProfile profile;
+        if (profile.load(profile_path, device)) {
+            double gflops = profile.value("fp32_gflops");
+            double gbs = profile.value("d2d_copy_gbs");
+
+            if (gflops > 0.0 && gbs > 0.0)
+                return Roofline(gflops, gbs, "measured by PlatformInformation");
+        }
+
+        double gflops, gbs;
+        if (DeviceSelector::probe(device, gflops, gbs))
+            return Roofline(gflops, gbs, "measured by the device probe");
+
+        return Roofline(-1.0, -1.0, "unknown");
+    }
+
+    double Roofline::ridge() const
+    {
+        return peak_gbs_ > 0.0 ? peak_gflops_ / peak_gbs_ : 0.0;
+    }
+
+    double Roofline::bound(double intensity) const
+    {
+        return std::min(peak_gflops_, intensity * peak_gbs_);
+    }
+
+    RooflinePoint Roofline::evaluate(const KernelCost& cost, double seconds) const
+    {
+        RooflinePoint point;
+        point.intensity = cost.intensity();
+        point.gflops = cost.flops / seconds / 1.0e9;
+        point.gbs = cost.bytes / seconds / 1.0e9;
+        point.bound = bound(point.intensity);
+        point.fraction = point.bound > 0.0 ? point.gflops / point.bound : 0.0;
+        point.memory_bound = point.intensity < ridge();
+        return point;
+    }
+
+    void Roofline::printHeader() const
+    {
+        if (peak_gflops_ > 0.0) {
+            std::cout << "Peaks " << peak_gflops_ << " GFLOP/s and " << peak_gbs_ << " GB/s (" << source_
+                      << "), ridge point " << ridge() << " flop/byte\n" << std::endl;
+        }
+        else {
+            std::cout << "No peaks of the device, the bounds are unknown\n" << std::endl;
+        }
+
+        printf("%-24s %10s %10s %10s %10s %9s  %s\n", "kernel", "flop/byte", "GFLOP/s", "GB/s", "bound", "of bound", "bound by");
+    }
+
+    void Roofline::print(const std::string& label, const KernelCost& cost, double seconds) const
+    {
+        RooflinePoint point = evaluate(cost, seconds);
+
+        if (peak_gflops_ > 0.0) {
+            printf("%-24s %10.3f %10.2f %10.2f %10.2f %8.1f%%  %s\n", label.c_str(), point.intensity, point.gflops, point.gbs,
+                point.bound, 100.0 * point.fraction, point.memory_bound ? "memory" : "compute");
+        }
+        else {
+            printf("%-24s %10.3f %10.2f %10.2f %10s %9s  %s\n", label.c_str(), point.intensity, point.gflops, point.gbs,
+                "-", "-", "-");
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+//
+//  Roofline
+//
+//  Relates a measured kernel to the peaks of the device. A kernel declares
+//  its floating point operations and the bytes it moves to and from global
+//  memory; their ratio, the arithmetic intensity, decides whether the
+//  kernel is bound by the memory bandwidth (below the ridge point) or by
+//  the compute peak (above it), and how far it stays below that bound.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+#include "device_profile.hpp"
+
+#include <string>
+
+namespace ocl {
+
+    /// <summary>
+    /// The work of one kernel launch.
+    /// </summary>
+    struct KernelCost
+    {
+        double flops;           // floating point operations
+        double bytes;           // global memory traffic of the algorithm, without caches
+
+        /// <summary>
+        /// Floating point operations per byte.
+        /// </summary>
+        double intensity() const { return bytes > 0.0 ? flops / bytes : 0.0; }
+    };
+
+    /// <summary>
+    /// A measured launch under the roofline.
+    /// </summary>
+    struct RooflinePoint
+    {
+        double intensity;       // flop per byte
+        double gflops;          // achieved GFLOP/s
+        double gbs;             // achieved GB/s
+        double bound;           // attainable GFLOP/s at the intensity
+        double fraction;        // achieved part of the bound
+        bool memory_bound;      // intensity below the ridge point
+    };
+
+    class Roofline
+    {
+    public:
+        /// <summary>
+        /// A roofline of the given peaks.
+        /// </summary>
+        Roofline(double peak_gflops, double peak_gbs, const std::string& source = "given");
+
+        /// <summary>
+        /// The roofline of the device: FP32 FMA rate and device copy bandwidth
+        /// of the PlatformInformation profile, measured by the probe of the
+        /// device selector where the profile has no values.
+        /// </summary>
+        static Roofline forDevice(const cl::Device& device, const std::string& profile_path = DeviceProfile::defaultPath());
+
+        double peakGflops() const { return peak_gflops_; }
+        double peakGbs() const { return peak_gbs_; }
+
+        /// <summary>
+        /// Where the peaks come from.
+        /// </summary>
+        const std::string& source() const { return source_; }
+
+        /// <summary>
+        /// The intensity at which the bandwidth bound meets the compute peak.
+        /// </summary>
+        double ridge() const;
+
+        /// <summary>
+        /// Attainable GFLOP/s at the intensity.
+        /// </summary>
+        double bound(double intensity) const;
+
+        /// <summary>
+        /// Places a launch of the cost that took seconds.
+        /// </summary>
+        RooflinePoint evaluate(const KernelCost& cost, double seconds) const;
+
+        /// <summary>
+        /// Prints the peaks and the column headers of print().
+        /// </summary>
+        void printHeader() const;
+
+        /// <summary>
+        /// Prints a launch as a row of the table.
+        /// </summary>
+        void print(const std::string& label, const KernelCost& cost, double seconds) const;
+
+    private:
+        double peak_gflops_;
+        double peak_gbs_;
+        std::string source_;
+    };
+}
\ No newline at end of file
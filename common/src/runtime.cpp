@@ -0,0 +1,214 @@
+//------------------------------------------------------------------------------
+//
+//  Process-wide OpenCL runtime
+//
+//------------------------------------------------------------------------------
+
+#include "runtime.hpp"
+#include "util.hpp"
+#include "embedded.hpp"
+#include "il_program.hpp"
+
+#include <iostream>
+
+namespace ocl {
+
+    Runtime& Runtime::instance()
+    {
+        static Runtime runtime;
+        return runtime;
+    }
+
+    Runtime::Runtime()
+        : enumerated_(false)
+    {
+    }
+
+    void Runtime::enumerate()
+    {
+        if (enumerated_)
+            return;
+
+        enumerated_ = true;
+
+        // without an installed platform the lists stay empty
+        try {
+            cl::Platform::get(&platforms_);
+        }
+        catch (cl::Error) {
+            platforms_.clear();
+        }
+
+        // Enumerate devices
+        for (::size_t i = 0; i < platforms_.size(); i++)
+        {
+            std::vector<cl::Device> plat_devices;
+            try {
+                platforms_[i].getDevices(CL_DEVICE_TYPE_ALL, &plat_devices);
+            }
+            catch (cl::Error) {
+                continue;
+            }
+            devices_.insert(devices_.end(), plat_devices.begin(), plat_devices.end());
+        }
+    }
+
+    const std::vector<cl::Platform>& Runtime::platforms()
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        enumerate();
+        return platforms_;
+    }
+
+    const std::vector<cl::Device>& Runtime::devices()
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        enumerate();
+        return devices_;
+    }
+
+    cl::Device Runtime::device(unsigned index)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        enumerate();
+
+        if (index >= devices_.size())
+            throw cl::Error(CL_DEVICE_NOT_FOUND, "ocl::Runtime invalid device index");
+
+        return devices_[index];
+    }
+
+    cl::Context& Runtime::context(const cl::Device& device)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+        std::map<cl_device_id, cl::Context>::iterator it = contexts_.find(device());
+        if (it == contexts_.end())
+            it = contexts_.insert(std::make_pair(device(), cl::Context(std::vector<cl::Device>(1, device)))).first;
+
+        return it->second;
+    }
+
+    cl::CommandQueue& Runtime::queue(const cl::Device& device, cl_command_queue_properties properties)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+        std::pair<cl_device_id, cl_command_queue_properties> key(device(), properties);
+
+        std::map<std::pair<cl_device_id, cl_command_queue_properties>, cl::CommandQueue>::iterator it = queues_.find(key);
+        if (it == queues_.end())
+            it = queues_.insert(std::make_pair(key, cl::CommandQueue(context(device), device, properties))).first;
+
+        return it->second;
+    }
+
+    cl::Program& Runtime::program(const cl::Device& device, const std::string& path, const std::string& options)
+    {
+        return program(device, std::vector<std::string>(1, path), options);
+    }
+
+    cl::Program& Runtime::program(const cl::Device& device, const std::vector<std::string>& paths, const std::string& options)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+        std::string key = "file:";
+        for (::size_t i = 0; i < paths.size(); i++)
+            key += paths[i] + "\n";
+        key += options;
+
+        std::map<std::pair<cl_device_id, std::string>, cl::Program>::iterator it = programs_.find(std::make_pair(device(), key));
+        if (it != programs_.end())
+            return it->second;
+
+        // a single embedded file may come with its SPIR-V module, which needs
+        // no front end compilation; the source is the fallback
+        if (paths.size() == 1) {
+            const EmbeddedKernel* embedded = embeddedKernel(paths[0]);
+
+            if (embedded != nullptr && !embedded->il.empty() && ilCompatible(options) && supportsIL(device)) {
+                try {
+                    cl::Program program = createProgramWithIL(context(device), device, embedded->il);
+                    program.build(std::vector<cl::Device>(1, device), options.c_str());
+
+                    return programs_.insert(std::make_pair(std::make_pair(device(), key), program)).first->second;
+                }
+                catch (cl::Error) {
+                    // built from source below
+                }
+            }
+        }
+
+        // embedded kernels need no file I/O
+        std::vector<std::string> sources;
+        for (::size_t i = 0; i < paths.size(); i++) {
+            const EmbeddedKernel* embedded = embeddedKernel(paths[i]);
+            sources.push_back(embedded != nullptr ? embedded->source : util::loadProgram(paths[i]));
+        }
+
+        cl::Program::Sources program_sources;
+        for (::size_t i = 0; i < sources.size(); i++)
+            program_sources.push_back(std::make_pair(sources[i].c_str(), sources[i].size()));
+
+        return build(device, key, program_sources, options);
+    }
+
+    cl::Program& Runtime::programFromSource(const cl::Device& device, const std::string& source, const std::string& options)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+        std::string key = "source:" + source + "\n" + options;
+
+        std::map<std::pair<cl_device_id, std::string>, cl::Program>::iterator it = programs_.find(std::make_pair(device(), key));
+        if (it != programs_.end())
+            return it->second;
+
+        cl::Program::Sources program_sources(1, std::make_pair(source.c_str(), source.size()));
+
+        return build(device, key, program_sources, options);
+    }
+
+    cl::Program& Runtime::build(const cl::Device& device, const std::string& key,
+        const cl::Program::Sources& sources, const std::string& options)
+    {
+        cl::Program program(context(device), sources);
+        std::vector<cl::Device> devices(1, device);
+
+        try {
+            program.build(devices, options.c_str());
+        }
+        catch (cl::Error err) {
+            // the log is the only hint why a kernel does not compile
+            if (err.err() == CL_BUILD_PROGRAM_FAILURE)
+                std::cout << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << std::endl;
+            throw;
+        }
+
+        return programs_.insert(std::make_pair(std::make_pair(device(), key), program)).first->second;
+    }
+
+    cl::Kernel& Runtime::kernel(const cl::Program& program, const std::string& name)
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+        std::pair<cl_program, std::string> key(program(), name);
+
+        std::map<std::pair<cl_program, std::string>, cl::Kernel>::iterator it = kernels_.find(key);
+        if (it == kernels_.end())
+            it = kernels_.insert(std::make_pair(key, cl::Kernel(program, name.c_str()))).first;
+
+        return it->second;
+    }
+
+    ::size_t Runtime::cachedPrograms()
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        return programs_.size();
+    }
+
+    unsigned getDeviceList(std::vector<cl::Device>& devices)
+    {
+        const std::vector<cl::Device>& all = Runtime::instance().devices();
+        devices.insert(devices.end(), all.begin(), all.end());
+        return static_cast<unsigned>(devices.size());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+//
+//  Process-wide OpenCL runtime
+//
+//  Platforms and devices are enumerated once. Contexts, queues, programs
+//  and kernels are created on first use and cached, so every part of a
+//  sample (and every sample function) asking for the same object gets the
+//  same one instead of rebuilding it.
+//
+//  All samples link against this library (target OpenCLCommon).
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+// the library reports errors as cl::Error
+#ifndef __CL_ENABLE_EXCEPTIONS
+#define __CL_ENABLE_EXCEPTIONS
+#endif
+
+#include "CL/cl.hpp"    // Khronos C++ Wrapper API
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ocl {
+
+    class Runtime
+    {
+    public:
+        /// <summary>
+        /// The runtime of the process.
+        /// </summary>
+        static Runtime& instance();
+
+        /// <summary>
+        /// All platforms, empty if there is no OpenCL platform.
+        /// </summary>
+        const std::vector<cl::Platform>& platforms();
+
+        /// <summary>
+        /// The devices of all platforms, in platform order.
+        /// </summary>
+        const std::vector<cl::Device>& devices();
+
+        /// <summary>
+        /// The device with the index in devices().
+        /// </summary>
+        cl::Device device(unsigned index);
+
+        /// <summary>
+        /// The context of a single device, created on first use.
+        /// </summary>
+        cl::Context& context(const cl::Device& device);
+
+        /// <summary>
+        /// A queue of the device in its context, created on first use.
+        /// Every combination of properties has its own queue.
+        /// </summary>
+        cl::CommandQueue& queue(const cl::Device& device, cl_command_queue_properties properties = 0);
+
+        /// <summary>
+        /// The program of a kernel file built for the device, loaded and built on first use.
+        /// Kernels embedded into the executable (embed_kernels in CMake) are
+        /// taken from memory, others are read from the file. An embedded
+        /// SPIR-V module is preferred where the device takes it (il_program.hpp).
+        /// </summary>
+        /// <param name="device">The device</param>
+        /// <param name="path">The kernel file</param>
+        /// <param name="options">The build options</param>
+        cl::Program& program(const cl::Device& device, const std::string& path, const std::string& options = "");
+
+        /// <summary>
+        /// The program of several kernel files, compiled as one program.
+        /// </summary>
+        cl::Program& program(const cl::Device& device, const std::vector<std::string>& paths, const std::string& options = "");
+
+        /// <summary>
+        /// A program built from source, cached by the source.
+        /// </summary>
+        cl::Program& programFromSource(const cl::Device& device, const std::string& source, const std::string& options = "");
+
+        /// <summary>
+        /// The kernel of a program, created on first use.
+        /// Kernel arguments are state: threads enqueuing the same kernel
+        /// concurrently have to clone it (cl::Kernel(program, name)).
+        /// </summary>
+        /// <param name="program">A program of the runtime</param>
+        /// <param name="name">The name of the kernel</param>
+        cl::Kernel& kernel(const cl::Program& program, const std::string& name);
+
+        /// <summary>
+        /// Number of programs built so far.
+        /// </summary>
+        ::size_t cachedPrograms();
+
+    private:
+        Runtime();
+        Runtime(const Runtime&);
+        Runtime& operator=(const Runtime&);
+
+        void enumerate();
+        cl::Program& build(const cl::Device& device, const std::string& key,
+            const cl::Program::Sources& sources, const std::string& options);
+
+        std::recursive_mutex mutex_;
+        bool enumerated_;
+
+        std::vector<cl::Platform> platforms_;
+        std::vector<cl::Device> devices_;
+
+        std::map<cl_device_id, cl::Context> contexts_;
+        std::map<std::pair<cl_device_id, cl_command_queue_properties>, cl::CommandQueue> queues_;
+        std::map<std::pair<cl_device_id, std::string>, cl::Program> programs_;
+        std::map<std::pair<cl_program, std::string>, cl::Kernel> kernels_;
+    };
+
+    /// <summary>
+    /// Gets the device list.
+    /// </summary>
+    /// <param name="devices">The devices.</param>
+    /// <returns>The number of devices</returns>
+    unsigned getDeviceList(std::vector<cl::Device>& devices);
+}
\ No newline at end of file
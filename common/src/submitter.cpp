@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+//
+//  Concurrent submission
+//
+//------------------------------------------------------------------------------
+
+#include "submitter.hpp"
+
+namespace ocl {
+
+    Submitter::Worker::Worker(const cl::Context& context, const cl::Device& device,
+        cl_command_queue_properties properties, unsigned index)
+        : queue_(context, device, properties), index_(index)
+    {
+    }
+
+    cl::Kernel& Submitter::Worker::kernel(const cl::Program& program, const std::string& name)
+    {
+        std::pair<cl_program, std::string> key(program(), name);
+
+        std::map<std::pair<cl_program, std::string>, cl::Kernel>::iterator it = kernels_.find(key);
+        if (it == kernels_.end())
+            it = kernels_.insert(std::make_pair(key, cl::Kernel(program, name.c_str()))).first;
+
+        return it->second;
+    }
+
+    Submitter::Submitter(const cl::Device& device, unsigned workers, cl_command_queue_properties properties)
+        : running_(0), stop_(false)
+    {
+        cl::Context& context = Runtime::instance().context(device);
+
+        // the queues are created up front, errors are thrown here and not in a worker
+        for (unsigned i = 0; i < workers; i++)
+            workers_.push_back(std::unique_ptr<Worker>(new Worker(context, device, properties, i)));
+
+        for (unsigned i = 0; i < workers; i++)
+            threads_.push_back(std::thread(&Submitter::run, this, i));
+    }
+
+    Submitter::~Submitter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        pending_.notify_all();
+
+        for (::size_t i = 0; i < threads_.size(); i++)
+            threads_[i].join();
+    }
+
+    void Submitter::wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return tasks_.empty() && running_ == 0; });
+    }
+
+    void Submitter::enqueue(std::function<void(Worker&)> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(task);
+        }
+        pending_.notify_one();
+    }
+
+    void Submitter::run(unsigned index)
+    {
+        Worker& worker = *workers_[index];
+
+        for (;;) {
+            std::function<void(Worker&)> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                pending_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+
+                task = tasks_.front();
+                tasks_.pop_front();
+                running_++;
+            }
+
+            // errors are stored in the future of the task
+            task(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_--;
+            }
+            idle_.notify_all();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+//
+//  Concurrent submission
+//
+//  A pool of worker threads submitting to one device, each worker with its
+//  own command queue. Tasks are taken from a shared queue by the next free
+//  worker and get that worker's queue and kernels.
+//
+//  Programs are shared: building and creating kernels is thread safe. Kernel
+//  arguments are not, so every worker creates its own cl::Kernel of a
+//  program (the OpenCL 1.2 way of cloning a kernel) and a task only sets
+//  arguments of the kernels of its worker.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+#include "async.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ocl {
+
+    class Submitter
+    {
+    public:
+        /// <summary>
+        /// The queue and kernels of one worker thread.
+        /// </summary>
+        class Worker
+        {
+        public:
+            Worker(const cl::Context& context, const cl::Device& device, cl_command_queue_properties properties, unsigned index);
+
+            /// <summary>
+            /// The command queue of the worker.
+            /// </summary>
+            cl::CommandQueue& queue() { return queue_; }
+
+            /// <summary>
+            /// The worker's own kernel of the program, created on first use.
+            /// </summary>
+            cl::Kernel& kernel(const cl::Program& program, const std::string& name);
+
+            /// <summary>
+            /// Index of the worker, 0 to workers() - 1.
+            /// </summary>
+            unsigned index() const { return index_; }
+
+        private:
+            cl::CommandQueue queue_;
+            std::map<std::pair<cl_program, std::string>, cl::Kernel> kernels_;
+            unsigned index_;
+        };
+
+        /// <summary>
+        /// Starts the workers for the device, in the context of the runtime.
+        /// </summary>
+        /// <param name="device">The device</param>
+        /// <param name="workers">Number of threads and queues</param>
+        /// <param name="properties">Properties of the queues</param>
+        Submitter(const cl::Device& device, unsigned workers, cl_command_queue_properties properties = 0);
+
+        /// <summary>
+        /// Runs the remaining tasks and stops the workers.
+        /// </summary>
+        ~Submitter();
+
+        Submitter(const Submitter&) = delete;
+        Submitter& operator=(const Submitter&) = delete;
+
+        /// <summary>
+        /// Number of workers.
+        /// </summary>
+        unsigned workers() const { return (unsigned)threads_.size(); }
+
+        /// <summary>
+        /// Runs task(worker) on the next free worker. The future holds what
+        /// the task returns, or what it throws.
+        /// </summary>
+        template<typename F>
+        auto submit(F task) -> Future<decltype(task(std::declval<Worker&>()))>
+        {
+            typedef decltype(task(std::declval<Worker&>())) R;
+            typedef typename Future<R>::state_type state_type;
+
+            std::shared_ptr<state_type> state = std::make_shared<state_type>();
+
+            enqueue([state, task](Worker& worker) mutable {
+                try {
+                    auto compute = [&]() { return task(worker); };
+                    detail::Complete<R>::run(*state, compute);
+                }
+                catch (...) {
+                    state->fail(std::current_exception());
+                }
+            });
+
+            return Future<R>(state);
+        }
+
+        /// <summary>
+        /// Blocks until all submitted tasks ran.
+        /// </summary>
+        void wait();
+
+    private:
+        void enqueue(std::function<void(Worker&)> task);
+        void run(unsigned index);
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::thread> threads_;
+
+        std::mutex mutex_;
+        std::condition_variable pending_;   // a task was added or the pool stops
+        std::condition_variable idle_;      // a task finished
+        std::deque<std::function<void(Worker&)>> tasks_;
+        ::size_t running_;
+        bool stop_;
+    };
+}
\ No newline at end of file
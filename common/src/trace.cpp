@@ -0,0 +1,236 @@
+//------------------------------------------------------------------------------
+//
+//  Command timeline
+//
+//------------------------------------------------------------------------------
+
+#include "trace.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace ocl {
+
+    namespace {
+
+        // a string as JSON
+        std::string quote(const std::string& text)
+        {
+            std::string out = "\"";
+            for (::size_t i = 0; i < text.size(); i++) {
+                char c = text[i];
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                    out += c;
+                }
+                else if ((unsigned char)c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else {
+                    out += c;
+                }
+            }
+            return out + "\"";
+        }
+
+        // process ids of the trace: the host, and the devices after it
+        const int HOST_PID = 0;
+
+        // the timestamps of a command on the device, in nanoseconds
+        struct Timestamps
+        {
+            cl_ulong queued, submit, start, end;
+        };
+
+        bool timestamps(const cl::Event& event, Timestamps& t)
+        {
+            try {
+                t.queued = event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+                t.submit = event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+                t.start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+                t.end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+                return true;
+            }
+            catch (cl::Error) {
+                // no profiling on the queue, or the command failed
+                return false;
+            }
+        }
+    }
+
+    Trace& Trace::instance()
+    {
+        static Trace trace;
+        return trace;
+    }
+
+    Trace::Trace()
+        : active_(false), origin_(std::chrono::high_resolution_clock::now())
+    {
+        const char* path = getenv("OCL_TRACE");
+        if (path != nullptr && *path != '\0')
+            start(path);
+    }
+
+    void Trace::start(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_ = true;
+        path_ = path;
+    }
+
+    bool Trace::active()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return active_;
+    }
+
+    cl_command_queue_properties Trace::queueProperties(cl_command_queue_properties properties)
+    {
+        return active() ? properties | CL_QUEUE_PROFILING_ENABLE : properties;
+    }
+
+    double Trace::now() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - origin_).count();
+    }
+
+    void Trace::command(const std::string& category, const std::string& name, const cl::CommandQueue& queue,
+        const std::function<void(cl::Event&)>& enqueue)
+    {
+        if (!active()) {
+            cl::Event event;
+            enqueue(event);
+            return;
+        }
+
+        Record record;
+        record.category = category;
+        record.name = name;
+        record.queue = queue;
+
+        record.enqueue_begin = now();
+        enqueue(record.event);
+        record.enqueue_end = now();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::map<std::thread::id, unsigned>::iterator it = threads_.find(std::this_thread::get_id());
+        if (it == threads_.end())
+            it = threads_.insert(std::make_pair(std::this_thread::get_id(), (unsigned)threads_.size())).first;
+        record.thread = it->second;
+
+        records_.push_back(record);
+    }
+
+    void Trace::write()
+    {
+        std::vector<Record> records;
+        std::string path;
+        unsigned threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            records.swap(records_);
+            path = path_;
+            threads = (unsigned)threads_.size();
+            active_ = false;
+        }
+
+        if (records.empty())
+            return;
+
+        std::ofstream file(path.c_str());
+        if (!file.is_open()) {
+            std::cout << "Cannot write trace file: " << path << std::endl;
+            return;
+        }
+
+        // rows of the device processes: one per queue, the devices in order of appearance
+        std::map<cl_command_queue, unsigned> queues;
+        std::vector<cl_device_id> devices;
+        std::map<cl_command_queue, int> queue_pid;
+        std::map<cl_device_id, double> offsets;     // device clock to trace time, microseconds
+
+        std::vector<std::string> events;
+
+        for (::size_t r = 0; r < records.size(); r++) {
+            const Record& record = records[r];
+            char line[512];
+
+            // the enqueue call on the host
+            snprintf(line, sizeof(line), "{\"name\":%s,\"cat\":\"enqueue\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                quote(record.name).c_str(), HOST_PID, record.thread, record.enqueue_begin, record.enqueue_end - record.enqueue_begin);
+            events.push_back(line);
+
+            if (record.event() == nullptr)
+                continue;
+
+            record.event.wait();
+
+            Timestamps t;
+            if (!timestamps(record.event, t))
+                continue;
+
+            cl::Device device = record.queue.getInfo<CL_QUEUE_DEVICE>();
+
+            if (queues.find(record.queue()) == queues.end()) {
+                ::size_t d = 0;
+                while (d < devices.size() && devices[d] != device())
+                    d++;
+                if (d == devices.size()) {
+                    devices.push_back(device());
+                    std::string device_name = device.getInfo<CL_DEVICE_NAME>();
+                    snprintf(line, sizeof(line), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":%s}}",
+                        (int)d + 1, quote("device " + device_name).c_str());
+                    events.push_back(line);
+                }
+
+                unsigned index = (unsigned)queues.size();
+                queues[record.queue()] = index;
+                queue_pid[record.queue()] = (int)d + 1;
+
+                snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"queue %u\"}}",
+                    (int)d + 1, index, index);
+                events.push_back(line);
+            }
+
+            if (offsets.find(device()) == offsets.end())
+                offsets[device()] = record.enqueue_begin - t.queued / 1000.0;
+
+            double offset = offsets[device()];
+            int pid = queue_pid[record.queue()];
+            unsigned tid = queues[record.queue()];
+            double start = t.start / 1000.0 + offset;
+
+            // the command on the device
+            snprintf(line, sizeof(line), "{\"name\":%s,\"cat\":%s,\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"thread\":%u,\"queued_to_submit_us\":%.3f,\"submit_to_start_us\":%.3f}}",
+                quote(record.name).c_str(), quote(record.category).c_str(), pid, tid, start, (t.end - t.start) / 1000.0,
+                record.thread, (t.submit - t.queued) / 1000.0, (t.start - t.submit) / 1000.0);
+            events.push_back(line);
+
+            // an arrow from the enqueue to the command
+            snprintf(line, sizeof(line), "{\"name\":\"enqueue\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":%u,\"pid\":%d,\"tid\":%u,\"ts\":%.3f}",
+                (unsigned)r, HOST_PID, record.thread, record.enqueue_begin);
+            events.push_back(line);
+            snprintf(line, sizeof(line), "{\"name\":\"enqueue\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%u,\"pid\":%d,\"tid\":%u,\"ts\":%.3f}",
+                (unsigned)r, pid, tid, start);
+            events.push_back(line);
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << HOST_PID << ",\"args\":{\"name\":\"host\"}}";
+        for (unsigned t = 0; t < threads; t++)
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << HOST_PID << ",\"tid\":" << t
+                 << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+        for (::size_t e = 0; e < events.size(); e++)
+            file << ",\n" << events[e];
+        file << "\n]}\n";
+
+        std::cout << "Trace of " << records.size() << " commands written to " << path << std::endl;
+    }
+}
@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------
+//
+//  Command timeline
+//
+//  Records enqueued commands (writes, kernels, reads, ...) with the host time
+//  of the enqueue call, the thread, the queue and the device profiling
+//  timestamps of the command, and writes them as Chrome trace-event JSON.
+//  Open the file in chrome://tracing or https://ui.perfetto.dev: the host
+//  threads and every queue are rows, so bubbles, serialization and the
+//  overlap of transfers and kernels are visible.
+//
+//  The queues need CL_QUEUE_PROFILING_ENABLE for the device rows, commands
+//  of other queues only show their enqueue on the host. OpenCL 1.2 has no
+//  common clock for host and device, the device times are aligned by
+//  the first command of each device (its QUEUED time is taken as the start
+//  of its enqueue call).
+//
+//      ocl::Trace& trace = ocl::Trace::instance();
+//      trace.start("trace.json");              // or OCL_TRACE=trace.json
+//      trace.command("kernel", "mat_mul", queue, [&](cl::Event& event) {
+//          event = mat_mul(cl::EnqueueArgs(queue, global), ...);
+//      });
+//      trace.write();                          // waits for the commands
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ocl {
+
+    class Trace
+    {
+    public:
+        /// <summary>
+        /// The trace of the process, recording if OCL_TRACE names a file.
+        /// </summary>
+        static Trace& instance();
+
+        /// <summary>
+        /// Starts recording, the trace is written to the file.
+        /// </summary>
+        void start(const std::string& path);
+
+        /// <summary>
+        /// True while recording.
+        /// </summary>
+        bool active();
+
+        /// <summary>
+        /// Queue properties to pass for traced queues: profiling while recording.
+        /// </summary>
+        cl_command_queue_properties queueProperties(cl_command_queue_properties properties = 0);
+
+        /// <summary>
+        /// Runs the enqueue, which sets the event of its command, and records
+        /// the command. Without recording only the enqueue runs.
+        /// </summary>
+        /// <param name="category">Kind of the command, e.g. write, kernel, read</param>
+        /// <param name="name">Name shown in the timeline</param>
+        /// <param name="queue">The queue the command is enqueued on</param>
+        /// <param name="enqueue">Enqueues the command</param>
+        void command(const std::string& category, const std::string& name, const cl::CommandQueue& queue,
+            const std::function<void(cl::Event&)>& enqueue);
+
+        /// <summary>
+        /// Writes the recorded commands, waiting for their completion, and
+        /// stops recording. Nothing happens if nothing was recorded.
+        /// </summary>
+        void write();
+
+    private:
+        Trace();
+        Trace(const Trace&);
+        Trace& operator=(const Trace&);
+
+        // microseconds since the trace was created
+        double now() const;
+
+        struct Record
+        {
+            std::string category;
+            std::string name;
+            cl::Event event;
+            cl::CommandQueue queue;
+            unsigned thread;
+            double enqueue_begin;
+            double enqueue_end;
+        };
+
+        std::mutex mutex_;
+        bool active_;
+        std::string path_;
+        std::chrono::high_resolution_clock::time_point origin_;
+
+        std::vector<Record> records_;
+        std::map<std::thread::id, unsigned> threads_;
+    };
+}
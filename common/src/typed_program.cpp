@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+//
+//  Type-generic kernels
+//
+//------------------------------------------------------------------------------
+
+#include "typed_program.hpp"
+#include "embedded.hpp"
+#include "util.hpp"
+
+#include <cstring>
+
+namespace ocl {
+
+    namespace {
+
+        const char* TYPE_PRELUDE =
+            "#ifdef USE_DOUBLE\n"
+            "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+            "#endif\n"
+            "#ifdef USE_HALF\n"
+            "#define LOAD(p, i) vload_half((i), (p))\n"
+            "#define STORE(v, p, i) vstore_half((v), (i), (p))\n"
+            "#else\n"
+            "#define LOAD(p, i) ((ACC)(p)[i])\n"
+            "#define STORE(v, p, i) ((p)[i] = (T)(v))\n"
+            "#endif\n"
+            "#line 1\n";
+    }
+
+    half toHalf(float value)
+    {
+        cl_uint f;
+        std::memcpy(&f, &value, sizeof(f));
+
+        cl_uint sign = (f >> 16) & 0x8000;
+        int exponent = (int)((f >> 23) & 0xFF) - 127 + 15;
+        cl_uint mantissa = f & 0x7FFFFF;
+
+        half h;
+
+        if (((f >> 23) & 0xFF) == 0xFF) {
+            // infinity and NaN
+            h.bits = (cl_half)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+        }
+        else if (exponent >= 31) {
+            // too large
+            h.bits = (cl_half)(sign | 0x7C00);
+        }
+        else if (exponent <= 0) {
+            // subnormal or zero
+            if (exponent < -10) {
+                h.bits = (cl_half)sign;
+            }
+            else {
+                mantissa |= 0x800000;
+                int shift = 14 - exponent;
+                cl_uint rounded = mantissa >> shift;
+                cl_uint rest = mantissa & ((1u << shift) - 1);
+                cl_uint halfway = 1u << (shift - 1);
+                if (rest > halfway || (rest == halfway && (rounded & 1)))
+                    rounded++;
+                h.bits = (cl_half)(sign | rounded);
+            }
+        }
+        else {
+            cl_uint rounded = ((cl_uint)exponent << 10) | (mantissa >> 13);
+            cl_uint rest = mantissa & 0x1FFF;
+            if (rest > 0x1000 || (rest == 0x1000 && (rounded & 1)))
+                rounded++;          // may carry into the exponent, up to infinity
+            h.bits = (cl_half)(sign | rounded);
+        }
+
+        return h;
+    }
+
+    float fromHalf(half value)
+    {
+        cl_uint sign = (cl_uint)(value.bits & 0x8000) << 16;
+        cl_uint exponent = (value.bits >> 10) & 0x1F;
+        cl_uint mantissa = value.bits & 0x3FF;
+        cl_uint f;
+
+        if (exponent == 0x1F) {
+            f = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else if (exponent == 0) {
+            if (mantissa == 0) {
+                f = sign;
+            }
+            else {
+                // subnormal, normalized for float
+                int e = -1;
+                do {
+                    mantissa <<= 1;
+                    e++;
+                } while ((mantissa & 0x400) == 0);
+                f = sign | ((cl_uint)(127 - 15 - e) << 23) | ((mantissa & 0x3FF) << 13);
+            }
+        }
+        else {
+            f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        std::memcpy(&result, &f, sizeof(result));
+        return result;
+    }
+
+    std::string typedSource(const std::string& path)
+    {
+        const EmbeddedKernel* embedded = embeddedKernel(path);
+        return TYPE_PRELUDE + (embedded != nullptr ? embedded->source : util::loadProgram(path));
+    }
+}
\ No newline at end of file
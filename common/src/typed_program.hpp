@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+//
+//  Type-generic kernels
+//
+//  A kernel file written once for an element type T is built for int32,
+//  float, double or half by build options (-DT=... -DACC=...). A prelude
+//  prepended to the source defines
+//
+//      T               the element type in global memory
+//      ACC             the type arithmetic is done in (float for half)
+//      LOAD(p, i)      p[i] as ACC
+//      STORE(v, p, i)  p[i] = v
+//
+//  so half vectors are read and written with vload_half / vstore_half and
+//  need no cl_khr_fp16. Every type gets its own program, built on first use
+//  and cached by the runtime.
+//
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "runtime.hpp"
+
+#include <string>
+
+namespace ocl {
+
+    /// <summary>
+    /// A half element on the host, the raw IEEE 754 binary16 bits.
+    /// </summary>
+    struct half
+    {
+        cl_half bits;
+    };
+
+    /// <summary>
+    /// The nearest half (round to nearest even).
+    /// </summary>
+    half toHalf(float value);
+
+    /// <summary>
+    /// The value of a half.
+    /// </summary>
+    float fromHalf(half value);
+
+    /// <summary>
+    /// Build options and host conversions of an element type.
+    /// </summary>
+    template<typename T> struct ElementType;
+
+    template<> struct ElementType<cl_int>
+    {
+        typedef cl_int acc_type;   // ACC on the host
+        static const char* name() { return "int32"; }
+        static const char* options() { return "-DT=int -DACC=int"; }
+        static double epsilon() { return 0.0; }
+        static bool supported(const cl::Device&) { return true; }
+        static cl_int fromDouble(double v) { return (cl_int)v; }
+        static double toDouble(cl_int v) { return v; }
+    };
+
+    template<> struct ElementType<cl_float>
+    {
+        typedef cl_float acc_type;   // ACC on the host
+        static const char* name() { return "float"; }
+        static const char* options() { return "-DT=float -DACC=float"; }
+        static double epsilon() { return 1.0e-6; }
+        static bool supported(const cl::Device&) { return true; }
+        static cl_float fromDouble(double v) { return (cl_float)v; }
+        static double toDouble(cl_float v) { return v; }
+    };
+
+    template<> struct ElementType<cl_double>
+    {
+        typedef cl_double acc_type;   // ACC on the host
+        static const char* name() { return "double"; }
+        static const char* options() { return "-DT=double -DACC=double -DUSE_DOUBLE"; }
+        static double epsilon() { return 1.0e-15; }
+        // before OpenCL 1.2 CL_DEVICE_DOUBLE_FP_CONFIG is an error without cl_khr_fp64
+        static bool supported(const cl::Device& device)
+        {
+            return device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != std::string::npos
+                && device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>() != 0;
+        }
+        static cl_double fromDouble(double v) { return v; }
+        static double toDouble(cl_double v) { return v; }
+    };
+
+    template<> struct ElementType<half>
+    {
+        typedef cl_float acc_type;   // ACC on the host
+        static const char* name() { return "half"; }
+        static const char* options() { return "-DT=half -DACC=float -DUSE_HALF"; }
+        static double epsilon() { return 1.0e-3; }
+        static bool supported(const cl::Device&) { return true; }
+        static half fromDouble(double v) { return toHalf((float)v); }
+        static double toDouble(half v) { return fromHalf(v); }
+    };
+
+    /// <summary>
+    /// The source of a kernel file (embedded or read) with the type prelude.
+    /// </summary>
+    std::string typedSource(const std::string& path);
+
+    /// <summary>
+    /// The build options of the element type T followed by further options.
+    /// </summary>
+    template<typename T>
+    std::string typedOptions(const std::string& options = "")
+    {
+        std::string all = ElementType<T>::options();
+        if (!options.empty())
+            all += " " + options;
+        return all;
+    }
+
+    /// <summary>
+    /// The program of a type-generic kernel file for the element type T,
+    /// built on first use.
+    /// </summary>
+    /// <param name="device">The device</param>
+    /// <param name="path">The kernel file</param>
+    /// <param name="options">Further build options</param>
+    template<typename T>
+    cl::Program& typedProgram(const cl::Device& device, const std::string& path, const std::string& options = "")
+    {
+        return Runtime::instance().programFromSource(device, typedSource(path), typedOptions<T>(options));
+    }
+}
\ No newline at end of file